@@ -2,7 +2,7 @@
 
 #include <vector>
 #include <cstdint>
-#include "DX7Voice.h"
+#include "DX7VoiceBank.h"
 
 class DX7BulkPacker
 {
@@ -10,9 +10,7 @@ public:
     static constexpr int N_VOICES = 32;
     static constexpr int BULK_DUMP_SIZE = 4096 + 6;
     
-    static std::vector<uint8_t> packBulkDump(const std::vector<DX7Voice>& voices);
+    // Allocating convenience wrapper; DX7SysExWriter::writeBulkDump fills a fixed buffer
+    static std::vector<uint8_t> packBulkDump(const DX7VoiceBank& bank);
     static uint8_t calculateChecksum(const std::vector<uint8_t>& data);
-    
-private:
-    static std::vector<uint8_t> packVoiceForBulk(const DX7Voice& voice);
 };
\ No newline at end of file
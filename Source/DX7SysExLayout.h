@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "DX7Voice.h"
+
+// Where each of a voice's DX7Voice::N_PARAMS parameters (bulk dump ordering)
+// lives in the two SysEx voice formats: the byte within the packed voice, its
+// bit shift and its mask. Fields sharing a byte never overlap. Shared by
+// DX7SysExWriter and DX7SysExReader, which take the layouts as template
+// arguments so the packing and unpacking code is expanded at compile time.
+namespace DX7SysExLayout
+{
+    struct Field
+    {
+        uint8_t offset;
+        uint8_t shift;
+        uint8_t mask;
+    };
+    using Layout = std::array<Field, DX7Voice::N_PARAMS>;
+
+    constexpr size_t BULK_VOICE_BYTES = 128;
+    constexpr size_t SINGLE_VOICE_PAYLOAD_BYTES = DX7Voice::N_PARAMS; // 155
+
+    constexpr int OSC_PARAMS = 21;
+    constexpr int GLOBAL_PARAMS = 29;
+
+    // Oscillator parameters in DX7Voice order:
+    // R1,R2,R3,R4,L1,L2,L3,L4,BP,LD,RD,RC,LC,DET,RS,KVS,AMS,OL,FC,M,FF
+    constexpr int BULK_OSC_BYTES = 17;
+    constexpr Field BULK_OSC[OSC_PARAMS] = {
+        { 0, 0, 0x7F }, { 1, 0, 0x7F }, { 2, 0, 0x7F }, { 3, 0, 0x7F },   // R1-R4
+        { 4, 0, 0x7F }, { 5, 0, 0x7F }, { 6, 0, 0x7F }, { 7, 0, 0x7F },   // L1-L4
+        { 8, 0, 0x7F }, { 9, 0, 0x7F }, { 10, 0, 0x7F },                  // BP, LD, RD
+        { 11, 2, 0x03 }, { 11, 0, 0x03 },                                 // RC, LC
+        { 12, 3, 0x0F }, { 12, 0, 0x07 },                                 // DET, RS
+        { 13, 2, 0x07 }, { 13, 0, 0x03 },                                 // KVS, AMS
+        { 14, 0, 0x7F },                                                  // OL
+        { 15, 1, 0x1F }, { 15, 0, 0x01 },                                 // FC, M
+        { 16, 0, 0x7F }                                                   // FF
+    };
+
+    // Global parameters in DX7Voice order:
+    // PR1-PR4,PL1-PL4,ALG,OKS,FB,LFS,LFD,LPMD,LAMD,LPMS,LFW,LKS,TRNSP,NAME1-10
+    constexpr Field BULK_GLOBAL[GLOBAL_PARAMS] = {
+        { 0, 0, 0x7F }, { 1, 0, 0x7F }, { 2, 0, 0x7F }, { 3, 0, 0x7F },   // PR1-PR4
+        { 4, 0, 0x7F }, { 5, 0, 0x7F }, { 6, 0, 0x7F }, { 7, 0, 0x7F },   // PL1-PL4
+        { 8, 0, 0x1F },                                                   // ALG
+        { 9, 3, 0x01 }, { 9, 0, 0x07 },                                   // OKS, FB
+        { 10, 0, 0x7F }, { 11, 0, 0x7F }, { 12, 0, 0x7F }, { 13, 0, 0x7F }, // LFS, LFD, LPMD, LAMD
+        { 14, 4, 0x07 }, { 14, 1, 0x07 }, { 14, 0, 0x01 },                // LPMS, LFW, LKS
+        { 15, 0, 0x3F },                                                  // TRNSP
+        { 16, 0, 0x7F }, { 17, 0, 0x7F }, { 18, 0, 0x7F }, { 19, 0, 0x7F }, { 20, 0, 0x7F }, // NAME
+        { 21, 0, 0x7F }, { 22, 0, 0x7F }, { 23, 0, 0x7F }, { 24, 0, 0x7F }, { 25, 0, 0x7F }
+    };
+
+    // Single voice dumps keep one parameter per byte, in a different order:
+    // R1-R4,L1-L4,BP,LD,RD,LC,RC,RS,AMS,KVS,OL,M,FC,FF,DET
+    constexpr int SINGLE_OSC_BYTES = OSC_PARAMS;
+    constexpr Field SINGLE_OSC[OSC_PARAMS] = {
+        { 0, 0, 0x7F }, { 1, 0, 0x7F }, { 2, 0, 0x7F }, { 3, 0, 0x7F },
+        { 4, 0, 0x7F }, { 5, 0, 0x7F }, { 6, 0, 0x7F }, { 7, 0, 0x7F },
+        { 8, 0, 0x7F }, { 9, 0, 0x7F }, { 10, 0, 0x7F },
+        { 12, 0, 0x7F }, { 11, 0, 0x7F },                                 // RC, LC
+        { 20, 0, 0x7F }, { 13, 0, 0x7F },                                 // DET, RS
+        { 15, 0, 0x7F }, { 14, 0, 0x7F },                                 // KVS, AMS
+        { 16, 0, 0x7F },                                                  // OL
+        { 18, 0, 0x7F }, { 17, 0, 0x7F },                                 // FC, M
+        { 19, 0, 0x7F }                                                   // FF
+    };
+
+    constexpr Layout makeLayout(const Field (&osc)[OSC_PARAMS], int oscBytes, bool packedGlobal)
+    {
+        Layout layout{};
+        int index = 0;
+        for (int o = 0; o < DX7Voice::N_OSC; ++o) {
+            for (int p = 0; p < OSC_PARAMS; ++p) {
+                const Field field = osc[p];
+                layout[index++] = { static_cast<uint8_t>(o * oscBytes + field.offset), field.shift, field.mask };
+            }
+        }
+
+        // The single voice global block is the parameters one per byte, in order
+        const int globalBase = DX7Voice::N_OSC * oscBytes;
+        for (int p = 0; p < GLOBAL_PARAMS; ++p) {
+            const Field field = packedGlobal ? BULK_GLOBAL[p] : Field{ static_cast<uint8_t>(p), 0, 0x7F };
+            layout[index++] = { static_cast<uint8_t>(globalBase + field.offset), field.shift, field.mask };
+        }
+        return layout;
+    }
+
+    // Inline so every translation unit instantiating on them sees the same object
+    inline constexpr Layout BULK_LAYOUT = makeLayout(BULK_OSC, BULK_OSC_BYTES, true);
+    inline constexpr Layout SINGLE_VOICE_LAYOUT = makeLayout(SINGLE_OSC, SINGLE_OSC_BYTES, false);
+
+    static_assert(BULK_LAYOUT[DX7Voice::N_PARAMS - 1].offset == BULK_VOICE_BYTES - 1,
+                  "Bulk layout must fill exactly 128 bytes per voice");
+    static_assert(SINGLE_VOICE_LAYOUT[DX7Voice::N_PARAMS - 1].offset == SINGLE_VOICE_PAYLOAD_BYTES - 1,
+                  "Single voice layout must fill exactly 155 bytes");
+}
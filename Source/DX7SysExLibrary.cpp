@@ -0,0 +1,156 @@
+#include "DX7SysExLibrary.h"
+#include "DX7VoiceValidator.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    // FNV-1a over a voice's parameter bytes, for spotting duplicates
+    uint64_t hashVoice(const uint8_t* parameters)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+            hash = (hash ^ parameters[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+DX7SysExLibrary::ScanStats DX7SysExLibrary::scanDirectory(const juce::File& directory, const Options& options)
+{
+    // Sorted so the voice order doesn't depend on the order the filesystem lists files in
+    auto found = directory.findChildFiles(juce::File::findFiles, true, "*.syx;*.SYX");
+    std::vector<juce::File> syxFiles(found.begin(), found.end());
+    std::sort(syxFiles.begin(), syxFiles.end(), [](const juce::File& a, const juce::File& b) {
+        return a.getFullPathName() < b.getFullPathName();
+    });
+
+    return scanFiles(syxFiles, options);
+}
+
+DX7SysExLibrary::ScanStats DX7SysExLibrary::scanFiles(const std::vector<juce::File>& filesToScan, const Options& options)
+{
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+    clear();
+    files = filesToScan;
+
+    std::vector<FileResult> results(files.size());
+    std::atomic<size_t> nextFile{0};
+
+    // Files are claimed one at a time, so a few large ones don't hold up a thread
+    // while the others sit idle
+    auto scanNext = [&] {
+        for (size_t i = nextFile.fetch_add(1); i < files.size(); i = nextFile.fetch_add(1)) {
+            scanFile(files[i], options, results[i]);
+        }
+    };
+
+    const int hardwareThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const int numThreads = std::min(options.numThreads > 0 ? options.numThreads : hardwareThreads,
+                                    static_cast<int>(std::max<size_t>(1, files.size())));
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < numThreads; ++i) {
+        threads.emplace_back(scanNext);
+    }
+    scanNext();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto stats = merge(results, options);
+    stats.elapsedMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+
+    // The numbers are all in the returned stats; this is only for debugging
+    DBG("DX7SysExLibrary: Read " << voices.size() << " voices from " << stats.filesWithVoices << " of "
+        << stats.filesScanned << " files in " << stats.elapsedMs << " ms using " << numThreads << " threads ("
+        << stats.duplicatesSkipped << " duplicates skipped, " << stats.voicesRepaired << " repaired)");
+
+    for (int s = 1; s < DX7SysExReader::NUM_STATUSES; ++s) {
+        if (stats.messages[s] > 0) {
+            DBG("DX7SysExLibrary: " << stats.messages[s] << " messages rejected: "
+                << DX7SysExReader::getStatusName(static_cast<DX7SysExReader::Status>(s)));
+        }
+    }
+
+    return stats;
+}
+
+void DX7SysExLibrary::scanFile(const juce::File& file, const Options& options, FileResult& result)
+{
+    // Mapped rather than read: the parser works straight from the page cache
+    juce::MemoryMappedFile mapping(file, juce::MemoryMappedFile::readOnly, false);
+    if (mapping.getData() == nullptr) {
+        return;
+    }
+
+    result.readable = true;
+    result.summary = DX7SysExReader::readAll(static_cast<const uint8_t*>(mapping.getData()), mapping.getSize(),
+                                             result.voices, options.checkChecksums);
+
+    if (options.repairVoices) {
+        result.voicesRepaired = static_cast<int>(DX7VoiceValidator::clamp(result.voices.data(), result.voices.size()).size());
+    }
+}
+
+DX7SysExLibrary::ScanStats DX7SysExLibrary::merge(std::vector<FileResult>& results, const Options& options)
+{
+    ScanStats stats;
+    stats.filesScanned = static_cast<int>(results.size());
+
+    int total = 0;
+    for (const auto& result : results) {
+        total += result.voices.size();
+    }
+    voices.reserve(total);
+    sources.reserve(static_cast<size_t>(total));
+
+    // Hash of each kept voice to its index; a hash match is confirmed byte for byte
+    std::unordered_map<uint64_t, int> seen;
+    if (options.skipDuplicates) {
+        seen.reserve(static_cast<size_t>(total));
+    }
+
+    for (size_t f = 0; f < results.size(); ++f) {
+        auto& result = results[f];
+
+        stats.filesUnreadable += result.readable ? 0 : 1;
+        stats.filesWithVoices += result.voices.empty() ? 0 : 1;
+        stats.voicesFound += result.voices.size();
+        stats.voicesRepaired += result.voicesRepaired;
+        for (int s = 0; s < DX7SysExReader::NUM_STATUSES; ++s) {
+            stats.messages[s] += result.summary.messages[s];
+        }
+
+        for (int v = 0; v < result.voices.size(); ++v) {
+            const uint8_t* parameters = result.voices.voiceData(v);
+
+            if (options.skipDuplicates) {
+                auto inserted = seen.emplace(hashVoice(parameters), voices.size());
+                if (!inserted.second
+                    && std::memcmp(voices.voiceData(inserted.first->second), parameters, DX7Voice::N_PARAMS) == 0) {
+                    ++stats.duplicatesSkipped;
+                    continue;
+                }
+            }
+
+            voices.append(result.voices, v, 1);
+            sources.push_back({ static_cast<uint32_t>(f), static_cast<uint32_t>(v) });
+        }
+
+        // Done with this file's share
+        result.voices = DX7VoiceBank();
+    }
+
+    return stats;
+}
+
+void DX7SysExLibrary::clear()
+{
+    files.clear();
+    voices.clear();
+    sources.clear();
+}
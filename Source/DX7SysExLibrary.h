@@ -0,0 +1,77 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "DX7SysExReader.h"
+#include "DX7VoiceBank.h"
+
+// A patch library read from .syx files into one compact voice table, e.g. for
+// comparing generated voices against existing ones.
+//
+// Every voice is N_PARAMS bytes in a single DX7VoiceBank, plus an 8-byte record
+// of the file and slot it came from. Scanning maps each file read-only and
+// decodes it with DX7SysExReader on a pool of threads, one file at a time per
+// thread; results are merged in file order, so a scan is deterministic however
+// the files were split between threads.
+class DX7SysExLibrary
+{
+public:
+    struct Options
+    {
+        int numThreads = 0;          // 0 = one per hardware thread
+        bool checkChecksums = true;  // some old cartridges were saved with bad checksums
+        bool repairVoices = true;    // clamp out-of-range fields with DX7VoiceValidator
+        bool skipDuplicates = true;  // keep only the first copy of identical voices
+    };
+
+    struct ScanStats
+    {
+        int filesScanned = 0;
+        int filesWithVoices = 0;
+        int filesUnreadable = 0;
+        int voicesFound = 0;
+        int voicesRepaired = 0;
+        int duplicatesSkipped = 0;
+        std::array<int, DX7SysExReader::NUM_STATUSES> messages{}; // per DX7SysExReader::Status
+        double elapsedMs = 0.0;
+    };
+
+    // Where a voice came from: the file and its position among that file's voices
+    struct VoiceSource
+    {
+        uint32_t fileIndex = 0;
+        uint32_t voiceIndex = 0;
+    };
+
+    // Replace the library with the voices in every .syx file under directory
+    ScanStats scanDirectory(const juce::File& directory, const Options& options);
+    ScanStats scanFiles(const std::vector<juce::File>& files, const Options& options);
+    void clear();
+
+    int size() const { return voices.size(); }
+    bool empty() const { return voices.empty(); }
+
+    const DX7VoiceBank& getVoices() const { return voices; }
+    DX7VoiceView operator[](int index) const { return voices[index]; }
+    const VoiceSource& getSource(int index) const { return sources[static_cast<size_t>(index)]; }
+    const juce::File& getFile(uint32_t fileIndex) const { return files[fileIndex]; }
+
+private:
+    // One file's share of a scan, filled by whichever thread picked it up
+    struct FileResult
+    {
+        DX7VoiceBank voices;
+        DX7SysExReader::Summary summary;
+        int voicesRepaired = 0;
+        bool readable = false;
+    };
+
+    static void scanFile(const juce::File& file, const Options& options, FileResult& result);
+    ScanStats merge(std::vector<FileResult>& results, const Options& options);
+
+    std::vector<juce::File> files;
+    DX7VoiceBank voices;
+    std::vector<VoiceSource> sources;
+};
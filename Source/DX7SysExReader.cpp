@@ -0,0 +1,281 @@
+#include "DX7SysExReader.h"
+#include "DX7SysExWriter.h"
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    using DX7SysExLayout::BULK_LAYOUT;
+    using DX7SysExLayout::SINGLE_VOICE_LAYOUT;
+    using Layout = DX7SysExLayout::Layout;
+    using Status = DX7SysExReader::Status;
+    constexpr size_t HEADER_BYTES = DX7SysExWriter::HEADER_BYTES;
+    constexpr size_t BULK_VOICE_BYTES = DX7SysExWriter::BULK_VOICE_BYTES;
+
+    constexpr uint8_t FORMAT_SINGLE_VOICE = 0x00;
+    constexpr uint8_t FORMAT_BULK = 0x09;
+
+    // Most parameters have a data byte to themselves, and in both layouts they
+    // come in runs that are contiguous in the voice and in the packed data. Each
+    // run is unpacked with one fixed-size copy; only the bit-packed fields are
+    // decoded one by one.
+    struct Run
+    {
+        uint8_t parameter;
+        uint8_t offset;
+        uint8_t length;
+    };
+
+    constexpr bool isWholeByte(const DX7SysExLayout::Field& field)
+    {
+        return field.shift == 0 && field.mask == 0x7F;
+    }
+
+    constexpr bool startsRun(const Layout& layout, int i)
+    {
+        return isWholeByte(layout[i])
+            && (i == 0 || !isWholeByte(layout[i - 1]) || layout[i - 1].offset + 1 != layout[i].offset);
+    }
+
+    template <const Layout& LAYOUT>
+    constexpr int countRuns()
+    {
+        int count = 0;
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+            count += startsRun(LAYOUT, i) ? 1 : 0;
+        }
+        return count;
+    }
+
+    template <const Layout& LAYOUT>
+    constexpr int countPackedFields()
+    {
+        int count = 0;
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+            count += isWholeByte(LAYOUT[i]) ? 0 : 1;
+        }
+        return count;
+    }
+
+    template <const Layout& LAYOUT>
+    constexpr std::array<Run, countRuns<LAYOUT>()> makeRuns()
+    {
+        std::array<Run, countRuns<LAYOUT>()> runs{};
+        int count = 0;
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+            if (startsRun(LAYOUT, i)) {
+                runs[count++] = { static_cast<uint8_t>(i), LAYOUT[i].offset, 1 };
+            } else if (isWholeByte(LAYOUT[i])) {
+                ++runs[count - 1].length;
+            }
+        }
+        return runs;
+    }
+
+    template <const Layout& LAYOUT>
+    constexpr std::array<uint8_t, countPackedFields<LAYOUT>()> makePackedFields()
+    {
+        std::array<uint8_t, countPackedFields<LAYOUT>()> fields{};
+        int count = 0;
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+            if (!isWholeByte(LAYOUT[i])) {
+                fields[count++] = static_cast<uint8_t>(i);
+            }
+        }
+        return fields;
+    }
+
+    template <const Layout& LAYOUT>
+    struct Unpacker
+    {
+        static constexpr auto RUNS = makeRuns<LAYOUT>();
+        static constexpr auto FIELDS = makePackedFields<LAYOUT>();
+
+        template <size_t... R, size_t... F>
+        static void read(const uint8_t* packed, uint8_t* params, std::index_sequence<R...>, std::index_sequence<F...>)
+        {
+            (std::memcpy(params + RUNS[R].parameter, packed + RUNS[R].offset, RUNS[R].length), ...);
+            ((params[FIELDS[F]] = static_cast<uint8_t>((packed[LAYOUT[FIELDS[F]].offset] >> LAYOUT[FIELDS[F]].shift)
+                                                       & LAYOUT[FIELDS[F]].mask)), ...);
+        }
+    };
+
+    template <const Layout& LAYOUT>
+    void readVoice(const uint8_t* packed, uint8_t* parameters)
+    {
+        using U = Unpacker<LAYOUT>;
+        U::read(packed, parameters, std::make_index_sequence<U::RUNS.size()>{}, std::make_index_sequence<U::FIELDS.size()>{});
+    }
+
+    // Checks everything after the header: the F7, the data bytes and the checksum
+    Status checkBody(const uint8_t* data, size_t size, size_t payloadBytes, bool checkChecksum)
+    {
+        const size_t messageBytes = HEADER_BYTES + payloadBytes + 2;
+        if (size < messageBytes) {
+            return Status::TRUNCATED;
+        }
+        if (data[messageBytes - 1] != 0xF7) {
+            return Status::MISSING_END;
+        }
+
+        // Payload and checksum byte together; a valid message sums to 0 mod 128
+        const uint8_t* payload = data + HEADER_BYTES;
+        uint32_t sum = 0;
+        uint8_t highBits = 0;
+        for (size_t i = 0; i <= payloadBytes; ++i) {
+            sum += payload[i];
+            highBits |= payload[i];
+        }
+
+        if ((highBits & 0x80) != 0) {
+            return Status::BAD_DATA_BYTE;
+        }
+        if (checkChecksum && (sum & 0x7F) != 0) {
+            return Status::BAD_CHECKSUM;
+        }
+        return Status::OK;
+    }
+
+    Status readHeader(const uint8_t* data, size_t size, uint8_t& format)
+    {
+        if (size == 0) {
+            return Status::TRUNCATED;
+        }
+        if (data[0] != 0xF0) {
+            return Status::NOT_SYSEX;
+        }
+        if (size < HEADER_BYTES) {
+            return Status::TRUNCATED;
+        }
+
+        // Yamaha, sub-status 0 (dump) on any channel, then one of the two voice formats
+        format = data[3];
+        if (data[1] != 0x43 || (data[2] & 0xF0) != 0x00
+            || (format != FORMAT_BULK && format != FORMAT_SINGLE_VOICE)) {
+            return Status::NOT_VOICE_DUMP;
+        }
+
+        const size_t byteCount = (static_cast<size_t>(data[4]) << 7) | data[5];
+        const size_t expected = format == FORMAT_BULK ? DX7SysExWriter::BULK_PAYLOAD_BYTES
+                                                      : DX7SysExWriter::SINGLE_VOICE_PAYLOAD_BYTES;
+        if (byteCount != expected) {
+            return Status::BAD_BYTE_COUNT;
+        }
+        return Status::OK;
+    }
+
+    Status readFormat(const uint8_t* data, size_t size, uint8_t format, DX7VoiceBank& bank, size_t& messageBytes,
+                      bool checkChecksum)
+    {
+        const bool bulk = format == FORMAT_BULK;
+        const size_t payloadBytes = bulk ? DX7SysExWriter::BULK_PAYLOAD_BYTES : DX7SysExWriter::SINGLE_VOICE_PAYLOAD_BYTES;
+
+        const Status status = checkBody(data, size, payloadBytes, checkChecksum);
+        if (status != Status::OK) {
+            return status;
+        }
+
+        const uint8_t* payload = data + HEADER_BYTES;
+        const int first = bank.size();
+
+        if (bulk) {
+            bank.resize(first + DX7SysExWriter::N_VOICES);
+            for (int i = 0; i < DX7SysExWriter::N_VOICES; ++i) {
+                readVoice<BULK_LAYOUT>(payload + i * BULK_VOICE_BYTES, bank.voiceData(first + i));
+            }
+        } else {
+            bank.resize(first + 1);
+            readVoice<SINGLE_VOICE_LAYOUT>(payload, bank.voiceData(first));
+        }
+
+        messageBytes = HEADER_BYTES + payloadBytes + 2;
+        return Status::OK;
+    }
+}
+
+DX7SysExReader::Status DX7SysExReader::readMessage(const uint8_t* data, size_t size, DX7VoiceBank& bank,
+                                                   size_t& messageBytes, bool checkChecksum)
+{
+    uint8_t format = 0;
+    const Status status = readHeader(data, size, format);
+    if (status != Status::OK) {
+        return status;
+    }
+    return readFormat(data, size, format, bank, messageBytes, checkChecksum);
+}
+
+DX7SysExReader::Status DX7SysExReader::readBulkDump(const uint8_t* data, size_t size, DX7VoiceBank& bank, bool checkChecksum)
+{
+    uint8_t format = 0;
+    const Status status = readHeader(data, size, format);
+    if (status != Status::OK) {
+        return status;
+    }
+    if (format != FORMAT_BULK) {
+        return Status::NOT_VOICE_DUMP;
+    }
+
+    size_t messageBytes = 0;
+    return readFormat(data, size, format, bank, messageBytes, checkChecksum);
+}
+
+DX7SysExReader::Status DX7SysExReader::readSingleVoice(const uint8_t* data, size_t size, DX7VoiceBank& bank, bool checkChecksum)
+{
+    uint8_t format = 0;
+    const Status status = readHeader(data, size, format);
+    if (status != Status::OK) {
+        return status;
+    }
+    if (format != FORMAT_SINGLE_VOICE) {
+        return Status::NOT_VOICE_DUMP;
+    }
+
+    size_t messageBytes = 0;
+    return readFormat(data, size, format, bank, messageBytes, checkChecksum);
+}
+
+DX7SysExReader::Summary DX7SysExReader::readAll(const uint8_t* data, size_t size, DX7VoiceBank& bank, bool checkChecksum)
+{
+    Summary summary;
+    const int first = bank.size();
+    size_t offset = 0;
+
+    while (offset < size) {
+        // Next start of message
+        const void* start = std::memchr(data + offset, 0xF0, size - offset);
+        if (start == nullptr) {
+            break;
+        }
+        offset = static_cast<size_t>(static_cast<const uint8_t*>(start) - data);
+
+        size_t messageBytes = 0;
+        const Status status = readMessage(data + offset, size - offset, bank, messageBytes, checkChecksum);
+        ++summary.messages[static_cast<int>(status)];
+
+        // A bad message is resynchronised on the next F0, which may sit inside it
+        offset += status == Status::OK ? messageBytes : 1;
+    }
+
+    summary.voices = bank.size() - first;
+    return summary;
+}
+
+void DX7SysExReader::readBulkVoice(const uint8_t* packed, uint8_t* parameters)
+{
+    readVoice<BULK_LAYOUT>(packed, parameters);
+}
+
+const char* DX7SysExReader::getStatusName(Status status)
+{
+    switch (status) {
+        case Status::OK: return "ok";
+        case Status::TRUNCATED: return "truncated";
+        case Status::NOT_SYSEX: return "not SysEx";
+        case Status::NOT_VOICE_DUMP: return "not a voice dump";
+        case Status::BAD_BYTE_COUNT: return "bad byte count";
+        case Status::MISSING_END: return "missing F7";
+        case Status::BAD_DATA_BYTE: return "bad data byte";
+        case Status::BAD_CHECKSUM: return "bad checksum";
+    }
+    return "?";
+}
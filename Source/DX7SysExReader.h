@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "DX7SysExLayout.h"
+#include "DX7VoiceBank.h"
+
+// Validating decoder for DX7 voice SysEx: 32-voice bulk dumps (format 9) and
+// single voice dumps (format 0), the inverse of DX7SysExWriter.
+//
+// A message is only decoded once its header, byte count, data bytes, checksum
+// and terminating F7 have all been checked, so a damaged message never adds
+// voices. Unpacking uses the same DX7SysExLayout tables as the writer, expanded
+// at compile time. Voices are returned exactly as stored: old cartridges often
+// hold values outside the documented ranges, and DX7VoiceValidator is the place
+// to check or clamp them.
+class DX7SysExReader
+{
+public:
+    enum class Status
+    {
+        OK,
+        TRUNCATED,          // the data ends before the message does
+        NOT_SYSEX,          // doesn't start with F0
+        NOT_VOICE_DUMP,     // another manufacturer, sub-status or format
+        BAD_BYTE_COUNT,     // the header's byte count doesn't match the format
+        MISSING_END,        // no F7 after the checksum
+        BAD_DATA_BYTE,      // a payload byte has its top bit set
+        BAD_CHECKSUM
+    };
+    static constexpr int NUM_STATUSES = 8;
+
+    // What readAll() found in a buffer, counted per message status
+    struct Summary
+    {
+        int voices = 0;
+        std::array<int, NUM_STATUSES> messages{};
+
+        int count(Status status) const { return messages[static_cast<int>(status)]; }
+    };
+
+    // Decodes the message starting at data[0] and appends its 32 or 1 voices to
+    // bank. On success messageBytes is the length of the message, F0 to F7.
+    // With checkChecksum false a bad checksum is ignored; everything else is
+    // still checked.
+    static Status readMessage(const uint8_t* data, size_t size, DX7VoiceBank& bank, size_t& messageBytes,
+                              bool checkChecksum = true);
+
+    // As readMessage(), but only accepting the one format
+    static Status readBulkDump(const uint8_t* data, size_t size, DX7VoiceBank& bank, bool checkChecksum = true);
+    static Status readSingleVoice(const uint8_t* data, size_t size, DX7VoiceBank& bank, bool checkChecksum = true);
+
+    // Every voice message in a buffer such as a whole .syx file, in order. Bytes
+    // between messages are skipped; other and damaged messages are counted and
+    // skipped.
+    static Summary readAll(const uint8_t* data, size_t size, DX7VoiceBank& bank, bool checkChecksum = true);
+
+    // One 128-byte packed bulk voice to its N_PARAMS parameter bytes
+    static void readBulkVoice(const uint8_t* packed, uint8_t* parameters);
+
+    static const char* getStatusName(Status status);
+};
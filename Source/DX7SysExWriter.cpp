@@ -0,0 +1,110 @@
+#include "DX7SysExWriter.h"
+#include "DX7VoiceValidator.h"
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    using DX7SysExLayout::BULK_LAYOUT;
+    using DX7SysExLayout::SINGLE_VOICE_LAYOUT;
+    using Layout = DX7SysExLayout::Layout;
+    constexpr size_t BULK_VOICE_BYTES = DX7SysExWriter::BULK_VOICE_BYTES;
+    constexpr size_t SINGLE_VOICE_PAYLOAD_BYTES = DX7SysExWriter::SINGLE_VOICE_PAYLOAD_BYTES;
+
+    // Writes every parameter of the voice through the layout and returns the byte sum.
+    // Fields sharing a byte occupy disjoint bits, so adding them is the same as OR-ing.
+    // The layout is a template argument and the parameter loop is expanded at compile
+    // time, so every field becomes a fixed mask, shift and store with no table lookups.
+    template <const Layout& LAYOUT, size_t BYTES, size_t... I>
+    uint32_t writeFields(const uint8_t* params, uint8_t* output, std::index_sequence<I...>)
+    {
+        uint8_t packed[BYTES] = {};
+        ((packed[LAYOUT[I].offset] |= static_cast<uint8_t>((params[I] & LAYOUT[I].mask) << LAYOUT[I].shift)), ...);
+
+        uint32_t sum = 0;
+        for (size_t i = 0; i < BYTES; ++i) {
+            sum += packed[i];
+        }
+        std::memcpy(output, packed, BYTES);
+        return sum;
+    }
+
+    template <const Layout& LAYOUT, size_t BYTES>
+    uint32_t writeVoice(const uint8_t* parameters, uint8_t* output)
+    {
+        return writeFields<LAYOUT, BYTES>(parameters, output, std::make_index_sequence<DX7Voice::N_PARAMS>{});
+    }
+
+    void writeHeader(uint8_t* output, uint8_t format, size_t payloadBytes)
+    {
+        output[0] = 0xF0;
+        output[1] = 0x43; // Yamaha ID
+        output[2] = 0x00; // Sub-status & channel
+        output[3] = format;
+        output[4] = static_cast<uint8_t>((payloadBytes >> 7) & 0x7F); // Byte count MS
+        output[5] = static_cast<uint8_t>(payloadBytes & 0x7F);        // Byte count LS
+    }
+}
+
+const DX7SysExWriter::Layout& DX7SysExWriter::getBulkLayout()
+{
+    return BULK_LAYOUT;
+}
+
+const DX7SysExWriter::Layout& DX7SysExWriter::getSingleVoiceLayout()
+{
+    return SINGLE_VOICE_LAYOUT;
+}
+
+uint32_t DX7SysExWriter::writeBulkVoice(const uint8_t* parameters, uint8_t* output)
+{
+    return writeVoice<BULK_LAYOUT, BULK_VOICE_BYTES>(parameters, output);
+}
+
+bool DX7SysExWriter::writeBulkPayload(const DX7VoiceBank& bank, uint8_t* payload, uint32_t& sum)
+{
+    if (!bank.isFullBank() || !DX7VoiceValidator::isValid(bank.data(), bank.size())) {
+        return false;
+    }
+
+    sum = 0;
+    for (int i = 0; i < bank.size(); ++i) {
+        sum += writeVoice<BULK_LAYOUT, BULK_VOICE_BYTES>(bank.voiceData(i), payload + i * BULK_VOICE_BYTES);
+    }
+    return true;
+}
+
+bool DX7SysExWriter::writeBulkDump(const DX7VoiceBank& bank, BulkDump& output)
+{
+    uint32_t sum = 0;
+    if (!writeBulkPayload(bank, output.data() + HEADER_BYTES, sum)) {
+        return false;
+    }
+
+    writeHeader(output.data(), 0x09, BULK_PAYLOAD_BYTES); // Format 9: 32 voices
+    output[HEADER_BYTES + BULK_PAYLOAD_BYTES] = checksumFromSum(sum);
+    output[BULK_DUMP_BYTES - 1] = 0xF7;
+    return true;
+}
+
+bool DX7SysExWriter::writeSingleVoice(const DX7VoiceView& voice, SingleVoiceDump& output)
+{
+    if (!DX7VoiceValidator::isValid(voice.data(), 1)) {
+        return false;
+    }
+
+    writeHeader(output.data(), 0x00, SINGLE_VOICE_PAYLOAD_BYTES); // Format 0: 1 voice
+
+    const uint32_t sum = writeVoice<SINGLE_VOICE_LAYOUT, SINGLE_VOICE_PAYLOAD_BYTES>(voice.data(), output.data() + HEADER_BYTES);
+
+    output[HEADER_BYTES + SINGLE_VOICE_PAYLOAD_BYTES] = checksumFromSum(sum);
+    output[SINGLE_VOICE_BYTES - 1] = 0xF7;
+    return true;
+}
+
+bool DX7SysExWriter::writeSingleVoice(const DX7Voice& voice, SingleVoiceDump& output)
+{
+    uint8_t parameters[DX7Voice::N_PARAMS];
+    voice.toParameterBytes(parameters);
+    return writeSingleVoice(DX7VoiceView(parameters), output);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "DX7Voice.h"
+#include "DX7SysExLayout.h"
+#include "DX7VoiceBank.h"
+
+// Allocation-free SysEx encoder for single voices and 32-voice bulk dumps.
+//
+// Both formats are described by the compile-time tables in DX7SysExLayout: for
+// every one of a voice's DX7Voice::N_PARAMS parameters (bulk dump ordering), the
+// byte it lands in within the packed voice, its bit shift and its mask. The
+// tables are template arguments to the packing code, so each
+// field compiles to a fixed mask, shift and store, and the checksum is summed
+// voice by voice as they are written. Each message is produced in one pass into
+// a caller-provided fixed-size buffer, with no allocation.
+class DX7SysExWriter
+{
+public:
+    static constexpr int N_VOICES = 32;
+    static constexpr size_t HEADER_BYTES = 6;
+
+    static constexpr size_t BULK_VOICE_BYTES = DX7SysExLayout::BULK_VOICE_BYTES;
+    static constexpr size_t BULK_PAYLOAD_BYTES = N_VOICES * BULK_VOICE_BYTES; // 4096
+    static constexpr size_t BULK_DUMP_BYTES = HEADER_BYTES + BULK_PAYLOAD_BYTES + 2;
+
+    static constexpr size_t SINGLE_VOICE_PAYLOAD_BYTES = DX7SysExLayout::SINGLE_VOICE_PAYLOAD_BYTES; // 155
+    static constexpr size_t SINGLE_VOICE_BYTES = HEADER_BYTES + SINGLE_VOICE_PAYLOAD_BYTES + 2;
+
+    using BulkDump = std::array<uint8_t, BULK_DUMP_BYTES>;
+    using SingleVoiceDump = std::array<uint8_t, SINGLE_VOICE_BYTES>;
+
+    using Field = DX7SysExLayout::Field;
+    using Layout = DX7SysExLayout::Layout;
+
+    static const Layout& getBulkLayout();
+    static const Layout& getSingleVoiceLayout();
+
+    // Fill the whole buffer, F0 to F7. A bank that isn't full, or a voice outside
+    // DX7VoiceValidator's ranges, makes the call return false, and the buffer
+    // contents are then unspecified. Nothing is logged; a caller that wants to
+    // report the bad voice can find it with DX7VoiceValidator::findInvalidVoice.
+    static bool writeBulkDump(const DX7VoiceBank& bank, BulkDump& output);
+    static bool writeSingleVoice(const DX7VoiceView& voice, SingleVoiceDump& output);
+    static bool writeSingleVoice(const DX7Voice& voice, SingleVoiceDump& output);
+
+    // Just the BULK_PAYLOAD_BYTES of packed voices, with the sum of the bytes written
+    static bool writeBulkPayload(const DX7VoiceBank& bank, uint8_t* payload, uint32_t& sum);
+
+    // One voice's N_PARAMS parameter bytes in the 128-byte packed bulk form;
+    // returns the sum of the bytes written
+    static uint32_t writeBulkVoice(const uint8_t* parameters, uint8_t* output);
+
+    static uint8_t checksumFromSum(uint32_t sum) { return static_cast<uint8_t>((128 - (sum & 127)) & 127); }
+};
@@ -1,17 +1,19 @@
 #pragma once
 
-#include <vector>
 #include <array>
 #include <cstdint>
+#include <memory>
 
-// Forward declaration
-namespace at { class Tensor; }
-namespace torch { using Tensor = at::Tensor; }
+class DX7Voice;
+
+// Voices handed between threads and out of caches are shared, never copied
+using DX7VoiceHandle = std::shared_ptr<const DX7Voice>;
 
 class DX7Voice
 {
 public:
     static constexpr int N_OSC = 6;
+    static constexpr int N_PARAMS = 155; // 6 * 21 oscillator + 29 global, bulk dump ordering
     
     DX7Voice(const std::array<std::array<uint8_t, 21>, N_OSC>& oscillators, 
              const std::array<uint8_t, 29>& global);
@@ -22,10 +24,14 @@ public:
     void setOscillators(const std::array<std::array<uint8_t, 21>, N_OSC>& oscillators);
     void setGlobal(const std::array<uint8_t, 29>& global);
     
-    static DX7Voice fromParameters(const std::vector<int>& parameters);
-    static std::vector<int> logitsToParameters(const torch::Tensor& logits);
+    // Raw N_PARAMS-byte form in bulk dump ordering: the 6 oscillators' 21
+    // parameters each, then the 29 global ones
+    static DX7Voice fromParameterBytes(const uint8_t* parameters);
+    void toParameterBytes(uint8_t* parameters) const;
     
+    // Nothing is logged; callers that want to report a bad voice use the index
     bool validate() const;
+    int findInvalidParameter() const; // First out-of-range parameter, or -1
     
 private:
     std::array<std::array<uint8_t, 21>, N_OSC> oscillators;
@@ -0,0 +1,52 @@
+#include "DX7VoiceBank.h"
+#include "DX7SysExWriter.h"
+#include <algorithm>
+
+DX7VoiceBank::DX7VoiceBank(int numVoices)
+    : parameters(static_cast<size_t>(std::max(0, numVoices)) * DX7Voice::N_PARAMS, 0)
+{
+}
+
+DX7VoiceBank DX7VoiceBank::fromVoices(const std::vector<DX7Voice>& voices)
+{
+    DX7VoiceBank bank(static_cast<int>(voices.size()));
+    for (size_t i = 0; i < voices.size(); ++i) {
+        bank.setVoice(static_cast<int>(i), voices[i]);
+    }
+    return bank;
+}
+
+void DX7VoiceBank::append(const DX7Voice& voice)
+{
+    const int index = size();
+    resize(index + 1);
+    setVoice(index, voice);
+}
+
+void DX7VoiceBank::append(const DX7VoiceBank& other, int first, int count)
+{
+    parameters.insert(parameters.end(), other.voiceData(first), other.voiceData(first + count));
+}
+
+DX7VoiceBank DX7VoiceBank::slice(int first, int count) const
+{
+    DX7VoiceBank bank;
+    bank.append(*this, first, count);
+    return bank;
+}
+
+std::vector<DX7Voice> DX7VoiceBank::toVoices() const
+{
+    std::vector<DX7Voice> voices;
+    voices.reserve(size());
+    for (int i = 0; i < size(); ++i) {
+        voices.push_back((*this)[i].toVoice());
+    }
+    return voices;
+}
+
+bool DX7VoiceBank::writeBulkPayload(uint8_t* payload) const
+{
+    uint32_t sum = 0;
+    return DX7SysExWriter::writeBulkPayload(*this, payload, sum);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "DX7Voice.h"
+
+// Read-only view of one voice inside a DX7VoiceBank: its N_PARAMS parameter
+// bytes in bulk dump ordering (6 x 21 oscillator, then 29 global). Only valid
+// while the bank it came from is alive and unchanged.
+class DX7VoiceView
+{
+public:
+    static constexpr int OSC_PARAMS = 21;
+    static constexpr int GLOBAL_PARAMS = 29;
+
+    explicit DX7VoiceView(const uint8_t* parameters) : parameters(parameters) {}
+
+    const uint8_t* data() const { return parameters; }
+    uint8_t operator[](int index) const { return parameters[index]; }
+    const uint8_t* oscillator(int osc) const { return parameters + osc * OSC_PARAMS; }
+    const uint8_t* global() const { return parameters + DX7Voice::N_OSC * OSC_PARAMS; }
+
+    DX7Voice toVoice() const { return DX7Voice::fromParameterBytes(parameters); }
+
+private:
+    const uint8_t* parameters;
+};
+
+class DX7VoiceBank;
+
+// Finished banks travel as shared immutable handles: handing one on costs a
+// reference count, and no holder can change it under another
+using DX7VoiceBankHandle = std::shared_ptr<const DX7VoiceBank>;
+
+// A batch of voices stored as one contiguous block of N_PARAMS-byte rows, the
+// layout the decoders write and the SysEx writer and validator read. Decoded
+// voices go into a bank without being split into per-voice objects, and
+// indexing hands out views into the block rather than copies.
+//
+// A full bank (N_VOICES voices) is what a DX7 bulk dump carries; other sizes are
+// used for single voices and prefetch batches.
+class DX7VoiceBank
+{
+public:
+    static constexpr int N_VOICES = 32;
+
+    DX7VoiceBank() = default;
+    explicit DX7VoiceBank(int numVoices); // All parameters zero
+    static DX7VoiceBank fromVoices(const std::vector<DX7Voice>& voices);
+
+    int size() const { return static_cast<int>(parameters.size() / DX7Voice::N_PARAMS); }
+    bool empty() const { return parameters.empty(); }
+    bool isFullBank() const { return size() == N_VOICES; }
+
+    // size() * N_PARAMS bytes, voice after voice
+    uint8_t* data() { return parameters.data(); }
+    const uint8_t* data() const { return parameters.data(); }
+    size_t sizeInBytes() const { return parameters.size(); }
+
+    DX7VoiceView operator[](int index) const { return DX7VoiceView(voiceData(index)); }
+    uint8_t* voiceData(int index) { return parameters.data() + static_cast<size_t>(index) * DX7Voice::N_PARAMS; }
+    const uint8_t* voiceData(int index) const { return parameters.data() + static_cast<size_t>(index) * DX7Voice::N_PARAMS; }
+
+    void setVoice(int index, const DX7Voice& voice) { voice.toParameterBytes(voiceData(index)); }
+    void append(const DX7Voice& voice);
+    void append(const DX7VoiceBank& other, int first, int count);
+    void resize(int numVoices) { parameters.resize(static_cast<size_t>(numVoices) * DX7Voice::N_PARAMS); }
+    void reserve(int numVoices) { parameters.reserve(static_cast<size_t>(numVoices) * DX7Voice::N_PARAMS); }
+    void clear() { parameters.clear(); }
+
+    // Voices [first, first + count) as a bank of their own
+    DX7VoiceBank slice(int first, int count) const;
+    std::vector<DX7Voice> toVoices() const;
+
+    // The 4096-byte packed payload of a bulk dump (no header or checksum).
+    // Returns false unless this is a full, valid bank.
+    bool writeBulkPayload(uint8_t* payload) const;
+
+private:
+    std::vector<uint8_t> parameters;
+};
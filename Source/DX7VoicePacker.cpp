@@ -1,4 +1,7 @@
 #include "DX7VoicePacker.h"
+#include "DX7SysExReader.h"
+#include "DX7SysExWriter.h"
+#include "DX7VoiceValidator.h"
 #include <algorithm>
 #include <numeric>
 #include <iostream>
@@ -10,33 +13,12 @@ std::vector<uint8_t> DX7VoicePacker::packSingleVoice(const DX7Voice& voice)
         return {};
     }
     
-    std::vector<uint8_t> result;
-    result.reserve(VOICE_PARAM_COUNT + 8);
-    
-    // SysEx header for single voice
-    result.push_back(0xF0);
-    result.push_back(0x43);  // Yamaha ID
-    result.push_back(0x00);  // Sub-status & channel
-    result.push_back(0x00);  // Format number (1 voice)
-    result.push_back(0x01);  // Byte count MS
-    result.push_back(0x1B);  // Byte count LS (155 bytes)
-    
-    // Pack oscillators in single voice format (6 oscillators * 21 bytes each = 126 bytes)
-    for (const auto& osc : voice.getOscillators()) {
-        packSingleVoiceOscillator(osc, result);
+    DX7SysExWriter::SingleVoiceDump dump;
+    if (!DX7SysExWriter::writeSingleVoice(voice, dump)) {
+        return {};
     }
     
-    // Pack global parameters in single voice format (29 bytes)
-    packSingleVoiceGlobal(voice.getGlobal(), result);
-    
-    // Calculate and add checksum
-    uint8_t checksum = calculateChecksum(std::vector<uint8_t>(result.begin() + 6, result.end()));
-    result.push_back(checksum);
-    
-    // End SysEx
-    result.push_back(0xF7);
-    
-    return result;
+    return std::vector<uint8_t>(dump.begin(), dump.end());
 }
 
 void DX7VoicePacker::packOscillator(const std::array<uint8_t, 21>& osc, std::vector<uint8_t>& output)
@@ -99,123 +81,30 @@ void DX7VoicePacker::packGlobal(const std::array<uint8_t, 29>& global, std::vect
 
 DX7Voice DX7VoicePacker::unpackSingleVoice(const std::vector<uint8_t>& data)
 {
-    std::array<std::array<uint8_t, 21>, N_OSC> oscillators;
-    std::array<uint8_t, 29> global;
-    
-    // Initialize with zeros
-    for (auto& osc : oscillators) {
-        osc.fill(0);
-    }
-    global.fill(0);
-    
-    if (data.size() < VOICE_PARAM_COUNT + 8) {
-        return DX7Voice(oscillators, global);
-    }
-    
-    const uint8_t* voiceData = data.data() + 6; // Skip SysEx header
+    // Single voice dumps hold one parameter per byte in their own order, which
+    // DX7SysExReader maps back to DX7Voice ordering
+    DX7VoiceBank bank;
+    const auto status = DX7SysExReader::readSingleVoice(data.data(), data.size(), bank);
     
-    // Unpack oscillators
-    for (int i = 0; i < N_OSC; ++i) {
-        oscillators[i] = unpackOscillator(voiceData + i * 17);
+    if (status != DX7SysExReader::Status::OK) {
+        std::cerr << "Could not read single voice dump: " << DX7SysExReader::getStatusName(status) << std::endl;
+        return DX7Voice::fromParameterBytes(DX7VoiceBank(1).data());
     }
     
-    // Unpack global parameters
-    global = unpackGlobal(voiceData + N_OSC * 17);
-    
-    return DX7Voice(oscillators, global);
-}
-
-std::array<uint8_t, 21> DX7VoicePacker::unpackOscillator(const uint8_t* data)
-{
-    std::array<uint8_t, 21> osc;
-    
-    // R1-R4, L1-L4, BP, LD, RD
-    for (int i = 0; i < 11; ++i) {
-        osc[i] = data[i];
-    }
-    
-    // RC, LC
-    osc[11] = (data[11] >> 2) & 0x03;
-    osc[12] = data[11] & 0x03;
-    
-    // DET, RS
-    osc[13] = (data[12] >> 3) & 0x0F;
-    osc[14] = data[12] & 0x07;
-    
-    // KVS, AMS
-    osc[15] = (data[13] >> 2) & 0x07;
-    osc[16] = data[13] & 0x03;
-    
-    // OL
-    osc[17] = data[14];
-    
-    // FC, M
-    osc[18] = (data[15] >> 1) & 0x1F;
-    osc[19] = data[15] & 0x01;
-    
-    // FF
-    osc[20] = data[16];
-    
-    return osc;
-}
-
-std::array<uint8_t, 29> DX7VoicePacker::unpackGlobal(const uint8_t* data)
-{
-    std::array<uint8_t, 29> global;
-    
-    // PR1-PR4, PL1-PL4
-    for (int i = 0; i < 8; ++i) {
-        global[i] = data[i];
-    }
-    
-    // ALG
-    global[8] = data[8];
-    
-    // OKS, FB
-    global[9] = (data[9] >> 3) & 0x01;
-    global[10] = data[9] & 0x07;
-    
-    // LFS, LFD, LPMD, LAMD
-    for (int i = 11; i < 15; ++i) {
-        global[i] = data[i - 1];
-    }
-    
-    // LPMS, LFW, LKS
-    global[15] = (data[14] >> 4) & 0x07;
-    global[16] = (data[14] >> 1) & 0x07;
-    global[17] = data[14] & 0x01;
-    
-    // TRNSP
-    global[18] = data[15];
-    
-    // NAME
-    for (int i = 19; i < 29; ++i) {
-        global[i] = data[i - 3];
-    }
-    
-    return global;
+    return bank[0].toVoice();
 }
 
 bool DX7VoicePacker::validateParameters(const DX7Voice& voice)
 {
-    // Use DX7Voice's built-in validation
-    bool isValid = voice.validate();
-    if (!isValid) {
-        std::cerr << "Voice validation failed" << std::endl;
-        // Debug: print some parameter values
-        const auto& oscs = voice.getOscillators();
-        const auto& global = voice.getGlobal();
-        std::cerr << "Sample osc[0] params: ";
-        for (int i = 0; i < 5; ++i) {
-            std::cerr << (int)oscs[0][i] << " ";
-        }
-        std::cerr << "\nSample global params: ";
-        for (int i = 0; i < 5; ++i) {
-            std::cerr << (int)global[i] << " ";
-        }
-        std::cerr << std::endl;
-    }
-    return isValid;
+    const int invalid = voice.findInvalidParameter();
+    if (invalid >= 0) {
+        uint8_t parameters[DX7Voice::N_PARAMS];
+        voice.toParameterBytes(parameters);
+        std::cerr << "Voice validation failed: " << DX7VoiceValidator::getParameterName(invalid) << " = "
+                  << (int)parameters[invalid] << " > " << (int)DX7VoiceValidator::getMaxValues()[invalid] << std::endl;
+        return false;
+    }
+    return true;
 }
 
 uint8_t DX7VoicePacker::calculateChecksum(const std::vector<uint8_t>& data)
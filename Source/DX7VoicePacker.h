@@ -20,7 +20,9 @@ public:
         NAME_CHAR_6, NAME_CHAR_7, NAME_CHAR_8, NAME_CHAR_9, NAME_CHAR_10
     };
     
+    // Allocating convenience wrapper; DX7SysExWriter::writeSingleVoice fills a fixed buffer
     static std::vector<uint8_t> packSingleVoice(const DX7Voice& voice);
+    // All zeros if the data isn't a valid single voice dump; DX7SysExReader reports why
     static DX7Voice unpackSingleVoice(const std::vector<uint8_t>& data);
     
     static bool validateParameters(const DX7Voice& voice);
@@ -33,8 +35,4 @@ public:
     // Single voice unpacked format functions
     static void packSingleVoiceOscillator(const std::array<uint8_t, 21>& osc, std::vector<uint8_t>& output);
     static void packSingleVoiceGlobal(const std::array<uint8_t, 29>& global, std::vector<uint8_t>& output);
-    
-private:
-    static std::array<uint8_t, 21> unpackOscillator(const uint8_t* data);
-    static std::array<uint8_t, 29> unpackGlobal(const uint8_t* data);
 };
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "DX7VoiceValidator.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define DX7_VALIDATOR_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+ #include <arm_neon.h>
+ #define DX7_VALIDATOR_NEON 1
+#endif
+
+namespace
+{
+    constexpr int OSC_PARAMS = 21;
+    constexpr int GLOBAL_PARAMS = 29;
+
+    // Bulk dump osc order: R1,R2,R3,R4,L1,L2,L3,L4,BP,LD,RD,RC,LC,DET,RS,KVS,AMS,OL,FC,M,FF
+    constexpr uint8_t OSC_MAX[OSC_PARAMS] = {
+        99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 3, 3, 14, 7, 7, 3, 99, 31, 1, 99
+    };
+    constexpr const char* OSC_NAMES[OSC_PARAMS] = {
+        "R1", "R2", "R3", "R4", "L1", "L2", "L3", "L4", "BP", "LD", "RD",
+        "RC", "LC", "DET", "RS", "KVS", "AMS", "OL", "FC", "M", "FF"
+    };
+
+    // Bulk dump global order: PR1-PR4,PL1-PL4,ALG,OKS,FB,LFS,LFD,LPMD,LAMD,LPMS,LFW,LKS,TRNSP,NAME1-10.
+    // Name characters only need to fit in a SysEx data byte.
+    constexpr int NAME_START = 19;
+    constexpr uint8_t GLOBAL_MAX[GLOBAL_PARAMS] = {
+        99, 99, 99, 99, 99, 99, 99, 99, 31, 1, 7, 99, 99, 99, 99, 7, 5, 1, 48,
+        127, 127, 127, 127, 127, 127, 127, 127, 127, 127
+    };
+    constexpr const char* GLOBAL_NAMES[NAME_START] = {
+        "PR1", "PR2", "PR3", "PR4", "PL1", "PL2", "PL3", "PL4", "ALG", "OKS", "FB",
+        "LFS", "LFD", "LPMD", "LAMD", "LPMS", "LFW", "LKS", "TRNSP"
+    };
+
+    constexpr DX7VoiceValidator::Ranges makeMaxValues()
+    {
+        DX7VoiceValidator::Ranges ranges{};
+        int index = 0;
+        for (int o = 0; o < DX7Voice::N_OSC; ++o) {
+            for (int p = 0; p < OSC_PARAMS; ++p) {
+                ranges[index++] = OSC_MAX[p];
+            }
+        }
+        for (int p = 0; p < GLOBAL_PARAMS; ++p) {
+            ranges[index++] = GLOBAL_MAX[p];
+        }
+        return ranges;
+    }
+
+    constexpr DX7VoiceValidator::Ranges MAX_VALUES = makeMaxValues();
+
+#if DX7_VALIDATOR_SSE2 || DX7_VALIDATOR_NEON
+    // A voice is nine full 16-byte chunks plus one more that overlaps the ninth,
+    // so every load stays inside the voice without padding
+    constexpr int CHUNK_BYTES = 16;
+    constexpr int CHUNK_OFFSETS[] = { 0, 16, 32, 48, 64, 80, 96, 112, 128, DX7Voice::N_PARAMS - CHUNK_BYTES };
+    static_assert(DX7Voice::N_PARAMS - CHUNK_BYTES <= 128 + CHUNK_BYTES, "Chunks must cover the whole voice");
+#endif
+
+    bool voiceInRange(const uint8_t* voice)
+    {
+#if DX7_VALIDATOR_SSE2
+        __m128i inRange = _mm_set1_epi8(-1);
+        for (int offset : CHUNK_OFFSETS) {
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(voice + offset));
+            const __m128i limits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(MAX_VALUES.data() + offset));
+            inRange = _mm_and_si128(inRange, _mm_cmpeq_epi8(_mm_min_epu8(values, limits), values));
+        }
+        return _mm_movemask_epi8(inRange) == 0xFFFF;
+#elif DX7_VALIDATOR_NEON
+        uint8x16_t inRange = vdupq_n_u8(0xFF);
+        for (int offset : CHUNK_OFFSETS) {
+            const uint8x16_t values = vld1q_u8(voice + offset);
+            inRange = vandq_u8(inRange, vcleq_u8(values, vld1q_u8(MAX_VALUES.data() + offset)));
+        }
+        return vminvq_u8(inRange) == 0xFF;
+#else
+        uint8_t outOfRange = 0;
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+            outOfRange |= static_cast<uint8_t>(voice[i] > MAX_VALUES[i]);
+        }
+        return outOfRange == 0;
+#endif
+    }
+}
+
+const DX7VoiceValidator::Ranges& DX7VoiceValidator::getMaxValues()
+{
+    return MAX_VALUES;
+}
+
+std::string DX7VoiceValidator::getParameterName(int index)
+{
+    if (index < 0 || index >= DX7Voice::N_PARAMS) {
+        return "?";
+    }
+
+    constexpr int oscParams = DX7Voice::N_OSC * OSC_PARAMS;
+    if (index < oscParams) {
+        return "Osc " + std::to_string(index / OSC_PARAMS) + " " + OSC_NAMES[index % OSC_PARAMS];
+    }
+
+    const int globalIndex = index - oscParams;
+    if (globalIndex < NAME_START) {
+        return GLOBAL_NAMES[globalIndex];
+    }
+    return "NAME" + std::to_string(globalIndex - NAME_START + 1);
+}
+
+bool DX7VoiceValidator::isValid(const uint8_t* parameters, int numVoices)
+{
+    return findInvalidVoice(parameters, numVoices) < 0;
+}
+
+int DX7VoiceValidator::findInvalidVoice(const uint8_t* parameters, int numVoices)
+{
+    for (int v = 0; v < numVoices; ++v) {
+        if (!voiceInRange(parameters + static_cast<size_t>(v) * DX7Voice::N_PARAMS)) {
+            return v;
+        }
+    }
+    return -1;
+}
+
+int DX7VoiceValidator::findInvalidParameter(const uint8_t* parameters)
+{
+    if (voiceInRange(parameters)) {
+        return -1;
+    }
+    for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+        if (parameters[i] > MAX_VALUES[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+std::vector<DX7VoiceValidator::VoiceRepair> DX7VoiceValidator::clamp(uint8_t* parameters, int numVoices)
+{
+    std::vector<VoiceRepair> repairs;
+
+    for (int v = 0; v < numVoices; ++v) {
+        uint8_t* voice = parameters + static_cast<size_t>(v) * DX7Voice::N_PARAMS;
+        if (voiceInRange(voice)) {
+            continue;
+        }
+
+        VoiceRepair repair;
+        repair.voiceIndex = v;
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+            if (voice[i] > MAX_VALUES[i]) {
+                repair.fields.set(static_cast<size_t>(i));
+                voice[i] = MAX_VALUES[i];
+            }
+        }
+        repairs.push_back(repair);
+    }
+
+    return repairs;
+}
+
+std::bitset<DX7Voice::N_PARAMS> DX7VoiceValidator::clamp(DX7Voice& voice)
+{
+    uint8_t parameters[DX7Voice::N_PARAMS];
+    voice.toParameterBytes(parameters);
+
+    const auto repairs = clamp(parameters, 1);
+    if (repairs.empty()) {
+        return {};
+    }
+
+    voice = DX7Voice::fromParameterBytes(parameters);
+    return repairs.front().fields;
+}
+
+std::string DX7VoiceValidator::describe(const std::vector<VoiceRepair>& repairs)
+{
+    std::string text;
+    for (const auto& repair : repairs) {
+        text += "voice " + std::to_string(repair.voiceIndex) + ":";
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i) {
+            if (repair.fields.test(static_cast<size_t>(i))) {
+                text += " " + getParameterName(i);
+            }
+        }
+        text += "\n";
+    }
+    return text;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DX7Voice.h"
+
+// Range checking and repair for voices in raw parameter form.
+//
+// The legal range of every one of the DX7Voice::N_PARAMS parameters is a table
+// built at compile time from the DX7 parameter schema (all ranges start at 0).
+// Validation runs over whole batches of contiguous parameter bytes: each voice
+// is compared against the table 16 bytes at a time, and only a voice that is
+// out of range drops to the per-field repair loop. Repair clamps each bad field
+// to its maximum instead of rejecting the voice, so a single stray argmax never
+// costs a whole bank.
+class DX7VoiceValidator
+{
+public:
+    using Ranges = std::array<uint8_t, DX7Voice::N_PARAMS>;
+
+    // Which fields of one voice were clamped
+    struct VoiceRepair
+    {
+        int voiceIndex = 0;
+        std::bitset<DX7Voice::N_PARAMS> fields;
+    };
+
+    // Largest legal value of each parameter, bulk dump ordering
+    static const Ranges& getMaxValues();
+
+    // e.g. "Osc 3 DET" or "ALG"
+    static std::string getParameterName(int index);
+
+    // True if all numVoices voices (N_PARAMS bytes each) are in range
+    static bool isValid(const uint8_t* parameters, int numVoices);
+
+    // Index of the first voice with an out-of-range parameter, or -1
+    static int findInvalidVoice(const uint8_t* parameters, int numVoices);
+
+    // Index of the first out-of-range parameter of one voice, or -1
+    static int findInvalidParameter(const uint8_t* parameters);
+
+    // Clamp every out-of-range field in place. Returns one entry per repaired
+    // voice, so the common all-valid case returns an empty vector.
+    static std::vector<VoiceRepair> clamp(uint8_t* parameters, int numVoices);
+    static std::bitset<DX7Voice::N_PARAMS> clamp(DX7Voice& voice);
+
+    // One line per repaired voice, listing the clamped fields
+    static std::string describe(const std::vector<VoiceRepair>& repairs);
+};
@@ -1,40 +1,157 @@
 #include "EmbeddedModelLoader.h"
-#include "model_data.h"
-#include <iostream>
-#include <string>
-#include <juce_core/juce_core.h>
-
-std::vector<char> EmbeddedModelLoader::loadCompressedModel() {
-    extern unsigned char dx7_vae_model_pt_gz[];
-    extern unsigned int dx7_vae_model_pt_gz_len;
-    
-    try {
-        return decompressGzip(dx7_vae_model_pt_gz, dx7_vae_model_pt_gz_len);
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to decompress embedded model: " << e.what() << std::endl;
-        throw;
+
+// Set by embed_native_decoder() in CMakeLists.txt
+#ifndef NDX7_HAS_EMBEDDED_DECODER
+ #define NDX7_HAS_EMBEDDED_DECODER 0
+#endif
+
+#if defined(_MSC_VER)
+ // MSVC has no .incbin; CMake generates an xxd array of the uncompressed model instead
+ #include "model_data.h"
+ #if NDX7_HAS_EMBEDDED_DECODER
+  #include "decoder_data.h"
+ #endif
+#else
+ #if defined(__APPLE__)
+  #define NDX7_ASM_SYMBOL(name) "_" #name
+  #define NDX7_ASM_RODATA ".const_data"
+  #define NDX7_ASM_HIDDEN ".private_extern "
+ #else
+  #define NDX7_ASM_SYMBOL(name) #name
+  #define NDX7_ASM_RODATA ".section .rodata"
+  #define NDX7_ASM_HIDDEN ".hidden "
+ #endif
+
+// Page-aligned so the model's pages are mapped straight from the binary and
+// stay clean, shareable and reclaimable. The symbols are hidden: every plugin
+// binary has its own copy, and a host loading two of them must not bind one
+// plugin's model to the other's.
+__asm__(NDX7_ASM_RODATA "\n"
+        ".balign 4096\n"
+        ".globl " NDX7_ASM_SYMBOL(ndx7_embedded_model) "\n"
+        NDX7_ASM_HIDDEN NDX7_ASM_SYMBOL(ndx7_embedded_model) "\n"
+        NDX7_ASM_SYMBOL(ndx7_embedded_model) ":\n"
+        ".incbin \"" NDX7_EMBEDDED_MODEL_PATH "\"\n"
+        ".globl " NDX7_ASM_SYMBOL(ndx7_embedded_model_end) "\n"
+        NDX7_ASM_HIDDEN NDX7_ASM_SYMBOL(ndx7_embedded_model_end) "\n"
+        NDX7_ASM_SYMBOL(ndx7_embedded_model_end) ":\n"
+        ".byte 0\n"
+        ".text\n");
+
+extern "C" __attribute__((visibility("hidden"))) const char ndx7_embedded_model[];
+extern "C" __attribute__((visibility("hidden"))) const char ndx7_embedded_model_end[];
+
+ #if NDX7_HAS_EMBEDDED_DECODER
+// The native decoder's weights are copied out when it loads, so this only
+// needs the alignment of the floats in it
+__asm__(NDX7_ASM_RODATA "\n"
+        ".balign 64\n"
+        ".globl " NDX7_ASM_SYMBOL(ndx7_embedded_decoder) "\n"
+        NDX7_ASM_HIDDEN NDX7_ASM_SYMBOL(ndx7_embedded_decoder) "\n"
+        NDX7_ASM_SYMBOL(ndx7_embedded_decoder) ":\n"
+        ".incbin \"" NDX7_EMBEDDED_DECODER_PATH "\"\n"
+        ".globl " NDX7_ASM_SYMBOL(ndx7_embedded_decoder_end) "\n"
+        NDX7_ASM_HIDDEN NDX7_ASM_SYMBOL(ndx7_embedded_decoder_end) "\n"
+        NDX7_ASM_SYMBOL(ndx7_embedded_decoder_end) ":\n"
+        ".byte 0\n"
+        ".text\n");
+
+extern "C" __attribute__((visibility("hidden"))) const char ndx7_embedded_decoder[];
+extern "C" __attribute__((visibility("hidden"))) const char ndx7_embedded_decoder_end[];
+ #endif
+#endif
+
+#if defined(_WIN32)
+ #include <windows.h>
+ #include <psapi.h>
+#else
+ #include <sys/resource.h>
+#endif
+
+const char* EmbeddedModelLoader::getModelData() {
+#if defined(_MSC_VER)
+    return reinterpret_cast<const char*>(dx7_vae_model_pt);
+#else
+    return ndx7_embedded_model;
+#endif
+}
+
+size_t EmbeddedModelLoader::getModelSize() {
+#if defined(_MSC_VER)
+    return static_cast<size_t>(dx7_vae_model_pt_len);
+#else
+    return static_cast<size_t>(ndx7_embedded_model_end - ndx7_embedded_model);
+#endif
+}
+
+const char* EmbeddedModelLoader::getNativeDecoderData() {
+#if ! NDX7_HAS_EMBEDDED_DECODER
+    return nullptr;
+#elif defined(_MSC_VER)
+    return reinterpret_cast<const char*>(dx7_vae_decoder_bin);
+#else
+    return ndx7_embedded_decoder;
+#endif
+}
+
+size_t EmbeddedModelLoader::getNativeDecoderSize() {
+#if ! NDX7_HAS_EMBEDDED_DECODER
+    return 0;
+#elif defined(_MSC_VER)
+    return static_cast<size_t>(dx7_vae_decoder_bin_len);
+#else
+    return static_cast<size_t>(ndx7_embedded_decoder_end - ndx7_embedded_decoder);
+#endif
+}
+
+size_t EmbeddedModelLoader::getPeakResidentBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<size_t>(counters.PeakWorkingSetSize);
     }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+ #if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss); // bytes on macOS
+ #else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes on Linux
+ #endif
+#endif
 }
 
-std::vector<char> EmbeddedModelLoader::decompressGzip(const unsigned char* compressed_data, 
-                                                     size_t compressed_size) {
-    // Create memory input stream from compressed data
-    juce::MemoryInputStream compressedStream(compressed_data, compressed_size, false);
-    
-    // Create GZIP decompressor with explicit GZIP format
-    juce::GZIPDecompressorInputStream gzipStream(&compressedStream, false, 
-                                                 juce::GZIPDecompressorInputStream::gzipFormat);
+MemoryStreamBuffer::MemoryStreamBuffer(const char* data, size_t size) {
+    // The get area is never written through; std::streambuf just isn't const-correct
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type offset, std::ios_base::seekdir direction,
+                                                         std::ios_base::openmode mode) {
+    if (!(mode & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
     
-    // Read into a memory block
-    juce::MemoryBlock decompressedBlock;
-    auto totalBytesRead = gzipStream.readIntoMemoryBlock(decompressedBlock);
+    off_type base = 0;
+    if (direction == std::ios_base::cur) {
+        base = gptr() - eback();
+    } else if (direction == std::ios_base::end) {
+        base = egptr() - eback();
+    }
     
-    if (totalBytesRead > 0) {
-        // Convert to std::vector<char>
-        const char* data = static_cast<const char*>(decompressedBlock.getData());
-        std::vector<char> result(data, data + totalBytesRead);
-        return result;
+    const off_type target = base + offset;
+    if (target < 0 || target > egptr() - eback()) {
+        return pos_type(off_type(-1));
     }
     
-    throw std::runtime_error("Failed to decompress GZIP data");
-}
\ No newline at end of file
+    setg(eback(), eback() + target, egptr());
+    return pos_type(target);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type position, std::ios_base::openmode mode) {
+    return seekoff(off_type(position), std::ios_base::beg, mode);
+}
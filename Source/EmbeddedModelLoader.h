@@ -1,15 +1,33 @@
 #pragma once
 
-#include <vector>
-#include <memory>
-#include <stdexcept>
+#include <cstddef>
+#include <streambuf>
 #include <juce_core/juce_core.h>
 
+// The TorchScript model is linked into the binary uncompressed and page-aligned
+// (.incbin on GCC/Clang), so loading it needs no decompression and no copy of
+// the serialized bytes: torch::jit::load reads them through MemoryStreamBuffer.
 class EmbeddedModelLoader {
 public:
-    static std::vector<char> loadCompressedModel();
+    static const char* getModelData();
+    static size_t getModelSize();
     
-private:
-    static std::vector<char> decompressGzip(const unsigned char* compressed_data, 
-                                           size_t compressed_size);
-};
\ No newline at end of file
+    // The NativeDecoder blob exported from the same model, linked in the same way
+    // when the build has one (see models/README.md); nullptr and 0 otherwise
+    static const char* getNativeDecoderData();
+    static size_t getNativeDecoderSize();
+    
+    // Peak resident set size of this process so far, or 0 where it can't be queried
+    static size_t getPeakResidentBytes();
+};
+
+// Read-only, seekable std::streambuf over memory owned by someone else
+class MemoryStreamBuffer : public std::streambuf {
+public:
+    MemoryStreamBuffer(const char* data, size_t size);
+    
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+                     std::ios_base::openmode mode = std::ios_base::in) override;
+    pos_type seekpos(pos_type position, std::ios_base::openmode mode = std::ios_base::in) override;
+};
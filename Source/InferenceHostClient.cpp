@@ -0,0 +1,402 @@
+#include "InferenceHostClient.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#if ! defined(_WIN32)
+ #include <cerrno>
+ #include <fcntl.h>
+ #include <cstdlib>
+ #include <sys/mman.h>
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/time.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#endif
+
+using namespace InferenceHostProtocol;
+
+InferenceHostClient::~InferenceHostClient()
+{
+    disconnect();
+}
+
+std::string InferenceHostClient::getDefaultSocketPath()
+{
+#if defined(_WIN32)
+    return {};
+#else
+    // Never a predictable name straight in a shared directory: the socket lives in
+    // a directory only this user can enter, under the per-user runtime directory
+    // where there is one ($TMPDIR is per-user on macOS)
+    const char* base = std::getenv("XDG_RUNTIME_DIR");
+    if (base == nullptr || *base == '\0')
+    {
+        base = std::getenv("TMPDIR");
+    }
+    if (base == nullptr || *base == '\0')
+    {
+        base = "/tmp";
+    }
+    
+    std::string directory(base);
+    while (directory.size() > 1 && directory.back() == '/')
+    {
+        directory.pop_back();
+    }
+    directory += "/ndx7-" + std::to_string(static_cast<unsigned long>(getuid()));
+    
+    mkdir(directory.c_str(), 0700);
+    
+    // Someone else may have created it first; then it isn't ours to use
+    struct stat info{};
+    if (lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid()
+        || (info.st_mode & 077) != 0)
+    {
+        std::cerr << "InferenceHostClient: " << directory << " is not a private directory of this user, not using the inference host" << std::endl;
+        return {};
+    }
+    
+    return directory + "/inference-host.sock";
+#endif
+}
+
+juce::File InferenceHostClient::findHostExecutable()
+{
+    const juce::File candidates[] = {
+        juce::File::getSpecialLocation(juce::File::currentExecutableFile).getSiblingFile("NeuralDX7InferenceHost"),
+        juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile("NintoracAudio")
+            .getChildFile("NeuralDX7PatchGenerator")
+            .getChildFile("NeuralDX7InferenceHost")
+    };
+    
+    for (const auto& candidate : candidates)
+    {
+        if (candidate.existsAsFile())
+        {
+            return candidate;
+        }
+    }
+    return {};
+}
+
+#if defined(_WIN32)
+
+// No Unix domain sockets or POSIX shared memory here; the engine stays in-process
+bool InferenceHostClient::connect(const std::string&, const juce::File&) { return false; }
+bool InferenceHostClient::isPeerCurrentUser(int) { return false; }
+bool InferenceHostClient::decode(const std::vector<float>&, DX7VoiceBank&) { return false; }
+bool InferenceHostClient::connectSocket(const std::string&) { return false; }
+bool InferenceHostClient::createResultRing(std::string&) { return false; }
+bool InferenceHostClient::sendAll(const void*, size_t) { return false; }
+bool InferenceHostClient::receiveAll(void*, size_t) { return false; }
+bool InferenceHostClient::sendChunk(const std::vector<float>&, int, int, uint64_t) { return false; }
+void InferenceHostClient::disconnect() {}
+
+#else
+
+bool InferenceHostClient::connect(const std::string& socketPath, const juce::File& hostExecutable)
+{
+    disconnect();
+    
+    if (socketPath.empty())
+    {
+        return false;
+    }
+    
+    if (!connectSocket(socketPath))
+    {
+        if (!hostExecutable.existsAsFile())
+        {
+            std::cerr << "InferenceHostClient: No host listening on " << socketPath << " and no host executable to start" << std::endl;
+            return false;
+        }
+        
+        std::cout << "InferenceHostClient: Starting " << hostExecutable.getFullPathName() << std::endl;
+        hostExecutable.startAsProcess("--socket \"" + juce::String(socketPath) + "\"");
+        
+        // Several instances may start a host at once; the losers exit and everyone
+        // connects to the one that bound the socket
+        const auto deadline = juce::Time::getMillisecondCounter() + HOST_START_TIMEOUT_MS;
+        while (!connectSocket(socketPath))
+        {
+            if (juce::Time::getMillisecondCounter() > deadline)
+            {
+                std::cerr << "InferenceHostClient: Host did not come up on " << socketPath << std::endl;
+                return false;
+            }
+            juce::Thread::sleep(50);
+        }
+    }
+    
+    std::string ringName;
+    if (!createResultRing(ringName))
+    {
+        disconnect();
+        return false;
+    }
+    
+    HelloMessage hello;
+    std::strncpy(hello.sharedMemoryName, ringName.c_str(), MAX_SHARED_MEMORY_NAME);
+    
+    WelcomeMessage welcome;
+    const bool welcomed = sendAll(&hello, sizeof(hello))
+        && receiveAll(&welcome, sizeof(welcome))
+        && welcome.magic == MAGIC && welcome.type == WELCOME && welcome.ok != 0;
+    
+    // Both sides have it mapped now (or never will), so the name can go
+    shm_unlink(ringName.c_str());
+    
+    if (!welcomed)
+    {
+        std::cerr << "InferenceHostClient: Host rejected the connection" << std::endl;
+        disconnect();
+        return false;
+    }
+    
+    modelHash = welcome.modelHash;
+    return true;
+}
+
+bool InferenceHostClient::connectSocket(const std::string& socketPath)
+{
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    
+    // Voices and ring contents are only taken from a host run by this user
+    if (!isPeerCurrentUser(fd))
+    {
+        std::cerr << "InferenceHostClient: " << socketPath << " is served by another user, refusing it" << std::endl;
+        close(fd);
+        return false;
+    }
+    
+   #if defined(SO_NOSIGPIPE)
+    // macOS has no MSG_NOSIGNAL; a dead host must not kill the DAW with SIGPIPE
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+   #endif
+    
+    // A hung host makes send() and recv() fail with EAGAIN rather than block forever
+    timeval timeout{};
+    timeout.tv_sec = RECEIVE_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (RECEIVE_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    
+    socketFd = fd;
+    return true;
+}
+
+bool InferenceHostClient::isPeerCurrentUser(int fd)
+{
+   #if defined(SO_PEERCRED)
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 && credentials.uid == getuid();
+   #else
+    uid_t uid = 0;
+    gid_t gid = 0;
+    return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+   #endif
+}
+
+bool InferenceHostClient::createResultRing(std::string& name)
+{
+    static std::atomic<uint32_t> ringCounter{0};
+    name = "/ndx7-" + std::to_string(static_cast<long>(getpid())) + "-" + std::to_string(ringCounter.fetch_add(1));
+    
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "InferenceHostClient: Failed to create shared memory " << name << std::endl;
+        return false;
+    }
+    
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(sizeof(ResultRing))) == 0)
+    {
+        memory = mmap(nullptr, sizeof(ResultRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+    
+    ring = new (memory) ResultRing;
+    ring->numSlots = RESULT_RING_SLOTS;
+    ring->writeIndex.store(0);
+    ring->readIndex.store(0);
+    ring->magic = MAGIC;
+    return true;
+}
+
+void InferenceHostClient::disconnect()
+{
+    if (socketFd >= 0)
+    {
+        close(socketFd);
+        socketFd = -1;
+    }
+    
+    if (ring != nullptr)
+    {
+        munmap(ring, sizeof(ResultRing));
+        ring = nullptr;
+    }
+}
+
+bool InferenceHostClient::sendAll(const void* data, size_t size)
+{
+   #if defined(MSG_NOSIGNAL)
+    const int flags = MSG_NOSIGNAL;
+   #else
+    const int flags = 0;
+   #endif
+    
+    auto* bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t sent = send(socketFd, bytes, size, flags);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                std::cerr << "InferenceHostClient: Host stopped reading for " << RECEIVE_TIMEOUT_MS << " ms" << std::endl;
+            }
+            return false;
+        }
+        bytes += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool InferenceHostClient::receiveAll(void* data, size_t size)
+{
+    auto* bytes = static_cast<char*>(data);
+    while (size > 0)
+    {
+        const ssize_t received = recv(socketFd, bytes, size, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                std::cerr << "InferenceHostClient: Host did not answer within " << RECEIVE_TIMEOUT_MS << " ms" << std::endl;
+            }
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+bool InferenceHostClient::sendChunk(const std::vector<float>& latents, int firstVoice, int numVoices, uint64_t requestId)
+{
+    DecodeMessage message;
+    message.numVoices = static_cast<uint32_t>(numVoices);
+    message.requestId = requestId;
+    
+    return sendAll(&message, sizeof(message))
+        && sendAll(latents.data() + static_cast<size_t>(firstVoice) * LATENT_DIM,
+                   static_cast<size_t>(numVoices) * LATENT_DIM * sizeof(float));
+}
+
+bool InferenceHostClient::decode(const std::vector<float>& latents, DX7VoiceBank& voices)
+{
+    if (!isConnected())
+    {
+        return false;
+    }
+    
+    const int numVoices = static_cast<int>(latents.size() / LATENT_DIM);
+    const int numChunks = (numVoices + MAX_VOICES_PER_CHUNK - 1) / MAX_VOICES_PER_CHUNK;
+    const uint64_t firstRequestId = nextRequestId;
+    nextRequestId += static_cast<uint64_t>(numChunks);
+    
+    voices.resize(numVoices);
+    
+    // Keep up to one chunk per ring slot in flight, so the host never waits on us
+    int sent = 0;
+    for (int received = 0; received < numChunks; ++received)
+    {
+        for (; sent < numChunks && sent - received < static_cast<int>(RESULT_RING_SLOTS); ++sent)
+        {
+            const int first = sent * MAX_VOICES_PER_CHUNK;
+            if (!sendChunk(latents, first, std::min(MAX_VOICES_PER_CHUNK, numVoices - first), firstRequestId + static_cast<uint64_t>(sent)))
+            {
+                std::cerr << "InferenceHostClient: Lost connection to host" << std::endl;
+                disconnect();
+                return false;
+            }
+        }
+        
+        DoorbellMessage doorbell;
+        const uint32_t readIndex = ring->readIndex.load(std::memory_order_relaxed);
+        if (!receiveAll(&doorbell, sizeof(doorbell)) || doorbell.magic != MAGIC || doorbell.type != RESULT_READY
+            || ring->writeIndex.load(std::memory_order_acquire) == readIndex)
+        {
+            std::cerr << "InferenceHostClient: Lost connection to host" << std::endl;
+            disconnect();
+            return false;
+        }
+        
+        const ResultSlot& slot = ring->slots[readIndex % RESULT_RING_SLOTS];
+        const uint64_t slotRequestId = slot.requestId;
+        const bool valid = slot.ok != 0
+            && slotRequestId == firstRequestId + static_cast<uint64_t>(received)
+            && static_cast<int>(slot.numVoices) == std::min(MAX_VOICES_PER_CHUNK, numVoices - received * MAX_VOICES_PER_CHUNK);
+        
+        if (valid)
+        {
+            std::memcpy(voices.voiceData(received * MAX_VOICES_PER_CHUNK), slot.parameters,
+                        static_cast<size_t>(slot.numVoices) * DX7Voice::N_PARAMS);
+        }
+        
+        ring->readIndex.store(readIndex + 1, std::memory_order_release);
+        
+        if (!valid)
+        {
+            // Out of step with the host; start over on a fresh connection
+            std::cerr << "InferenceHostClient: Host failed to decode request " << slotRequestId << std::endl;
+            disconnect();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DX7VoiceBank.h"
+#include "InferenceHostProtocol.h"
+
+// One connection from the plugin to NeuralDX7InferenceHost.
+//
+// A connection carries one request at a time, so the engine keeps a pool of
+// them and each inference worker borrows one for the duration of a decode.
+// If the host crashes, goes away or stops answering for RECEIVE_TIMEOUT_MS,
+// decode() fails and the connection is left disconnected. The next connect()
+// starts a new host.
+class InferenceHostClient
+{
+public:
+    InferenceHostClient() = default;
+    ~InferenceHostClient();
+    
+    // Connects to the host listening on socketPath. If nobody is listening,
+    // starts hostExecutable and waits for it. Blocks until the host has loaded its model.
+    bool connect(const std::string& socketPath, const juce::File& hostExecutable);
+    bool isConnected() const { return socketFd >= 0; }
+    
+    // Hash of the model the host loaded, see NeuralModelWrapper::getModelHash()
+    uint64_t getModelHash() const { return modelHash; }
+    
+    // Decodes latents.size() / LATENT_DIM voices. Batches larger than one ring slot
+    // are split into chunks and pipelined through the ring.
+    bool decode(const std::vector<float>& latents, DX7VoiceBank& voices);
+    
+    // Per-user socket, so one host serves every plugin instance of that user. It sits
+    // in a 0700 directory owned by the user under $XDG_RUNTIME_DIR, $TMPDIR or /tmp;
+    // empty if that directory can't be created or belongs to someone else.
+    static std::string getDefaultSocketPath();
+    
+    // True if the process at the other end of a Unix domain socket runs as this
+    // user (SO_PEERCRED or getpeereid). Both ends check it before trusting the other.
+    static bool isPeerCurrentUser(int fd);
+    
+    // The helper is installed next to the plugin binary, or in the plugin's application data folder
+    static juce::File findHostExecutable();
+    
+    static constexpr int HOST_START_TIMEOUT_MS = 10000;
+    
+    // A host that stops answering (hung, or stopped in a debugger) fails the
+    // request and drops the connection instead of holding a worker forever.
+    // Long enough for the host's model load before the welcome.
+    static constexpr int RECEIVE_TIMEOUT_MS = 30000;
+    
+private:
+    bool connectSocket(const std::string& socketPath);
+    bool createResultRing(std::string& name);
+    bool sendAll(const void* data, size_t size);
+    bool receiveAll(void* data, size_t size);
+    bool sendChunk(const std::vector<float>& latents, int firstVoice, int numVoices, uint64_t requestId);
+    void disconnect();
+    
+    int socketFd = -1;
+    InferenceHostProtocol::ResultRing* ring = nullptr;
+    uint64_t nextRequestId = 1;
+    uint64_t modelHash = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE(InferenceHostClient)
+};
@@ -0,0 +1,52 @@
+#include "InferenceHostServer.h"
+#include "InferenceHostClient.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// NeuralDX7InferenceHost: runs the model outside the DAW for every plugin
+// instance of this user. Normally started by the plugin itself.
+//
+//     NeuralDX7InferenceHost [--socket <path>] [--idle-exit-seconds <n>]
+int main(int argc, char* argv[])
+{
+    std::string socketPath;
+    int idleExitSeconds = InferenceHostServer::DEFAULT_IDLE_EXIT_SECONDS;
+    
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option = argv[i];
+        if (option == "--socket")
+        {
+            socketPath = argv[i + 1];
+        }
+        else if (option == "--idle-exit-seconds")
+        {
+            idleExitSeconds = std::max(1, std::atoi(argv[i + 1]));
+        }
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 2;
+        }
+    }
+    
+    if (socketPath.empty())
+    {
+        socketPath = InferenceHostClient::getDefaultSocketPath();
+        if (socketPath.empty())
+        {
+            return 1;
+        }
+    }
+    
+   #if defined(SIGPIPE)
+    // A client vanishing mid-write is handled per connection
+    std::signal(SIGPIPE, SIG_IGN);
+   #endif
+    
+    InferenceHostServer server(socketPath, idleExitSeconds);
+    return server.run();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "DX7Voice.h"
+
+// Wire format between the plugin and NeuralDX7InferenceHost, the optional helper
+// process that runs libtorch outside the DAW.
+//
+// Requests go over a Unix domain socket. Each connection also has its own
+// shared-memory ResultRing, created by the plugin and mapped by the host. The
+// host writes decoded parameter bytes straight into a ring slot and then sends
+// an 8-byte doorbell on the socket. Voices never travel through the socket, and
+// the plugin copies them out of the slot without any locking.
+namespace InferenceHostProtocol
+{
+    static constexpr uint32_t MAGIC = 0x4e443748; // "ND7H"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int LATENT_DIM = 8;
+    
+    // Larger batches are split into chunks and pipelined, up to one chunk per slot
+    static constexpr int MAX_VOICES_PER_CHUNK = 256;
+    static constexpr uint32_t RESULT_RING_SLOTS = 8;
+    static constexpr size_t MAX_SHARED_MEMORY_NAME = 30; // macOS limits POSIX shm names to 31 chars
+    
+    enum MessageType : uint32_t
+    {
+        HELLO = 1,  // plugin -> host: HelloMessage
+        WELCOME,    // host -> plugin: WelcomeMessage, once the model is loaded
+        DECODE,     // plugin -> host: DecodeMessage followed by numVoices * LATENT_DIM floats
+        RESULT_READY // host -> plugin: DoorbellMessage; the result is in the next ring slot
+    };
+    
+    struct HelloMessage
+    {
+        uint32_t magic = MAGIC;
+        uint32_t type = HELLO;
+        uint32_t version = VERSION;
+        uint32_t reserved = 0;
+        char sharedMemoryName[MAX_SHARED_MEMORY_NAME + 2] = {};
+    };
+    
+    struct WelcomeMessage
+    {
+        uint32_t magic = MAGIC;
+        uint32_t type = WELCOME;
+        uint32_t ok = 0;
+        uint32_t reserved = 0;
+        uint64_t modelHash = 0;
+    };
+    
+    struct DecodeMessage
+    {
+        uint32_t magic = MAGIC;
+        uint32_t type = DECODE;
+        uint32_t numVoices = 0;
+        uint32_t reserved = 0;
+        uint64_t requestId = 0;
+    };
+    
+    struct DoorbellMessage
+    {
+        uint32_t magic = MAGIC;
+        uint32_t type = RESULT_READY;
+        uint64_t requestId = 0;
+    };
+    
+    struct ResultSlot
+    {
+        uint64_t requestId;
+        uint32_t numVoices;
+        uint32_t ok;
+        uint8_t parameters[MAX_VOICES_PER_CHUNK * DX7Voice::N_PARAMS];
+    };
+    
+    // Single-producer (host), single-consumer (plugin) ring living in shared memory.
+    // Indices only ever increase; a slot is owned by the host while
+    // writeIndex - readIndex < RESULT_RING_SLOTS.
+    struct ResultRing
+    {
+        uint32_t magic;
+        uint32_t numSlots;
+        alignas(64) std::atomic<uint32_t> writeIndex;
+        alignas(64) std::atomic<uint32_t> readIndex;
+        ResultSlot slots[RESULT_RING_SLOTS];
+    };
+    
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "The result ring indices are shared between processes");
+}
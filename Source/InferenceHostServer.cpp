@@ -0,0 +1,263 @@
+#include "InferenceHostServer.h"
+#include "InferenceHostClient.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#if ! defined(_WIN32)
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <sys/mman.h>
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#endif
+
+using namespace InferenceHostProtocol;
+
+InferenceHostServer::InferenceHostServer(std::string path, int idleSeconds)
+    : socketPath(std::move(path)), idleExitSeconds(idleSeconds)
+{
+}
+
+#if defined(_WIN32)
+
+int InferenceHostServer::run()
+{
+    std::cerr << "InferenceHostServer: Not supported on this platform" << std::endl;
+    return 1;
+}
+
+bool InferenceHostServer::listenOnSocket() { return false; }
+void InferenceHostServer::serveConnection(int) {}
+bool InferenceHostServer::serveDecode(int, ResultRing&, const DecodeMessage&, std::vector<float>&) { return false; }
+bool InferenceHostServer::sendAll(int, const void*, size_t) { return false; }
+bool InferenceHostServer::receiveAll(int, void*, size_t) { return false; }
+
+#else
+
+bool InferenceHostServer::listenOnSocket()
+{
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "InferenceHostServer: Socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+    {
+        return false;
+    }
+    
+    if (bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        // Either another host already serves this socket, or one crashed and left it behind
+        const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        const bool inUse = probe >= 0 && connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0)
+        {
+            close(probe);
+        }
+        
+        if (inUse)
+        {
+            std::cout << "InferenceHostServer: Another host is already serving " << socketPath << std::endl;
+            return false;
+        }
+        
+        unlink(socketPath.c_str());
+        if (bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            std::cerr << "InferenceHostServer: Failed to bind " << socketPath << std::endl;
+            return false;
+        }
+    }
+    
+    chmod(socketPath.c_str(), 0600);
+    return listen(listenFd, 16) == 0;
+}
+
+int InferenceHostServer::run()
+{
+    if (!listenOnSocket())
+    {
+        return 1;
+    }
+    
+    std::cout << "InferenceHostServer: Listening on " << socketPath << std::endl;
+    
+    // Load while the first client is still connecting rather than on its HELLO
+    std::thread loader([this] { model.loadModelFromFile(); });
+    
+    auto lastActive = std::chrono::steady_clock::now();
+    
+    for (;;)
+    {
+        pollfd listener{ listenFd, POLLIN, 0 };
+        if (poll(&listener, 1, 1000) > 0 && (listener.revents & POLLIN) != 0)
+        {
+            const int fd = accept(listenFd, nullptr, nullptr);
+            if (fd >= 0 && !InferenceHostClient::isPeerCurrentUser(fd))
+            {
+                // The socket is 0600 in a private directory; this is the check that doesn't depend on that
+                std::cerr << "InferenceHostServer: Refusing a connection from another user" << std::endl;
+                close(fd);
+            }
+            else if (fd >= 0)
+            {
+                activeConnections.fetch_add(1);
+                std::thread([this, fd] {
+                    serveConnection(fd);
+                    close(fd);
+                    activeConnections.fetch_sub(1);
+                }).detach();
+            }
+        }
+        
+        if (activeConnections.load() > 0)
+        {
+            lastActive = std::chrono::steady_clock::now();
+        }
+        else if (std::chrono::steady_clock::now() - lastActive > std::chrono::seconds(idleExitSeconds))
+        {
+            break;
+        }
+    }
+    
+    std::cout << "InferenceHostServer: Idle for " << idleExitSeconds << " s, exiting" << std::endl;
+    close(listenFd);
+    unlink(socketPath.c_str());
+    loader.join();
+    return 0;
+}
+
+void InferenceHostServer::serveConnection(int fd)
+{
+    HelloMessage hello;
+    if (!receiveAll(fd, &hello, sizeof(hello)) || hello.magic != MAGIC || hello.type != HELLO || hello.version != VERSION)
+    {
+        return;
+    }
+    hello.sharedMemoryName[MAX_SHARED_MEMORY_NAME] = '\0';
+    
+    // Map the client's result ring
+    ResultRing* ring = nullptr;
+    const int shmFd = shm_open(hello.sharedMemoryName, O_RDWR, 0);
+    if (shmFd >= 0)
+    {
+        void* memory = mmap(nullptr, sizeof(ResultRing), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        close(shmFd);
+        if (memory != MAP_FAILED)
+        {
+            ring = static_cast<ResultRing*>(memory);
+        }
+    }
+    
+    WelcomeMessage welcome;
+    welcome.ok = ring != nullptr && ring->magic == MAGIC && ring->numSlots == RESULT_RING_SLOTS
+        && model.loadModelFromFile() ? 1 : 0;
+    welcome.modelHash = model.getModelHash();
+    
+    if (sendAll(fd, &welcome, sizeof(welcome)) && welcome.ok != 0)
+    {
+        std::cout << "InferenceHostServer: Client connected (" << activeConnections.load() << " connections)" << std::endl;
+        
+        std::vector<float> latents;
+        DecodeMessage message;
+        while (receiveAll(fd, &message, sizeof(message)) && message.magic == MAGIC && message.type == DECODE
+               && serveDecode(fd, *ring, message, latents))
+        {
+        }
+    }
+    
+    if (ring != nullptr)
+    {
+        munmap(ring, sizeof(ResultRing));
+    }
+}
+
+bool InferenceHostServer::serveDecode(int fd, ResultRing& ring, const DecodeMessage& message, std::vector<float>& latents)
+{
+    if (message.numVoices == 0 || message.numVoices > static_cast<uint32_t>(MAX_VOICES_PER_CHUNK))
+    {
+        return false;
+    }
+    
+    latents.resize(static_cast<size_t>(message.numVoices) * LATENT_DIM);
+    if (!receiveAll(fd, latents.data(), latents.size() * sizeof(float)))
+    {
+        return false;
+    }
+    
+    const auto voices = model.generateVoices(latents);
+    
+    // The client keeps at most one chunk per slot in flight, so this only waits if it stalled
+    const uint32_t writeIndex = ring.writeIndex.load(std::memory_order_relaxed);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RING_FULL_TIMEOUT_MS);
+    while (writeIndex - ring.readIndex.load(std::memory_order_acquire) >= RESULT_RING_SLOTS)
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            std::cerr << "InferenceHostServer: Client stopped draining its result ring" << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    ResultSlot& slot = ring.slots[writeIndex % RESULT_RING_SLOTS];
+    slot.requestId = message.requestId;
+    slot.numVoices = static_cast<uint32_t>(voices.size());
+    slot.ok = static_cast<uint32_t>(voices.size()) == message.numVoices ? 1 : 0;
+    std::memcpy(slot.parameters, voices.data(), voices.sizeInBytes());
+    ring.writeIndex.store(writeIndex + 1, std::memory_order_release);
+    
+    DoorbellMessage doorbell;
+    doorbell.requestId = message.requestId;
+    return sendAll(fd, &doorbell, sizeof(doorbell));
+}
+
+bool InferenceHostServer::sendAll(int fd, const void* data, size_t size)
+{
+   #if defined(MSG_NOSIGNAL)
+    const int flags = MSG_NOSIGNAL;
+   #else
+    const int flags = 0;
+   #endif
+    
+    auto* bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t sent = send(fd, bytes, size, flags);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        bytes += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool InferenceHostServer::receiveAll(int fd, void* data, size_t size)
+{
+    auto* bytes = static_cast<char*>(data);
+    while (size > 0)
+    {
+        const ssize_t received = recv(fd, bytes, size, 0);
+        if (received <= 0)
+        {
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+#endif
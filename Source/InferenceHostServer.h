@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "NeuralModelWrapper.h"
+#include "InferenceHostProtocol.h"
+
+// Server side of NeuralDX7InferenceHost: loads the model once and serves every
+// plugin instance of the user over a Unix domain socket. Each connection has its
+// own thread, and all of them share the model. Results are written into the
+// connection's shared-memory ResultRing (see InferenceHostProtocol.h).
+//
+// The host exits once it has had no connections for idleExitSeconds, so it
+// goes away after the last DAW closes.
+class InferenceHostServer
+{
+public:
+    InferenceHostServer(std::string socketPath, int idleExitSeconds);
+    
+    // Returns the process exit code
+    int run();
+    
+    static constexpr int DEFAULT_IDLE_EXIT_SECONDS = 60;
+    static constexpr int RING_FULL_TIMEOUT_MS = 5000;
+    
+private:
+    bool listenOnSocket();
+    void serveConnection(int fd);
+    bool serveDecode(int fd, InferenceHostProtocol::ResultRing& ring, const InferenceHostProtocol::DecodeMessage& message,
+                     std::vector<float>& latents);
+    static bool sendAll(int fd, const void* data, size_t size);
+    static bool receiveAll(int fd, void* data, size_t size);
+    
+    const std::string socketPath;
+    const int idleExitSeconds;
+    int listenFd = -1;
+    
+    NeuralModelWrapper model;
+    std::atomic<int> activeConnections{0};
+};
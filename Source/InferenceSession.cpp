@@ -0,0 +1,102 @@
+#include "InferenceSession.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if NDX7_HAS_INFERENCE_MODE
+ #include <c10/core/InferenceMode.h>
+#endif
+
+InferenceSession::InferenceSession(torch::jit::script::Module& m)
+    : model(m)
+{
+}
+
+int InferenceSession::bucketSizeFor(int numVoices)
+{
+    int size = 1;
+    while (size < numVoices && size < MAX_BUCKET)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+InferenceSession::Bucket& InferenceSession::getBucket(int numVoices)
+{
+    const int size = bucketSizeFor(numVoices);
+    int index = 0;
+    while ((1 << index) < size)
+    {
+        ++index;
+    }
+
+    auto& bucket = buckets[index];
+    if (bucket == nullptr)
+    {
+        // First use of this shape: the only place the session allocates
+        bucket = std::make_unique<Bucket>();
+        bucket->size = size;
+        bucket->input.assign(static_cast<size_t>(size) * LATENT_DIM, 0.0f);
+        bucket->output.assign(static_cast<size_t>(size) * DX7Voice::N_PARAMS, 0);
+        bucket->inputTensor = torch::from_blob(bucket->input.data(), {size, LATENT_DIM}, torch::kFloat32);
+        bucket->outputTensor = torch::from_blob(bucket->output.data(), {size, DX7Voice::N_PARAMS}, torch::kUInt8);
+        bucket->maxTensor = torch::empty({size, DX7Voice::N_PARAMS}, torch::kFloat32);
+        bucket->argmaxTensor = torch::empty({size, DX7Voice::N_PARAMS}, torch::kInt64);
+        bucket->arguments.emplace_back(bucket->inputTensor);
+    }
+
+    return *bucket;
+}
+
+bool InferenceSession::decode(const float* latents, int numVoices, uint8_t* parameters)
+{
+    lastCallForwardPasses = 0;
+
+    for (int first = 0; first < numVoices; first += MAX_BUCKET)
+    {
+        const int count = std::min(MAX_BUCKET, numVoices - first);
+        if (!decodeChunk(latents + static_cast<size_t>(first) * LATENT_DIM, count,
+                         parameters + static_cast<size_t>(first) * DX7Voice::N_PARAMS))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool InferenceSession::decodeChunk(const float* latents, int numVoices, uint8_t* parameters)
+{
+    auto& bucket = getBucket(numVoices);
+
+    // Stage into the bucket's input; padding rows are zero latents and are ignored
+    const size_t latentFloats = static_cast<size_t>(numVoices) * LATENT_DIM;
+    std::memcpy(bucket.input.data(), latents, latentFloats * sizeof(float));
+    std::fill(bucket.input.begin() + latentFloats, bucket.input.end(), 0.0f);
+
+    try
+    {
+#if NDX7_HAS_INFERENCE_MODE
+        c10::InferenceMode inferenceMode;
+#else
+        torch::NoGradGuard noGrad;
+#endif
+        // The returned logits are always a fresh tensor
+        const torch::Tensor logits = model.forward(bucket.arguments).toTensor();
+        ++lastCallForwardPasses;
+
+        // argmax has no out= variant before libtorch 1.9, max.dim does. The outputs
+        // already have the right shape, so neither is reallocated.
+        at::max_out(bucket.maxTensor, bucket.argmaxTensor, logits, -1);
+        bucket.outputTensor.copy_(bucket.argmaxTensor);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "InferenceSession: Forward pass failed: " << e.what() << std::endl;
+        return false;
+    }
+
+    std::memcpy(parameters, bucket.output.data(), static_cast<size_t>(numVoices) * DX7Voice::N_PARAMS);
+    return true;
+}
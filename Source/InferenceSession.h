@@ -0,0 +1,75 @@
+#pragma once
+
+#include <torch/torch.h>
+#include <torch/script.h>
+#if __has_include(<torch/version.h>)
+ #include <torch/version.h>
+#endif
+#include <array>
+#include <memory>
+#include <vector>
+#include "DX7Voice.h"
+
+// torch::jit::freeze / optimize_for_inference arrived in libtorch 1.10,
+// c10::InferenceMode in 1.9
+#if defined(TORCH_VERSION_MAJOR) && (TORCH_VERSION_MAJOR > 1 || TORCH_VERSION_MINOR >= 10)
+ #define NDX7_HAS_FROZEN_MODULES 1
+#else
+ #define NDX7_HAS_FROZEN_MODULES 0
+#endif
+
+#if defined(TORCH_VERSION_MAJOR) && (TORCH_VERSION_MAJOR > 1 || TORCH_VERSION_MINOR >= 9)
+ #define NDX7_HAS_INFERENCE_MODE 1
+#else
+ #define NDX7_HAS_INFERENCE_MODE 0
+#endif
+
+// Reusable state for running the TorchScript model without per-call allocation.
+//
+// Batches are padded up to a power-of-two bucket (1 to MAX_BUCKET voices), so
+// the executor only ever sees a handful of input shapes. Each bucket owns its
+// input buffer, wrapped with from_blob, the prebuilt argument list and the
+// max/argmax/parameter output tensors, which at::max_out fills in place. After
+// a bucket's first call, everything outside model.forward reuses that storage.
+//
+// In steady state a call allocates only what model.forward allocates itself;
+// InferenceSessionTests counts the CPU allocator's calls to hold it to that.
+//
+// A session is used by one thread at a time; NeuralModelWrapper pools them.
+class InferenceSession
+{
+public:
+    static constexpr int LATENT_DIM = 8;
+    static constexpr int MAX_BUCKET = 256;
+    static constexpr int NUM_BUCKETS = 9; // 1, 2, 4, ... 256
+
+    explicit InferenceSession(torch::jit::script::Module& model);
+
+    // Decodes numVoices latents into DX7Voice::N_PARAMS argmax bytes per voice.
+    // Batches larger than MAX_BUCKET run as several forward passes.
+    bool decode(const float* latents, int numVoices, uint8_t* parameters);
+
+    int getLastCallForwardPasses() const { return lastCallForwardPasses; }
+
+    static int bucketSizeFor(int numVoices);
+
+private:
+    struct Bucket
+    {
+        int size = 0;
+        std::vector<float> input;
+        std::vector<uint8_t> output;
+        torch::Tensor inputTensor;
+        torch::Tensor maxTensor;
+        torch::Tensor argmaxTensor;
+        torch::Tensor outputTensor;
+        std::vector<torch::jit::IValue> arguments;
+    };
+
+    Bucket& getBucket(int numVoices);
+    bool decodeChunk(const float* latents, int numVoices, uint8_t* parameters);
+
+    torch::jit::script::Module& model;
+    std::array<std::unique_ptr<Bucket>, NUM_BUCKETS> buckets;
+    int lastCallForwardPasses = 0;
+};
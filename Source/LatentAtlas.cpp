@@ -0,0 +1,322 @@
+#include "LatentAtlas.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr char ATLAS_MAGIC[8] = { 'N', 'D', '7', 'A', 'T', 'L', 'A', 'S' };
+    constexpr uint32_t ATLAS_VERSION = 1;
+    constexpr float SLIDER_STEP = 0.01f;
+
+    float snapToSliderGrid(float value)
+    {
+        return std::round(value / SLIDER_STEP) * SLIDER_STEP;
+    }
+}
+
+LatentAtlas::LatentAtlas() = default;
+
+LatentAtlas::~LatentAtlas()
+{
+    close();
+}
+
+juce::File LatentAtlas::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("NintoracAudio")
+        .getChildFile("NeuralDX7PatchGenerator")
+        .getChildFile("latent_atlas.bin");
+}
+
+bool LatentAtlas::open(const juce::File& file, uint64_t hash, const Settings& newSettings)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    atlasFile = file;
+    modelHash = hash;
+    settings = newSettings;
+    settings.pointsPerDim = juce::jmax(2, settings.pointsPerDim);
+    settings.snapRadius = juce::jmax(0.0f, settings.snapRadius);
+    spacing = (settings.maxValue - settings.minValue) / static_cast<float>(settings.pointsPerDim - 1);
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>());
+
+    numPoints = 1;
+    for (int i = 0; i < LATENT_DIM; ++i)
+    {
+        numPoints *= static_cast<uint64_t>(settings.pointsPerDim);
+    }
+
+    if (!atlasFile.getParentDirectory().createDirectory())
+    {
+        std::cerr << "LatentAtlas: Can't create " << atlasFile.getParentDirectory().getFullPathName() << std::endl;
+        return false;
+    }
+
+    fileLock = std::make_unique<juce::InterProcessLock>("NeuralDX7PatchGeneratorLatentAtlas");
+
+    {
+        juce::InterProcessLock::ScopedLockType fileScopedLock(*fileLock);
+
+        if (!atlasFile.existsAsFile() || atlasFile.getSize() < HEADER_SIZE)
+        {
+            if (!writeFreshHeader())
+            {
+                return false;
+            }
+        }
+        else if (!validateHeader())
+        {
+            // Built by a different model or for a different lattice - start again
+            std::cout << "LatentAtlas: Model or lattice changed, discarding atlas" << std::endl;
+            if (!atlasFile.deleteFile() || !writeFreshHeader())
+            {
+                std::cerr << "LatentAtlas: Can't reset stale atlas (in use by another process?)" << std::endl;
+                return false;
+            }
+        }
+        else if ((atlasFile.getSize() - HEADER_SIZE) % RECORD_SIZE != 0)
+        {
+            // A previous run stopped part way through a write; drop the partial record
+            juce::FileOutputStream stream(atlasFile);
+            if (stream.openedOk())
+            {
+                stream.setPosition(HEADER_SIZE + ((atlasFile.getSize() - HEADER_SIZE) / RECORD_SIZE) * RECORD_SIZE);
+                stream.truncate();
+            }
+        }
+    }
+
+    remap();
+
+    const auto opened = std::atomic_load(&snapshot);
+    std::cout << "LatentAtlas: Opened " << atlasFile.getFullPathName() << " with "
+              << (opened != nullptr ? opened->numDecoded : 0) << " of " << numPoints << " lattice voices" << std::endl;
+    return opened != nullptr;
+}
+
+void LatentAtlas::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>());
+}
+
+bool LatentAtlas::isOpen() const
+{
+    return std::atomic_load(&snapshot) != nullptr;
+}
+
+uint64_t LatentAtlas::getNumDecoded() const
+{
+    const auto current = std::atomic_load(&snapshot);
+    return current != nullptr ? current->numDecoded : 0;
+}
+
+float LatentAtlas::latticeValue(int index) const
+{
+    // Snapped to the slider grid so lattice points are positions a slider can actually reach
+    return snapToSliderGrid(settings.minValue + static_cast<float>(index) * spacing);
+}
+
+bool LatentAtlas::writeFreshHeader()
+{
+    Header header{};
+    std::memcpy(header.magic, ATLAS_MAGIC, sizeof(ATLAS_MAGIC));
+    header.version = ATLAS_VERSION;
+    header.recordSize = RECORD_SIZE;
+    header.pointsPerDim = static_cast<uint32_t>(settings.pointsPerDim);
+    header.latentDim = LATENT_DIM;
+    header.modelHash = modelHash;
+    header.minValue = settings.minValue;
+    header.maxValue = settings.maxValue;
+
+    return atlasFile.replaceWithData(&header, sizeof(header));
+}
+
+bool LatentAtlas::validateHeader()
+{
+    juce::FileInputStream stream(atlasFile);
+    Header header{};
+
+    if (!stream.openedOk() || stream.read(&header, sizeof(header)) != static_cast<int>(sizeof(header)))
+    {
+        return false;
+    }
+
+    return std::memcmp(header.magic, ATLAS_MAGIC, sizeof(ATLAS_MAGIC)) == 0
+        && header.version == ATLAS_VERSION
+        && header.recordSize == static_cast<uint32_t>(RECORD_SIZE)
+        && header.pointsPerDim == static_cast<uint32_t>(settings.pointsPerDim)
+        && header.latentDim == static_cast<uint32_t>(LATENT_DIM)
+        && header.modelHash == modelHash
+        && header.minValue == settings.minValue
+        && header.maxValue == settings.maxValue;
+}
+
+void LatentAtlas::remap()
+{
+    // Called with mutex held. The new mapping is built first and then published,
+    // so lookups keep using the old one until then.
+    auto next = std::make_shared<Snapshot>();
+    next->mapping = std::make_unique<juce::MemoryMappedFile>(atlasFile, juce::MemoryMappedFile::readOnly, false);
+
+    if (next->mapping->getData() == nullptr || next->mapping->getSize() < static_cast<size_t>(HEADER_SIZE))
+    {
+        std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>());
+        return;
+    }
+
+    next->numDecoded = std::min<uint64_t>(numPoints, (next->mapping->getSize() - HEADER_SIZE) / RECORD_SIZE);
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+}
+
+std::optional<DX7Voice> LatentAtlas::lookup(const float* latent, size_t size) const
+{
+    if (size != static_cast<size_t>(LATENT_DIM))
+    {
+        return std::nullopt;
+    }
+
+    const auto current = std::atomic_load(&snapshot);
+
+    if (current == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    // Row-major lattice index; the last dimension varies fastest
+    const float tolerance = settings.snapRadius + SLIDER_STEP * 0.5f;
+    uint64_t index = 0;
+
+    for (int dim = 0; dim < LATENT_DIM; ++dim)
+    {
+        const long nearest = std::lround((latent[dim] - settings.minValue) / spacing);
+        const int point = static_cast<int>(std::clamp(nearest, 0L, static_cast<long>(settings.pointsPerDim - 1)));
+
+        if (std::abs(latent[dim] - latticeValue(point)) > tolerance)
+        {
+            return std::nullopt;
+        }
+
+        index = index * static_cast<uint64_t>(settings.pointsPerDim) + static_cast<uint64_t>(point);
+    }
+
+    if (index >= current->numDecoded)
+    {
+        return std::nullopt;
+    }
+
+    const auto* record = static_cast<const uint8_t*>(current->mapping->getData()) + HEADER_SIZE + index * RECORD_SIZE;
+    return DX7Voice::fromParameterBytes(record);
+}
+
+void LatentAtlas::getLatticeLatents(uint64_t first, int count, std::vector<float>& latents) const
+{
+    latents.clear();
+    latents.reserve(static_cast<size_t>(count) * LATENT_DIM);
+
+    const uint64_t end = std::min<uint64_t>(numPoints, first + static_cast<uint64_t>(juce::jmax(0, count)));
+
+    for (uint64_t index = first; index < end; ++index)
+    {
+        const size_t row = latents.size();
+        latents.resize(row + LATENT_DIM);
+
+        uint64_t remaining = index;
+        for (int dim = LATENT_DIM - 1; dim >= 0; --dim)
+        {
+            latents[row + dim] = latticeValue(static_cast<int>(remaining % static_cast<uint64_t>(settings.pointsPerDim)));
+            remaining /= static_cast<uint64_t>(settings.pointsPerDim);
+        }
+    }
+}
+
+bool LatentAtlas::appendVoices(uint64_t first, const DX7VoiceBank& voices)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (std::atomic_load(&snapshot) == nullptr || voices.empty())
+    {
+        return false;
+    }
+
+    // A record is exactly one voice's parameter bytes, so the bank is written as is
+    static_assert(RECORD_SIZE == DX7Voice::N_PARAMS, "Atlas records must match the bank layout");
+
+    {
+        juce::InterProcessLock::ScopedLockType fileScopedLock(*fileLock);
+
+        // Records are positional, so only the chunk that continues the file may be written
+        const uint64_t onDisk = static_cast<uint64_t>(juce::jmax<juce::int64>(0, atlasFile.getSize() - HEADER_SIZE)) / RECORD_SIZE;
+
+        if (!validateHeader())
+        {
+            // Another model's build replaced the file; nothing in it is ours
+            std::cerr << "LatentAtlas: " << atlasFile.getFullPathName() << " was rewritten for another model, closing it" << std::endl;
+            std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>());
+            return false;
+        }
+
+        if (onDisk != first)
+        {
+            remap();
+            return false;
+        }
+
+        juce::FileOutputStream stream(atlasFile);
+        if (!stream.openedOk() || !stream.write(voices.data(), voices.sizeInBytes()))
+        {
+            return false;
+        }
+        stream.flush();
+    }
+
+    remap();
+    return true;
+}
+
+bool LatentAtlas::generate(const juce::File& file, NeuralModelWrapper& model, const Settings& settings,
+                           int batchSize, std::function<bool(double)> progress)
+{
+    if (!model.isModelLoaded() && !model.loadModelFromFile())
+    {
+        return false;
+    }
+
+    LatentAtlas atlas;
+    if (!atlas.open(file, model.getModelHash(), settings))
+    {
+        return false;
+    }
+
+    std::vector<float> latents;
+    batchSize = juce::jmax(1, batchSize);
+
+    while (!atlas.isComplete())
+    {
+        const uint64_t first = atlas.getNumDecoded();
+        atlas.getLatticeLatents(first, batchSize, latents);
+
+        const auto voices = model.generateVoices(latents);
+        if (static_cast<size_t>(voices.size()) != latents.size() / LATENT_DIM)
+        {
+            std::cerr << "LatentAtlas: Decoding failed at lattice point " << first << std::endl;
+            return false;
+        }
+
+        if (!atlas.appendVoices(first, voices) && atlas.getNumDecoded() == first)
+        {
+            std::cerr << "LatentAtlas: Can't write lattice points from " << first << ", stopping" << std::endl;
+            return false;
+        }
+
+        if (progress && !progress(static_cast<double>(atlas.getNumDecoded()) / static_cast<double>(atlas.getNumPoints())))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
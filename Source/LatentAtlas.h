@@ -0,0 +1,111 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "DX7VoiceBank.h"
+#include "NeuralModelWrapper.h"
+
+// Precomputed lattice of decoded voices, stored in a memory-mapped file.
+//
+// The decoder is a deterministic function of the latent followed by an argmax,
+// so a regular lattice over the slider range can be decoded once, either in the
+// background or offline with generate(). Each dimension gets pointsPerDim
+// evenly spaced values, snapped to the slider grid. Voices are packed as 155
+// parameter bytes in lattice index order, which means a lookup is pure
+// arithmetic followed by a read from the mapping. The file is appended to in
+// chunks, so a partially built atlas already answers lookups for its prefix.
+//
+// Lookups read a published snapshot of the mapping and decoded count and never
+// take the lock that writes hold, so they never wait on disk I/O or on another
+// process. Progress made by other processes is picked up by the next append.
+class LatentAtlas
+{
+public:
+    static constexpr int LATENT_DIM = NeuralModelWrapper::LATENT_DIM;
+    static constexpr int HEADER_SIZE = 64;
+    static constexpr int RECORD_SIZE = DX7Voice::N_PARAMS;
+
+    struct Settings
+    {
+        int pointsPerDim = 5;      // 5^8 = 390625 voices, about 60 MB
+        float minValue = -3.0f;
+        float maxValue = 3.0f;
+        float snapRadius = 0.0f;   // how far off a lattice point a lookup may be and still snap to it
+    };
+
+    LatentAtlas();
+    ~LatentAtlas();
+
+    // Opens (or creates) the atlas. A file built for another model or lattice is discarded.
+    // Call before the atlas is shared with other threads.
+    bool open(const juce::File& file, uint64_t modelHash, const Settings& settings);
+    void close();
+    bool isOpen() const;
+
+    // O(1): nullopt unless the latent is on (or within snapRadius of) a lattice point that
+    // has been decoded. Lock-free, so it is safe to call from the message thread.
+    std::optional<DX7Voice> lookup(const float* latent, size_t size) const;
+
+    uint64_t getNumPoints() const { return numPoints; }
+    uint64_t getNumDecoded() const;
+    bool isComplete() const { return getNumDecoded() >= numPoints; }
+
+    // Generation: latents for lattice points [first, first + count) and appending their voices.
+    // appendVoices() returns false for a chunk that another process has already written
+    // (the decoded count then moves on), and for a write that failed or a file another
+    // model has taken over (it doesn't; the latter also closes the atlas).
+    void getLatticeLatents(uint64_t first, int count, std::vector<float>& latents) const;
+    bool appendVoices(uint64_t first, const DX7VoiceBank& voices);
+
+    // Decodes a whole atlas in batches, e.g. at build time. progress returns false to stop early.
+    static bool generate(const juce::File& file, NeuralModelWrapper& model, const Settings& settings,
+                         int batchSize, std::function<bool(double)> progress = nullptr);
+
+    static juce::File getDefaultFile();
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint32_t pointsPerDim;
+        uint32_t latentDim;
+        uint64_t modelHash;
+        float minValue;
+        float maxValue;
+        uint8_t reserved[24];
+    };
+    static_assert(sizeof(Header) == HEADER_SIZE, "Header layout is part of the file format");
+
+    float latticeValue(int index) const;
+    bool writeFreshHeader();
+    bool validateHeader();
+    void remap();
+
+    // Held by open, close and appendVoices, never by lookups
+    std::mutex mutex;
+    juce::File atlasFile;
+    uint64_t modelHash = 0;
+    Settings settings;
+    uint64_t numPoints = 0;
+    float spacing = 0.0f;
+
+    std::unique_ptr<juce::InterProcessLock> fileLock;
+
+    // What lookups read, replaced as a whole (std::atomic_load/store only); a reader
+    // keeps the mapping it loaded alive until it has copied the voice out
+    struct Snapshot
+    {
+        std::unique_ptr<juce::MemoryMappedFile> mapping;
+        uint64_t numDecoded = 0;
+    };
+    std::shared_ptr<const Snapshot> snapshot;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LatentAtlas)
+};
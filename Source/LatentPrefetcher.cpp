@@ -0,0 +1,93 @@
+#include "LatentPrefetcher.h"
+#include <algorithm>
+#include <cmath>
+
+LatentPrefetcher::LatentPrefetcher() = default;
+
+LatentPrefetcher::LatentPrefetcher(const Settings& s)
+    : settings(s)
+{
+}
+
+void LatentPrefetcher::addSample(const std::vector<float>& latent, double timeMs)
+{
+    if (latent.size() != static_cast<size_t>(LATENT_DIM))
+    {
+        return;
+    }
+
+    const double elapsedMs = timeMs - lastSampleMs;
+
+    if (!hasSample || elapsedMs > settings.idleResetMs)
+    {
+        // Start of a new gesture - nothing to extrapolate from yet
+        velocity.fill(0.0);
+    }
+    else if (elapsedMs > 0.0)
+    {
+        for (int i = 0; i < LATENT_DIM; ++i)
+        {
+            const double instantaneous = (latent[i] - position[i]) / elapsedMs;
+            velocity[i] = settings.smoothing * instantaneous + (1.0 - settings.smoothing) * velocity[i];
+        }
+    }
+
+    std::copy(latent.begin(), latent.end(), position.begin());
+    lastSampleMs = timeMs;
+    hasSample = true;
+}
+
+void LatentPrefetcher::reset()
+{
+    velocity.fill(0.0);
+    hasSample = false;
+}
+
+bool LatentPrefetcher::isMoving() const
+{
+    return std::any_of(velocity.begin(), velocity.end(), [](double v) { return v != 0.0; });
+}
+
+std::vector<float> LatentPrefetcher::predictTarget() const
+{
+    std::vector<float> target(LATENT_DIM);
+
+    for (int i = 0; i < LATENT_DIM; ++i)
+    {
+        target[i] = snapToGrid(static_cast<float>(position[i] + velocity[i] * settings.horizonMs));
+    }
+
+    return target;
+}
+
+std::vector<float> LatentPrefetcher::buildNeighbourhood(const std::vector<float>& centre)
+{
+    std::vector<float> latents;
+
+    if (centre.size() != static_cast<size_t>(LATENT_DIM))
+    {
+        return latents;
+    }
+
+    latents.reserve(NEIGHBOURHOOD_SIZE * LATENT_DIM);
+    latents.insert(latents.end(), centre.begin(), centre.end());
+
+    for (int dim = 0; dim < LATENT_DIM; ++dim)
+    {
+        for (float direction : { -1.0f, 1.0f })
+        {
+            // At the ends of the range this collapses onto the centre; the cache dedups it
+            const size_t row = latents.size();
+            latents.insert(latents.end(), centre.begin(), centre.end());
+            latents[row + dim] = snapToGrid(centre[dim] + direction * STEP);
+        }
+    }
+
+    return latents;
+}
+
+float LatentPrefetcher::snapToGrid(float value)
+{
+    const float clamped = std::clamp(value, MIN_VALUE, MAX_VALUE);
+    return std::round(clamped / STEP) * STEP;
+}
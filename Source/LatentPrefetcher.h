@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "NeuralModelWrapper.h"
+
+// Tracks latent slider movement and predicts where the user is heading.
+//
+// Each slider update feeds a smoothed per-dimension velocity. The predicted
+// point is the current position extrapolated over a short horizon, snapped to
+// the slider grid. Around that point the prefetcher builds a neighbourhood of
+// the centre plus one slider step either side on every dimension
+// (1 + 2 * LATENT_DIM latents), which the engine generates in one forward pass.
+class LatentPrefetcher
+{
+public:
+    static constexpr int LATENT_DIM = NeuralModelWrapper::LATENT_DIM;
+    static constexpr int NEIGHBOURHOOD_SIZE = 1 + 2 * LATENT_DIM;
+
+    // Matches the range and interval of DX7LatentSlider
+    static constexpr float MIN_VALUE = -3.0f;
+    static constexpr float MAX_VALUE = 3.0f;
+    static constexpr float STEP = 0.01f;
+
+    struct Settings
+    {
+        double horizonMs = 150.0;   // how far ahead to extrapolate
+        double smoothing = 0.5;     // weight of the newest velocity sample
+        double idleResetMs = 250.0; // a pause this long means the gesture ended
+    };
+
+    LatentPrefetcher();
+    explicit LatentPrefetcher(const Settings& settings);
+
+    // Records a slider position; timeMs must be monotonic
+    void addSample(const std::vector<float>& latent, double timeMs);
+    void reset();
+
+    bool isMoving() const;
+
+    // Position extrapolated over the horizon, clamped and snapped to the slider grid
+    std::vector<float> predictTarget() const;
+
+    // Centre followed by its -1/+1 step neighbours on each dimension,
+    // flattened as NEIGHBOURHOOD_SIZE rows of LATENT_DIM floats
+    static std::vector<float> buildNeighbourhood(const std::vector<float>& centre);
+
+private:
+    static float snapToGrid(float value);
+
+    Settings settings;
+    std::array<float, LATENT_DIM> position{};
+    std::array<double, LATENT_DIM> velocity{}; // slider units per ms
+    double lastSampleMs = 0.0;
+    bool hasSample = false;
+};
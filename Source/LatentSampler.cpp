@@ -0,0 +1,471 @@
+#include "LatentSampler.h"
+#include "NativeDecoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define LATENT_SAMPLER_X86 1
+ #include <immintrin.h>
+#else
+ #define LATENT_SAMPLER_X86 0
+#endif
+
+// Compiles the enclosed functions for one instruction set. MSVC allows the
+// intrinsics anywhere, so it needs no region. FMA is deliberately never
+// enabled: contracting a * b + c would change the rounding between paths.
+#if defined(__clang__)
+ #define LATENT_SAMPLER_BEGIN_TARGET_SSE2 _Pragma("clang attribute push (__attribute__((target(\"sse2\"))), apply_to = function)")
+ #define LATENT_SAMPLER_BEGIN_TARGET_AVX2 _Pragma("clang attribute push (__attribute__((target(\"avx2\"))), apply_to = function)")
+ #define LATENT_SAMPLER_END_TARGET _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+ #define LATENT_SAMPLER_BEGIN_TARGET_SSE2 _Pragma("GCC push_options") _Pragma("GCC target(\"sse2\")")
+ #define LATENT_SAMPLER_BEGIN_TARGET_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+ #define LATENT_SAMPLER_END_TARGET _Pragma("GCC pop_options")
+#else
+ #define LATENT_SAMPLER_BEGIN_TARGET_SSE2
+ #define LATENT_SAMPLER_BEGIN_TARGET_AVX2
+ #define LATENT_SAMPLER_END_TARGET
+#endif
+
+namespace
+{
+    constexpr int LATENT_DIM = LatentSampler::LATENT_DIM;
+
+    constexpr uint32_t PHILOX_M0 = 0xD2511F53u;
+    constexpr uint32_t PHILOX_M1 = 0xCD9E8D57u;
+    constexpr uint32_t PHILOX_W0 = 0x9E3779B9u;
+    constexpr uint32_t PHILOX_W1 = 0xBB67AE85u;
+    constexpr int PHILOX_ROUNDS = 10;
+
+    // Last counter word, so the streams used for different purposes never overlap
+    constexpr uint32_t NORMAL_STREAM = 0x4e4f524du; // "NORM"
+    constexpr uint32_t SOBOL_STREAM = 0x534f424cu;  // "SOBL"
+
+    // Voices per kernel call; two Philox lanes (four latents each) per voice
+    constexpr int CHUNK_VOICES = 32;
+    constexpr int CHUNK_LANES = CHUNK_VOICES * 2;
+
+    namespace scalar
+    {
+        struct Lanes
+        {
+            static constexpr int WIDTH = 1;
+            using F = float;
+            using U = uint32_t;
+            using M = bool;
+
+            static U loadU(const uint32_t* p) { return *p; }
+            static void storeF(float* p, F v) { *p = v; }
+            static U setU(uint32_t v) { return v; }
+            static F setF(float v) { return v; }
+            static U xorU(U a, U b) { return a ^ b; }
+            static U andU(U a, U b) { return a & b; }
+            static U orU(U a, U b) { return a | b; }
+            static U shiftRight(U a, int bits) { return a >> bits; }
+            static void mulHiLo(U a, uint32_t m, U& hi, U& lo)
+            {
+                const uint64_t product = static_cast<uint64_t>(m) * a;
+                hi = static_cast<uint32_t>(product >> 32);
+                lo = static_cast<uint32_t>(product);
+            }
+            static F toFloat(U a) { return static_cast<float>(static_cast<int32_t>(a)); }
+            static U truncate(F a) { return static_cast<uint32_t>(static_cast<int32_t>(a)); }
+            static U bitsOf(F a) { uint32_t bits; std::memcpy(&bits, &a, sizeof(bits)); return bits; }
+            static F floatOf(U a) { float value; std::memcpy(&value, &a, sizeof(value)); return value; }
+            static F add(F a, F b) { return a + b; }
+            static F sub(F a, F b) { return a - b; }
+            static F mul(F a, F b) { return a * b; }
+            static F neg(F a) { return -a; }
+            static F sqrt(F a) { return std::sqrt(a); }
+            static M less(F a, F b) { return a < b; }
+            static M equal(U a, U b) { return a == b; }
+            static F select(M mask, F a, F b) { return mask ? a : b; }
+            static F oneWhere(M mask) { return mask ? 1.0f : 0.0f; }
+        };
+
+        #include "LatentSamplerKernel.h"
+    }
+
+#if LATENT_SAMPLER_X86
+LATENT_SAMPLER_BEGIN_TARGET_SSE2
+    namespace sse2
+    {
+        struct Lanes
+        {
+            static constexpr int WIDTH = 4;
+            using F = __m128;
+            using U = __m128i;
+            using M = __m128;
+
+            static U loadU(const uint32_t* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+            static void storeF(float* p, F v) { _mm_store_ps(p, v); }
+            static U setU(uint32_t v) { return _mm_set1_epi32(static_cast<int>(v)); }
+            static F setF(float v) { return _mm_set1_ps(v); }
+            static U xorU(U a, U b) { return _mm_xor_si128(a, b); }
+            static U andU(U a, U b) { return _mm_and_si128(a, b); }
+            static U orU(U a, U b) { return _mm_or_si128(a, b); }
+            static U shiftRight(U a, int bits) { return _mm_srli_epi32(a, bits); }
+            static void mulHiLo(U a, uint32_t m, U& hi, U& lo)
+            {
+                // 64-bit products of the even lanes, then of the odd lanes shifted down
+                const __m128i multiplier = _mm_set1_epi32(static_cast<int>(m));
+                const __m128i even = _mm_mul_epu32(a, multiplier);
+                const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), multiplier);
+                const __m128i low32 = _mm_set1_epi64x(0xffffffffll);
+                lo = _mm_or_si128(_mm_and_si128(even, low32), _mm_slli_epi64(odd, 32));
+                hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(low32, odd));
+            }
+            static F toFloat(U a) { return _mm_cvtepi32_ps(a); }
+            static U truncate(F a) { return _mm_cvttps_epi32(a); }
+            static U bitsOf(F a) { return _mm_castps_si128(a); }
+            static F floatOf(U a) { return _mm_castsi128_ps(a); }
+            static F add(F a, F b) { return _mm_add_ps(a, b); }
+            static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+            static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+            static F neg(F a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+            static F sqrt(F a) { return _mm_sqrt_ps(a); }
+            static M less(F a, F b) { return _mm_cmplt_ps(a, b); }
+            static M equal(U a, U b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+            static F select(M mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+            static F oneWhere(M mask) { return _mm_and_ps(mask, _mm_set1_ps(1.0f)); }
+        };
+
+        #include "LatentSamplerKernel.h"
+    }
+LATENT_SAMPLER_END_TARGET
+
+LATENT_SAMPLER_BEGIN_TARGET_AVX2
+    namespace avx2
+    {
+        struct Lanes
+        {
+            static constexpr int WIDTH = 8;
+            using F = __m256;
+            using U = __m256i;
+            using M = __m256;
+
+            static U loadU(const uint32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+            static void storeF(float* p, F v) { _mm256_store_ps(p, v); }
+            static U setU(uint32_t v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+            static F setF(float v) { return _mm256_set1_ps(v); }
+            static U xorU(U a, U b) { return _mm256_xor_si256(a, b); }
+            static U andU(U a, U b) { return _mm256_and_si256(a, b); }
+            static U orU(U a, U b) { return _mm256_or_si256(a, b); }
+            static U shiftRight(U a, int bits) { return _mm256_srli_epi32(a, bits); }
+            static void mulHiLo(U a, uint32_t m, U& hi, U& lo)
+            {
+                const __m256i multiplier = _mm256_set1_epi32(static_cast<int>(m));
+                const __m256i even = _mm256_mul_epu32(a, multiplier);
+                const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), multiplier);
+                const __m256i low32 = _mm256_set1_epi64x(0xffffffffll);
+                lo = _mm256_or_si256(_mm256_and_si256(even, low32), _mm256_slli_epi64(odd, 32));
+                hi = _mm256_or_si256(_mm256_srli_epi64(even, 32), _mm256_andnot_si256(low32, odd));
+            }
+            static F toFloat(U a) { return _mm256_cvtepi32_ps(a); }
+            static U truncate(F a) { return _mm256_cvttps_epi32(a); }
+            static U bitsOf(F a) { return _mm256_castps_si256(a); }
+            static F floatOf(U a) { return _mm256_castsi256_ps(a); }
+            static F add(F a, F b) { return _mm256_add_ps(a, b); }
+            static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+            static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+            static F neg(F a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+            static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+            static M less(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            static M equal(U a, U b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+            static F select(M mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+            static F oneWhere(M mask) { return _mm256_and_ps(mask, _mm256_set1_ps(1.0f)); }
+        };
+
+        #include "LatentSamplerKernel.h"
+    }
+LATENT_SAMPLER_END_TARGET
+#endif
+
+    using NormalChunkFunction = void (*)(uint64_t, uint64_t, int, float*);
+
+    // nullptr for a kernel this build or CPU can't run
+    NormalChunkFunction normalChunkFor(LatentSampler::Kernel kernel)
+    {
+        switch (kernel)
+        {
+            case LatentSampler::Kernel::SCALAR: return scalar::normalChunk;
+           #if LATENT_SAMPLER_X86
+            // Same CPU detection as the decoder kernels
+            case LatentSampler::Kernel::SSE2:
+                return NativeDecoder::getActiveKernel() != NativeDecoder::Kernel::SCALAR ? sse2::normalChunk : nullptr;
+            case LatentSampler::Kernel::AVX2:
+                return NativeDecoder::getActiveKernel() == NativeDecoder::Kernel::AVX2
+                    || NativeDecoder::getActiveKernel() == NativeDecoder::Kernel::AVX512 ? avx2::normalChunk : nullptr;
+           #else
+            case LatentSampler::Kernel::SSE2:
+            case LatentSampler::Kernel::AVX2:
+                break;
+           #endif
+        }
+        return nullptr;
+    }
+
+    NormalChunkFunction activeNormalChunk()
+    {
+        static const NormalChunkFunction chunk = [] {
+            for (auto kernel : { LatentSampler::Kernel::AVX2, LatentSampler::Kernel::SSE2 })
+            {
+                if (auto function = normalChunkFor(kernel))
+                {
+                    return function;
+                }
+            }
+            return normalChunkFor(LatentSampler::Kernel::SCALAR);
+        }();
+        return chunk;
+    }
+
+    void runNormalChunks(NormalChunkFunction chunk, uint64_t seed, uint64_t firstVoice, int numVoices, float* latents)
+    {
+        for (int first = 0; first < numVoices; first += CHUNK_VOICES)
+        {
+            chunk(seed, firstVoice + static_cast<uint64_t>(first), std::min(CHUNK_VOICES, numVoices - first),
+                  latents + static_cast<size_t>(first) * LATENT_DIM);
+        }
+    }
+
+    // Joe-Kuo direction numbers for the first eight Sobol dimensions
+    struct SobolDirections
+    {
+        uint32_t v[LATENT_DIM][32];
+
+        SobolDirections()
+        {
+            struct Primitive { int degree; uint32_t coefficients; uint32_t m[5]; };
+            static constexpr Primitive primitives[LATENT_DIM - 1] = {
+                { 1, 0, { 1 } },
+                { 2, 1, { 1, 3 } },
+                { 3, 1, { 1, 3, 1 } },
+                { 3, 2, { 1, 1, 1 } },
+                { 4, 1, { 1, 1, 3, 3 } },
+                { 4, 4, { 1, 3, 5, 13 } },
+                { 5, 2, { 1, 1, 5, 5, 17 } }
+            };
+
+            for (int bit = 0; bit < 32; ++bit)
+            {
+                v[0][bit] = 1u << (31 - bit);
+            }
+
+            for (int dim = 1; dim < LATENT_DIM; ++dim)
+            {
+                const auto& p = primitives[dim - 1];
+                for (int bit = 0; bit < 32; ++bit)
+                {
+                    if (bit < p.degree)
+                    {
+                        v[dim][bit] = p.m[bit] << (31 - bit);
+                        continue;
+                    }
+
+                    uint32_t value = v[dim][bit - p.degree] ^ (v[dim][bit - p.degree] >> p.degree);
+                    for (int k = 1; k < p.degree; ++k)
+                    {
+                        if ((p.coefficients >> (p.degree - 1 - k)) & 1u)
+                        {
+                            value ^= v[dim][bit - k];
+                        }
+                    }
+                    v[dim][bit] = value;
+                }
+            }
+        }
+
+        uint32_t sample(uint32_t index, int dim) const
+        {
+            uint32_t result = 0;
+            for (int bit = 0; index != 0; ++bit, index >>= 1)
+            {
+                result ^= (index & 1u) ? v[dim][bit] : 0u;
+            }
+            return result;
+        }
+    };
+
+    const SobolDirections& sobolDirections()
+    {
+        static const SobolDirections directions;
+        return directions;
+    }
+
+    uint32_t reverseBits(uint32_t x)
+    {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Hash-based Owen scrambling (Laine-Karras permutation on reversed bits, after Burley 2020)
+    uint32_t nestedUniformScramble(uint32_t x, uint32_t seed)
+    {
+        x = reverseBits(x);
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return reverseBits(x);
+    }
+
+    // Acklam's rational approximation of the inverse normal CDF (relative error < 1.2e-9)
+    double inverseNormalCdf(double p)
+    {
+        static constexpr double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                                         1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+        static constexpr double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                                         6.680131188771972e+01, -1.328068155288572e+01 };
+        static constexpr double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                                        -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+        static constexpr double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                                        3.754408661907416e+00 };
+        constexpr double low = 0.02425;
+
+        if (p < low)
+        {
+            const double q = std::sqrt(-2.0 * std::log(p));
+            return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+                 / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+        }
+        if (p > 1.0 - low)
+        {
+            const double q = std::sqrt(-2.0 * std::log(1.0 - p));
+            return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+                 / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+        }
+
+        const double q = p - 0.5;
+        const double r = q * q;
+        return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+             / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+    }
+
+    // Index shuffle seed followed by one scramble seed per dimension
+    using ScrambleSeeds = std::array<uint32_t, 12>;
+
+    ScrambleSeeds makeScrambleSeeds(uint64_t seed, uint64_t block)
+    {
+        ScrambleSeeds seeds{};
+        for (uint32_t word = 0; word < seeds.size(); word += 4)
+        {
+            const auto bits = LatentSampler::philox({ static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32), word / 4, SOBOL_STREAM }, seed);
+            std::copy(bits.begin(), bits.end(), seeds.begin() + word);
+        }
+        return seeds;
+    }
+
+    void generateSobol(uint64_t seed, uint64_t firstVoice, int numVoices, float* latents)
+    {
+        static_assert(1 + LATENT_DIM <= 12, "One scramble seed per dimension");
+        const auto& directions = sobolDirections();
+
+        // Each run of 2^32 voices gets its own scramble
+        uint64_t scrambledBlock = ~0ull;
+        ScrambleSeeds seeds{};
+
+        for (int i = 0; i < numVoices; ++i)
+        {
+            const uint64_t voice = firstVoice + static_cast<uint64_t>(i);
+            if ((voice >> 32) != scrambledBlock)
+            {
+                scrambledBlock = voice >> 32;
+                seeds = makeScrambleSeeds(seed, scrambledBlock);
+            }
+
+            // Shuffling the index with an Owen scramble keeps every aligned
+            // power-of-two run of voices (and so every bank) stratified
+            const uint32_t index = nestedUniformScramble(static_cast<uint32_t>(voice), seeds[0]);
+
+            for (int dim = 0; dim < LATENT_DIM; ++dim)
+            {
+                const uint32_t x = nestedUniformScramble(directions.sample(index, dim), seeds[1 + dim]);
+                const double u = (static_cast<double>(x >> 8) + 0.5) * (1.0 / 16777216.0);
+                latents[static_cast<size_t>(i) * LATENT_DIM + dim] = static_cast<float>(inverseNormalCdf(u));
+            }
+        }
+    }
+}
+
+std::array<uint32_t, 4> LatentSampler::philox(std::array<uint32_t, 4> counter, uint64_t key)
+{
+    uint32_t k0 = static_cast<uint32_t>(key);
+    uint32_t k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < PHILOX_ROUNDS; ++round)
+    {
+        const uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * counter[0];
+        const uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * counter[2];
+        counter = { static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ k0, static_cast<uint32_t>(p1),
+                    static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ k1, static_cast<uint32_t>(p0) };
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    return counter;
+}
+
+void LatentSampler::generate(uint64_t seed, uint64_t firstVoice, int numVoices, Mode mode, float* latents)
+{
+    if (numVoices <= 0)
+    {
+        return;
+    }
+
+    if (mode == Mode::SOBOL)
+    {
+        generateSobol(seed, firstVoice, numVoices, latents);
+        return;
+    }
+
+    runNormalChunks(activeNormalChunk(), seed, firstVoice, numVoices, latents);
+}
+
+bool LatentSampler::isKernelSupported(Kernel kernel)
+{
+    return normalChunkFor(kernel) != nullptr;
+}
+
+void LatentSampler::generateNormal(Kernel kernel, uint64_t seed, uint64_t firstVoice, int numVoices, float* latents)
+{
+    const auto chunk = normalChunkFor(kernel);
+    jassert(chunk != nullptr);
+    if (chunk != nullptr && numVoices > 0)
+    {
+        runNormalChunks(chunk, seed, firstVoice, numVoices, latents);
+    }
+}
+
+std::vector<float> LatentSampler::generate(uint64_t seed, uint64_t firstVoice, int numVoices, Mode mode)
+{
+    std::vector<float> latents(static_cast<size_t>(std::max(0, numVoices)) * LATENT_DIM);
+    generate(seed, firstVoice, numVoices, mode, latents.data());
+    return latents;
+}
+
+std::vector<float> LatentSampler::generateBanks(uint64_t seed, uint64_t firstBank, int numBanks, Mode mode)
+{
+    return generate(seed, firstBank * VOICES_PER_BANK, std::max(0, numBanks) * VOICES_PER_BANK, mode);
+}
+
+uint64_t LatentSampler::makeEntropySeed()
+{
+    std::random_device device;
+    const uint64_t entropy = (static_cast<uint64_t>(device()) << 32) ^ device();
+    const auto ticks = static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+
+    // random_device may be deterministic on some platforms, so the clock is mixed in too
+    const auto mixed = philox({ static_cast<uint32_t>(ticks), static_cast<uint32_t>(ticks >> 32), 0, 0 }, entropy);
+    return (static_cast<uint64_t>(mixed[0]) << 32) | mixed[1];
+}
+
+const char* LatentSampler::getModeName(Mode mode)
+{
+    return mode == Mode::SOBOL ? "scrambled Sobol" : "normal";
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Counter-based generator for random-bank latents.
+//
+// Every latent is a pure function of (seed, voice index): voice i of a stream
+// is built from Philox4x32-10 blocks keyed by the seed, with the voice index as
+// the counter. Nothing is carried from one call to the next, so any bank can be
+// rebuilt from (seed, bank index) and ranges can be generated in parallel
+// without coordinating.
+//
+// NORMAL draws standard-normal latents with a branchless Box-Muller transform,
+// run a batch of voices at a time so it vectorises (with an AVX2 build of the
+// same loop where available). Results are bit-identical across CPU paths.
+//
+// SOBOL draws from an Owen-scrambled 8-dimensional Sobol sequence mapped through
+// the inverse normal CDF. Banks start on multiples of VOICES_PER_BANK, so each
+// bank is a stratified 32-point set and covers the latent space more evenly
+// than 32 independent draws.
+class LatentSampler
+{
+public:
+    enum class Mode { NORMAL, SOBOL };
+
+    static constexpr int LATENT_DIM = 8;
+    static constexpr int VOICES_PER_BANK = 32;
+
+    // Latents for voices [firstVoice, firstVoice + numVoices) of the stream,
+    // written as numVoices rows of LATENT_DIM floats
+    static void generate(uint64_t seed, uint64_t firstVoice, int numVoices, Mode mode, float* latents);
+    static std::vector<float> generate(uint64_t seed, uint64_t firstVoice, int numVoices, Mode mode);
+
+    // Bank b is voices [b * VOICES_PER_BANK, (b + 1) * VOICES_PER_BANK)
+    static std::vector<float> generateBanks(uint64_t seed, uint64_t firstBank, int numBanks, Mode mode);
+
+    // A fresh seed for sessions that didn't ask for a fixed one
+    static uint64_t makeEntropySeed();
+
+    // One Philox4x32-10 block
+    static std::array<uint32_t, 4> philox(std::array<uint32_t, 4> counter, uint64_t key);
+
+    // The builds of the NORMAL kernel. generate() uses the widest one the CPU
+    // supports; these are for checking that every one gives the same bits.
+    enum class Kernel { SCALAR, SSE2, AVX2 };
+    static bool isKernelSupported(Kernel kernel);
+    static void generateNormal(Kernel kernel, uint64_t seed, uint64_t firstVoice, int numVoices, float* latents);
+
+    static const char* getModeName(Mode mode);
+};
@@ -0,0 +1,128 @@
+// Body of LatentSampler's normal-distribution kernel, written against a `Lanes`
+// type that the including namespace defines (scalar, SSE2 or AVX2 operations).
+// LatentSampler.cpp includes it once per instruction set, inside a region
+// compiled for that instruction set, so there is deliberately no include guard.
+//
+// Every path performs the same IEEE operations in the same order (no FMA, and
+// sqrt is exact), so all of them produce the same bits for a given seed.
+
+// Cephes-style logf for x in (0, 1]
+inline Lanes::F logUnit(Lanes::F x)
+{
+    const auto bits = Lanes::bitsOf(x);
+    auto exponent = Lanes::sub(Lanes::toFloat(Lanes::andU(Lanes::shiftRight(bits, 23), Lanes::setU(0xff))), Lanes::setF(126.0f));
+    auto m = Lanes::floatOf(Lanes::orU(Lanes::andU(bits, Lanes::setU(0x807fffffu)), Lanes::setU(0x3f000000u))); // [0.5, 1)
+
+    const auto small = Lanes::less(m, Lanes::setF(0.707106781186547524f));
+    exponent = Lanes::sub(exponent, Lanes::oneWhere(small));
+    m = Lanes::select(small, Lanes::sub(Lanes::add(m, m), Lanes::setF(1.0f)), Lanes::sub(m, Lanes::setF(1.0f)));
+
+    const auto z = Lanes::mul(m, m);
+    auto y = Lanes::setF(7.0376836292e-2f);
+    y = Lanes::sub(Lanes::mul(y, m), Lanes::setF(1.1514610310e-1f));
+    y = Lanes::add(Lanes::mul(y, m), Lanes::setF(1.1676998740e-1f));
+    y = Lanes::sub(Lanes::mul(y, m), Lanes::setF(1.2420140846e-1f));
+    y = Lanes::add(Lanes::mul(y, m), Lanes::setF(1.4249322787e-1f));
+    y = Lanes::sub(Lanes::mul(y, m), Lanes::setF(1.6668057665e-1f));
+    y = Lanes::add(Lanes::mul(y, m), Lanes::setF(2.0000714765e-1f));
+    y = Lanes::sub(Lanes::mul(y, m), Lanes::setF(2.4999993993e-1f));
+    y = Lanes::add(Lanes::mul(y, m), Lanes::setF(3.3333331174e-1f));
+    y = Lanes::mul(Lanes::mul(y, m), z);
+    y = Lanes::add(y, Lanes::mul(Lanes::setF(-2.12194440e-4f), exponent));
+    y = Lanes::add(y, Lanes::mul(Lanes::setF(-0.5f), z));
+    return Lanes::add(Lanes::add(m, y), Lanes::mul(Lanes::setF(0.693359375f), exponent));
+}
+
+// sin and cos of 2 * pi * u for u in [0, 1): quadrant plus polynomials on [-pi/4, pi/4)
+inline void sinCosTurn(Lanes::F u, Lanes::F& sine, Lanes::F& cosine)
+{
+    const auto t = Lanes::add(Lanes::mul(u, Lanes::setF(4.0f)), Lanes::setF(0.5f));
+    const auto whole = Lanes::truncate(t);
+    const auto quadrant = Lanes::andU(whole, Lanes::setU(3));
+    const auto x = Lanes::mul(Lanes::sub(Lanes::sub(t, Lanes::toFloat(whole)), Lanes::setF(0.5f)), Lanes::setF(1.57079632679489661923f));
+    const auto z = Lanes::mul(x, x);
+
+    auto s = Lanes::add(Lanes::mul(Lanes::setF(-1.9515295891e-4f), z), Lanes::setF(8.3321608736e-3f));
+    s = Lanes::sub(Lanes::mul(s, z), Lanes::setF(1.6666654611e-1f));
+    s = Lanes::add(x, Lanes::mul(Lanes::mul(x, z), s));
+
+    auto c = Lanes::sub(Lanes::mul(Lanes::setF(2.443315711809948e-5f), z), Lanes::setF(1.388731625493765e-3f));
+    c = Lanes::add(Lanes::mul(c, z), Lanes::setF(4.166664568298827e-2f));
+    c = Lanes::add(Lanes::sub(Lanes::setF(1.0f), Lanes::mul(Lanes::setF(0.5f), z)), Lanes::mul(Lanes::mul(z, z), c));
+
+    const auto q0 = Lanes::equal(quadrant, Lanes::setU(0));
+    const auto q1 = Lanes::equal(quadrant, Lanes::setU(1));
+    const auto q2 = Lanes::equal(quadrant, Lanes::setU(2));
+    sine = Lanes::select(q0, s, Lanes::select(q1, c, Lanes::select(q2, Lanes::neg(s), Lanes::neg(c))));
+    cosine = Lanes::select(q0, c, Lanes::select(q1, Lanes::neg(s), Lanes::select(q2, Lanes::neg(c), s)));
+}
+
+// One chunk of up to CHUNK_VOICES voices. Lane 2v holds dimensions 0-3 of voice v
+// and lane 2v + 1 dimensions 4-7; each lane is one Philox block whose four words
+// make two Box-Muller pairs.
+inline void normalChunk(uint64_t seed, uint64_t firstVoice, int numVoices, float* latents)
+{
+    alignas(32) uint32_t counters[4][CHUNK_LANES];
+    alignas(32) float normals[4][CHUNK_LANES];
+
+    const int lanes = numVoices * 2;
+    const int paddedLanes = (lanes + Lanes::WIDTH - 1) / Lanes::WIDTH * Lanes::WIDTH;
+    for (int lane = 0; lane < paddedLanes; ++lane)
+    {
+        const uint64_t voice = firstVoice + static_cast<uint64_t>(lane >> 1);
+        counters[0][lane] = static_cast<uint32_t>(voice);
+        counters[1][lane] = static_cast<uint32_t>(voice >> 32);
+        counters[2][lane] = static_cast<uint32_t>(lane & 1);
+        counters[3][lane] = NORMAL_STREAM;
+    }
+
+    for (int lane = 0; lane < paddedLanes; lane += Lanes::WIDTH)
+    {
+        auto c0 = Lanes::loadU(counters[0] + lane);
+        auto c1 = Lanes::loadU(counters[1] + lane);
+        auto c2 = Lanes::loadU(counters[2] + lane);
+        auto c3 = Lanes::loadU(counters[3] + lane);
+
+        uint32_t k0 = static_cast<uint32_t>(seed);
+        uint32_t k1 = static_cast<uint32_t>(seed >> 32);
+        for (int round = 0; round < PHILOX_ROUNDS; ++round)
+        {
+            Lanes::U hi0, lo0, hi1, lo1;
+            Lanes::mulHiLo(c0, PHILOX_M0, hi0, lo0);
+            Lanes::mulHiLo(c2, PHILOX_M1, hi1, lo1);
+            c0 = Lanes::xorU(Lanes::xorU(hi1, c1), Lanes::setU(k0));
+            c1 = lo1;
+            c2 = Lanes::xorU(Lanes::xorU(hi0, c3), Lanes::setU(k1));
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        // Top 24 bits of each word; radii come from (0, 1] so log never sees zero
+        const auto unit = Lanes::setF(1.0f / 16777216.0f);
+        const auto ua = Lanes::mul(Lanes::add(Lanes::toFloat(Lanes::shiftRight(c0, 8)), Lanes::setF(1.0f)), unit);
+        const auto va = Lanes::mul(Lanes::toFloat(Lanes::shiftRight(c1, 8)), unit);
+        const auto ub = Lanes::mul(Lanes::add(Lanes::toFloat(Lanes::shiftRight(c2, 8)), Lanes::setF(1.0f)), unit);
+        const auto vb = Lanes::mul(Lanes::toFloat(Lanes::shiftRight(c3, 8)), unit);
+
+        const auto ra = Lanes::sqrt(Lanes::mul(Lanes::setF(-2.0f), logUnit(ua)));
+        const auto rb = Lanes::sqrt(Lanes::mul(Lanes::setF(-2.0f), logUnit(ub)));
+        Lanes::F sa, ca, sb, cb;
+        sinCosTurn(va, sa, ca);
+        sinCosTurn(vb, sb, cb);
+
+        Lanes::storeF(normals[0] + lane, Lanes::mul(ra, ca));
+        Lanes::storeF(normals[1] + lane, Lanes::mul(ra, sa));
+        Lanes::storeF(normals[2] + lane, Lanes::mul(rb, cb));
+        Lanes::storeF(normals[3] + lane, Lanes::mul(rb, sb));
+    }
+
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        float* out = latents + (lane >> 1) * LATENT_DIM + (lane & 1) * 4;
+        out[0] = normals[0][lane];
+        out[1] = normals[1][lane];
+        out[2] = normals[2][lane];
+        out[3] = normals[3][lane];
+    }
+}
@@ -0,0 +1,648 @@
+#include "NativeDecoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define NATIVE_DECODER_X86 1
+ #include <immintrin.h>
+ #if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+  #define NATIVE_DECODER_TARGET(isa)
+ #else
+  #define NATIVE_DECODER_TARGET(isa) __attribute__((target(isa)))
+ #endif
+#else
+ #define NATIVE_DECODER_X86 0
+#endif
+
+namespace
+{
+    constexpr char BLOB_MAGIC[8] = { 'N', 'D', '7', 'N', 'A', 'T', 'V', '1' };
+    constexpr uint32_t BLOB_VERSION = 1;
+    constexpr int HEADER_SIZE = 64;
+    constexpr int ROWS_PER_BLOCK = 64;
+
+    struct BlobHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t numOps;
+        uint32_t latentDim;
+        uint32_t numParams;
+        uint32_t numClasses;
+        uint32_t reserved0;
+        uint64_t sourceModelHash;
+        uint8_t reserved[24];
+    };
+    static_assert(sizeof(BlobHeader) == HEADER_SIZE, "Header layout is part of the blob format");
+
+    using DotFunction = float (*)(const float*, const float*, int);
+
+    float dotScalar(const float* a, const float* b, int n)
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < n; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+#if NATIVE_DECODER_X86
+    NATIVE_DECODER_TARGET("sse2")
+    float dotSSE(const float* a, const float* b, int n)
+    {
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        int i = 0;
+
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+        float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+        for (; i < n; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    NATIVE_DECODER_TARGET("avx2,fma")
+    float dotAVX2(const float* a, const float* b, int n)
+    {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        int i = 0;
+
+        for (; i + 16 <= n; i += 16)
+        {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        }
+
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        }
+
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, _mm256_add_ps(acc0, acc1));
+        float sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+
+        for (; i < n; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    NATIVE_DECODER_TARGET("avx512f")
+    float dotAVX512(const float* a, const float* b, int n)
+    {
+        __m512 acc0 = _mm512_setzero_ps();
+        __m512 acc1 = _mm512_setzero_ps();
+        int i = 0;
+
+        for (; i + 32 <= n; i += 32)
+        {
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+        }
+
+        for (; i + 16 <= n; i += 16)
+        {
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        }
+
+        float sum = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+
+        for (; i < n; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    NATIVE_DECODER_TARGET("avx2")
+    int32_t dotInt8AVX2(const int8_t* a, const int8_t* b, int n)
+    {
+        // Sign-extend to int16 and multiply-add pairs into int32 lanes; exact for any n we use
+        __m256i acc = _mm256_setzero_si256();
+        int i = 0;
+
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m256i wa = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+            const __m256i wb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(wa, wb));
+        }
+
+        alignas(32) int32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        int32_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+
+        for (; i < n; ++i)
+        {
+            sum += static_cast<int32_t>(a[i]) * b[i];
+        }
+        return sum;
+    }
+
+    bool cpuSupports(NativeDecoder::Kernel kernel)
+    {
+       #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4] = {};
+        __cpuid(info, 1);
+        const bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        const bool sse2 = (info[3] & (1 << 26)) != 0;
+        __cpuidex(info, 7, 0);
+        const bool avx2 = (info[1] & (1 << 5)) != 0;
+        const bool avx512f = (info[1] & (1 << 16)) != 0 && osSavesAvx && (_xgetbv(0) & 0xE6) == 0xE6;
+
+        switch (kernel)
+        {
+            case NativeDecoder::Kernel::AVX512: return avx512f;
+            case NativeDecoder::Kernel::AVX2:   return osSavesAvx && avx2 && fma;
+            case NativeDecoder::Kernel::SSE:    return sse2;
+            case NativeDecoder::Kernel::SCALAR: return true;
+        }
+        return false;
+       #else
+        __builtin_cpu_init();
+        switch (kernel)
+        {
+            case NativeDecoder::Kernel::AVX512: return __builtin_cpu_supports("avx512f");
+            case NativeDecoder::Kernel::AVX2:   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            case NativeDecoder::Kernel::SSE:    return __builtin_cpu_supports("sse2");
+            case NativeDecoder::Kernel::SCALAR: return true;
+        }
+        return false;
+       #endif
+    }
+#endif
+
+    NativeDecoder::Kernel detectKernel()
+    {
+       #if NATIVE_DECODER_X86
+        for (auto kernel : { NativeDecoder::Kernel::AVX512, NativeDecoder::Kernel::AVX2, NativeDecoder::Kernel::SSE })
+        {
+            if (cpuSupports(kernel))
+            {
+                return kernel;
+            }
+        }
+       #endif
+        return NativeDecoder::Kernel::SCALAR;
+    }
+
+    DotFunction dotFunctionFor(NativeDecoder::Kernel kernel)
+    {
+        switch (kernel)
+        {
+           #if NATIVE_DECODER_X86
+            case NativeDecoder::Kernel::AVX512: return dotAVX512;
+            case NativeDecoder::Kernel::AVX2:   return dotAVX2;
+            case NativeDecoder::Kernel::SSE:    return dotSSE;
+           #endif
+            default:                            return dotScalar;
+        }
+    }
+
+    using Int8DotFunction = int32_t (*)(const int8_t*, const int8_t*, int);
+
+    int32_t dotInt8Scalar(const int8_t* a, const int8_t* b, int n)
+    {
+        int32_t sum = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            sum += static_cast<int32_t>(a[i]) * b[i];
+        }
+        return sum;
+    }
+
+    Int8DotFunction activeInt8Dot()
+    {
+       #if NATIVE_DECODER_X86
+        static const Int8DotFunction dot = (NativeDecoder::getActiveKernel() == NativeDecoder::Kernel::AVX2
+                                            || NativeDecoder::getActiveKernel() == NativeDecoder::Kernel::AVX512)
+            ? dotInt8AVX2 : dotInt8Scalar;
+        return dot;
+       #else
+        return dotInt8Scalar;
+       #endif
+    }
+
+    // Symmetric per-row int8: value ~= q * scale
+    float quantizeRow(const float* values, int n, int8_t* quantized)
+    {
+        float maxAbs = 0.0f;
+        for (int i = 0; i < n; ++i)
+            maxAbs = std::max(maxAbs, std::abs(values[i]));
+
+        const float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+        const float inverse = 1.0f / scale;
+        for (int i = 0; i < n; ++i)
+            quantized[i] = static_cast<int8_t>(std::lrint(std::clamp(values[i] * inverse, -127.0f, 127.0f)));
+
+        return scale;
+    }
+
+    // One block of activations in int8, a scale per row. Quantised once per dense
+    // layer and shared by all of its outputs, including every argmax group.
+    struct QuantizedActivations
+    {
+        std::vector<int8_t> values;
+        std::vector<float> scales;
+
+        void quantize(const float* input, int numRows, int width)
+        {
+            values.resize(static_cast<size_t>(numRows) * width);
+            scales.resize(static_cast<size_t>(numRows));
+            for (int row = 0; row < numRows; ++row)
+                scales[row] = quantizeRow(input + static_cast<size_t>(row) * width, width, values.data() + static_cast<size_t>(row) * width);
+        }
+    };
+
+    QuantizedActivations& quantizeForLayer(const float* input, int numRows, int width)
+    {
+        thread_local QuantizedActivations activations;
+        activations.quantize(input, numRows, width);
+        return activations;
+    }
+
+    const DotFunction& activeDot()
+    {
+        static const DotFunction dot = dotFunctionFor(NativeDecoder::getActiveKernel());
+        return dot;
+    }
+
+    template <typename T>
+    bool readValue(const uint8_t*& cursor, const uint8_t* end, T& value)
+    {
+        if (static_cast<size_t>(end - cursor) < sizeof(T))
+        {
+            return false;
+        }
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    bool readFloats(const uint8_t*& cursor, const uint8_t* end, size_t count, std::vector<float>& values)
+    {
+        if (static_cast<size_t>(end - cursor) / sizeof(float) < count)
+        {
+            return false;
+        }
+        values.resize(count);
+        std::memcpy(values.data(), cursor, count * sizeof(float));
+        cursor += count * sizeof(float);
+        return true;
+    }
+}
+
+NativeDecoder::NativeDecoder() = default;
+NativeDecoder::~NativeDecoder() = default;
+
+NativeDecoder::Kernel NativeDecoder::getActiveKernel()
+{
+    static const Kernel kernel = detectKernel();
+    return kernel;
+}
+
+const char* NativeDecoder::getKernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+        case Kernel::AVX512: return "AVX-512";
+        case Kernel::AVX2:   return "AVX2";
+        case Kernel::SSE:    return "SSE";
+        case Kernel::SCALAR: return "scalar";
+    }
+    return "unknown";
+}
+
+size_t NativeDecoder::getNumWeights() const
+{
+    size_t count = 0;
+    for (const auto& layer : layers)
+    {
+        count += layer.weights.size() + layer.quantizedWeights.size() + layer.bias.size();
+    }
+    return count;
+}
+
+bool NativeDecoder::loadFromFile(const juce::File& file)
+{
+    juce::MemoryBlock data;
+    if (!file.existsAsFile() || !file.loadFileAsData(data))
+    {
+        return false;
+    }
+
+    if (!loadFromMemory(data.getData(), data.getSize()))
+    {
+        std::cerr << "NativeDecoder: " << file.getFullPathName() << " is not a valid decoder blob" << std::endl;
+        return false;
+    }
+
+    std::cout << "NativeDecoder: Loaded " << layers.size() << " layers (" << getNumWeights()
+              << " weights) from " << file.getFullPathName() << std::endl;
+    return true;
+}
+
+bool NativeDecoder::loadFromMemory(const void* data, size_t size)
+{
+    layers.clear();
+
+    const auto* cursor = static_cast<const uint8_t*>(data);
+    const auto* end = cursor + size;
+
+    BlobHeader header{};
+    if (!readValue(cursor, end, header)
+        || std::memcmp(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0
+        || header.version != BLOB_VERSION
+        || header.numParams != static_cast<uint32_t>(DX7Voice::N_PARAMS)
+        || header.numClasses == 0 || header.numClasses > 256
+        || header.latentDim == 0)
+    {
+        return false;
+    }
+
+    std::vector<Layer> loaded;
+    int width = static_cast<int>(header.latentDim);
+    int widest = width;
+
+    for (uint32_t op = 0; op < header.numOps; ++op)
+    {
+        Layer layer;
+        uint32_t type = 0, inDim = 0, outDim = 0;
+
+        if (!readValue(cursor, end, type) || !readValue(cursor, end, inDim)
+            || !readValue(cursor, end, outDim) || !readValue(cursor, end, layer.param))
+        {
+            return false;
+        }
+
+        layer.type = static_cast<OpType>(type);
+        layer.inDim = static_cast<int>(inDim);
+        layer.outDim = static_cast<int>(outDim);
+
+        // Every layer must consume what the previous one produced
+        if (layer.inDim != width || layer.outDim <= 0)
+        {
+            return false;
+        }
+
+        switch (layer.type)
+        {
+            case OpType::LINEAR:
+                if (!readFloats(cursor, end, static_cast<size_t>(inDim) * outDim, layer.weights)
+                    || !readFloats(cursor, end, outDim, layer.bias))
+                    return false;
+                break;
+
+            case OpType::LAYER_NORM:
+                if (outDim != inDim
+                    || !readFloats(cursor, end, inDim, layer.weights)
+                    || !readFloats(cursor, end, inDim, layer.bias))
+                    return false;
+                break;
+
+            case OpType::RELU:
+            case OpType::LEAKY_RELU:
+            case OpType::GELU:
+            case OpType::TANH:
+            case OpType::SIGMOID:
+                if (outDim != inDim)
+                    return false;
+                break;
+
+            default:
+                return false;
+        }
+
+        width = layer.outDim;
+        widest = std::max(widest, width);
+        loaded.push_back(std::move(layer));
+    }
+
+    // The argmax is fused into the last layer, which has to be the logits projection
+    if (loaded.empty() || loaded.back().type != OpType::LINEAR
+        || width != static_cast<int>(header.numParams * header.numClasses) || cursor != end)
+    {
+        return false;
+    }
+
+    layers = std::move(loaded);
+    sourceModelHash = header.sourceModelHash;
+    latentDim = static_cast<int>(header.latentDim);
+    numClasses = static_cast<int>(header.numClasses);
+    maxWidth = widest;
+    return true;
+}
+
+void NativeDecoder::runLayer(const Layer& layer, const float* input, float* output, int numRows) const
+{
+    const int in = layer.inDim;
+    const int out = layer.outDim;
+
+    switch (layer.type)
+    {
+        case OpType::LINEAR:
+        {
+            if (!layer.quantizedWeights.empty())
+            {
+                const auto& quantized = quantizeForLayer(input, numRows, in);
+                runLinearInt8(layer, quantized.values.data(), quantized.scales.data(), numRows, 0, out, output, out);
+            }
+            else
+            {
+                runLinear(layer, input, numRows, 0, out, output, out);
+            }
+            break;
+        }
+
+        case OpType::LAYER_NORM:
+        {
+            for (int row = 0; row < numRows; ++row)
+            {
+                const float* x = input + static_cast<size_t>(row) * in;
+                float* y = output + static_cast<size_t>(row) * out;
+
+                float mean = 0.0f;
+                for (int i = 0; i < in; ++i)
+                    mean += x[i];
+                mean /= static_cast<float>(in);
+
+                float variance = 0.0f;
+                for (int i = 0; i < in; ++i)
+                    variance += (x[i] - mean) * (x[i] - mean);
+                variance /= static_cast<float>(in);
+
+                const float scale = 1.0f / std::sqrt(variance + layer.param);
+                for (int i = 0; i < in; ++i)
+                    y[i] = (x[i] - mean) * scale * layer.weights[i] + layer.bias[i];
+            }
+            break;
+        }
+
+        default:
+        {
+            const size_t count = static_cast<size_t>(numRows) * in;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float x = input[i];
+                switch (layer.type)
+                {
+                    case OpType::RELU:       output[i] = x > 0.0f ? x : 0.0f; break;
+                    case OpType::LEAKY_RELU: output[i] = x > 0.0f ? x : x * layer.param; break;
+                    case OpType::GELU:       output[i] = 0.5f * x * (1.0f + std::erf(x * 0.70710678118654752f)); break;
+                    case OpType::TANH:       output[i] = std::tanh(x); break;
+                    case OpType::SIGMOID:    output[i] = 1.0f / (1.0f + std::exp(-x)); break;
+                    default:                 output[i] = x; break;
+                }
+            }
+            break;
+        }
+    }
+}
+
+void NativeDecoder::runLinear(const Layer& layer, const float* input, int numRows,
+                              int firstOutput, int numOutputs, float* output, int outputStride) const
+{
+    const int in = layer.inDim;
+
+    // Weight-stationary: each weight row is used for every row of the block while it is in L1
+    const DotFunction dot = activeDot();
+    for (int i = 0; i < numOutputs; ++i)
+    {
+        const int o = firstOutput + i;
+        const float* w = layer.weights.data() + static_cast<size_t>(o) * in;
+        for (int row = 0; row < numRows; ++row)
+        {
+            output[static_cast<size_t>(row) * outputStride + i] = dot(w, input + static_cast<size_t>(row) * in, in) + layer.bias[o];
+        }
+    }
+}
+
+void NativeDecoder::runLinearInt8(const Layer& layer, const int8_t* input, const float* inputScales, int numRows,
+                                  int firstOutput, int numOutputs, float* output, int outputStride) const
+{
+    const int in = layer.inDim;
+    const Int8DotFunction dot = activeInt8Dot();
+
+    for (int i = 0; i < numOutputs; ++i)
+    {
+        const int o = firstOutput + i;
+        const int8_t* w = layer.quantizedWeights.data() + static_cast<size_t>(o) * in;
+        for (int row = 0; row < numRows; ++row)
+        {
+            const int32_t acc = dot(w, input + static_cast<size_t>(row) * in, in);
+            output[static_cast<size_t>(row) * outputStride + i] = static_cast<float>(acc) * layer.rowScales[o] * inputScales[row] + layer.bias[o];
+        }
+    }
+}
+
+void NativeDecoder::runFinalLayerWithArgmax(const Layer& layer, const float* input, int numRows, uint8_t* parameters) const
+{
+    // One parameter's logits for every row of the block; reduced before moving on
+    thread_local std::vector<float> logits;
+    logits.resize(static_cast<size_t>(numRows) * numClasses);
+
+    const bool int8 = !layer.quantizedWeights.empty();
+    const QuantizedActivations* quantized = int8 ? &quantizeForLayer(input, numRows, layer.inDim) : nullptr;
+
+    for (int param = 0; param < DX7Voice::N_PARAMS; ++param)
+    {
+        if (int8)
+            runLinearInt8(layer, quantized->values.data(), quantized->scales.data(), numRows,
+                          param * numClasses, numClasses, logits.data(), numClasses);
+        else
+            runLinear(layer, input, numRows, param * numClasses, numClasses, logits.data(), numClasses);
+
+        for (int row = 0; row < numRows; ++row)
+        {
+            // First maximum wins, as with torch::argmax
+            const float* group = logits.data() + static_cast<size_t>(row) * numClasses;
+            int best = 0;
+            for (int c = 1; c < numClasses; ++c)
+            {
+                if (group[c] > group[best])
+                    best = c;
+            }
+            parameters[static_cast<size_t>(row) * DX7Voice::N_PARAMS + param] = static_cast<uint8_t>(best);
+        }
+    }
+}
+
+void NativeDecoder::quantizeToInt8()
+{
+    for (auto& layer : layers)
+    {
+        if (layer.type != OpType::LINEAR || !layer.quantizedWeights.empty())
+        {
+            continue;
+        }
+
+        layer.quantizedWeights.resize(layer.weights.size());
+        layer.rowScales.resize(static_cast<size_t>(layer.outDim));
+
+        for (int o = 0; o < layer.outDim; ++o)
+        {
+            const size_t offset = static_cast<size_t>(o) * layer.inDim;
+            layer.rowScales[o] = quantizeRow(layer.weights.data() + offset, layer.inDim, layer.quantizedWeights.data() + offset);
+        }
+
+        // The float weights aren't needed any more
+        std::vector<float>().swap(layer.weights);
+    }
+}
+
+bool NativeDecoder::isQuantized() const
+{
+    return std::any_of(layers.begin(), layers.end(), [](const Layer& layer) { return !layer.quantizedWeights.empty(); });
+}
+
+void NativeDecoder::decode(const float* latents, int numVoices, uint8_t* parameters) const
+{
+    if (!isLoaded() || numVoices <= 0)
+    {
+        return;
+    }
+
+    // Ping-pong activations, sized once per thread for the widest layer
+    thread_local std::vector<float> bufferA, bufferB;
+    const size_t scratch = static_cast<size_t>(ROWS_PER_BLOCK) * maxWidth;
+    if (bufferA.size() < scratch)
+    {
+        bufferA.resize(scratch);
+        bufferB.resize(scratch);
+    }
+
+    for (int first = 0; first < numVoices; first += ROWS_PER_BLOCK)
+    {
+        const int rows = std::min(ROWS_PER_BLOCK, numVoices - first);
+        const float* input = latents + static_cast<size_t>(first) * latentDim;
+        float* current = bufferA.data();
+        float* next = bufferB.data();
+
+        for (size_t i = 0; i + 1 < layers.size(); ++i)
+        {
+            runLayer(layers[i], input, next, rows);
+            input = next;
+            std::swap(current, next);
+        }
+
+        runFinalLayerWithArgmax(layers.back(), input, rows, parameters + static_cast<size_t>(first) * DX7Voice::N_PARAMS);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <vector>
+#include "DX7Voice.h"
+
+// Hand-written forward pass for the VAE decoder, run without libtorch.
+//
+// The weights come from a flat blob written by models/export_native_decoder.py:
+// a 64-byte header followed by a chain of layers (dense, layer norm and
+// element-wise activations). The final dense layer produces N_PARAMS groups of
+// numClasses logits. It is fused with the argmax, so each group is reduced to
+// one parameter byte as soon as it is computed and the full logits tensor never
+// exists. The dot product kernel is picked once at runtime from SSE, AVX2+FMA
+// and AVX-512, with a scalar fallback for other CPUs.
+//
+// The blob records the hash of the TorchScript model it was exported from. The
+// build links it into the binary next to the model, and NeuralModelWrapper only
+// switches to this path when that hash matches the loaded model. NativeDecoderTests
+// checks that the argmax output matches TorchScript exactly.
+class NativeDecoder
+{
+public:
+    enum class Kernel { SCALAR, SSE, AVX2, AVX512 };
+
+    NativeDecoder();
+    ~NativeDecoder();
+
+    bool loadFromFile(const juce::File& file);
+    bool loadFromMemory(const void* data, size_t size);
+    bool isLoaded() const { return !layers.empty(); }
+
+    uint64_t getSourceModelHash() const { return sourceModelHash; }
+    int getLatentDim() const { return latentDim; }
+    int getNumClasses() const { return numClasses; }
+    size_t getNumWeights() const;
+
+    // Decodes numVoices latents of getLatentDim() floats each into DX7Voice::N_PARAMS
+    // argmax bytes per voice. Safe to call from several threads at once.
+    void decode(const float* latents, int numVoices, uint8_t* parameters) const;
+
+    // Dynamic int8 mode: dense weights are quantised per output row (symmetric),
+    // activations per row at run time, and dot products accumulate in int32.
+    // Irreversible; load a second decoder to keep an fp32 copy.
+    void quantizeToInt8();
+    bool isQuantized() const;
+
+    static Kernel getActiveKernel();
+    static const char* getKernelName(Kernel kernel);
+
+private:
+    enum class OpType : uint32_t
+    {
+        LINEAR = 1,
+        RELU = 2,
+        LEAKY_RELU = 3,
+        GELU = 4,
+        TANH = 5,
+        SIGMOID = 6,
+        LAYER_NORM = 7
+    };
+
+    struct Layer
+    {
+        OpType type = OpType::RELU;
+        int inDim = 0;
+        int outDim = 0;
+        float param = 0.0f;         // LEAKY_RELU slope, LAYER_NORM epsilon
+        std::vector<float> weights; // LINEAR [outDim][inDim], LAYER_NORM gamma
+        std::vector<float> bias;    // LINEAR / LAYER_NORM beta
+        std::vector<int8_t> quantizedWeights; // LINEAR after quantizeToInt8()
+        std::vector<float> rowScales;
+    };
+
+    void runLayer(const Layer& layer, const float* input, float* output, int numRows) const;
+    void runLinear(const Layer& layer, const float* input, int numRows,
+                   int firstOutput, int numOutputs, float* output, int outputStride) const;
+    void runLinearInt8(const Layer& layer, const int8_t* input, const float* inputScales, int numRows,
+                       int firstOutput, int numOutputs, float* output, int outputStride) const;
+    void runFinalLayerWithArgmax(const Layer& layer, const float* input, int numRows, uint8_t* parameters) const;
+
+    std::vector<Layer> layers;
+    uint64_t sourceModelHash = 0;
+    int latentDim = 0;
+    int numClasses = 0;
+    int maxWidth = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NativeDecoder)
+};
@@ -1,10 +1,15 @@
 #include "NeuralModelWrapper.h"
 #include "EmbeddedModelLoader.h"
 #include "DX7Voice.h"
+#include "DX7VoiceValidator.h"
+#include "LatentSampler.h"
+#include <ATen/Parallel.h>
 #include <random>
+#include <algorithm>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <istream>
+#include <chrono>
+#include <array>
 
 NeuralModelWrapper::NeuralModelWrapper()
 {
@@ -16,70 +21,189 @@ NeuralModelWrapper::~NeuralModelWrapper() = default;
 
 bool NeuralModelWrapper::loadModelFromFile()
 {
+    // Several workers may race to load on startup - only the first one does the work
+    std::lock_guard<std::mutex> lock(loadMutex);
+    
+    if (modelLoaded) {
+        return true; // Already loaded
+    }
+    
+    // First try the model embedded in the binary
+    if (loadModelFromMemory(EmbeddedModelLoader::getModelData(), EmbeddedModelLoader::getModelSize(), "embedded data")) {
+        return true;
+    }
+    
+    // Fallback to external file
+    return loadMappedModel(juce::File::getCurrentWorkingDirectory().getChildFile("models/dx7_vae_model.pt"));
+}
+
+bool NeuralModelWrapper::loadModelFromFile(const juce::File& modelFile)
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+    
     if (modelLoaded) {
         return true; // Already loaded
     }
     
+    return loadMappedModel(modelFile);
+}
+
+bool NeuralModelWrapper::loadMappedModel(const juce::File& modelFile)
+{
+    // Mapped rather than read, so the file isn't copied either
+    if (!modelFile.existsAsFile()) {
+        std::cerr << "Model file not found or not readable at: " << modelFile.getFullPathName() << "\n";
+        return false;
+    }
+    
+    juce::MemoryMappedFile mappedModel(modelFile, juce::MemoryMappedFile::readOnly);
+    if (mappedModel.getData() == nullptr) {
+        std::cerr << "Failed to map model file: " << modelFile.getFullPathName() << "\n";
+        return false;
+    }
+    
+    return loadModelFromMemory(static_cast<const char*>(mappedModel.getData()), mappedModel.getSize(),
+                               "file " + modelFile.getFullPathName().toStdString());
+}
+
+bool NeuralModelWrapper::loadModelFromMemory(const char* data, size_t size, const std::string& source)
+{
+    if (data == nullptr || size == 0) {
+        return false;
+    }
+    
     try {
-        // First try to load from embedded compressed model
-        std::cout << "Loading neural model from embedded data\n";
-        auto modelData = EmbeddedModelLoader::loadCompressedModel();
-        
-        // Create a stringstream from the decompressed data
-        std::stringstream modelStream(std::string(modelData.begin(), modelData.end()));
+        std::cout << "Loading neural model from " << source << "\n";
+        const size_t peakBefore = EmbeddedModelLoader::getPeakResidentBytes();
+        const auto start = std::chrono::steady_clock::now();
         
-        // Load model from the stream
+        // torch::jit::load reads straight out of the embedded or mapped bytes
+        MemoryStreamBuffer buffer(data, size);
+        std::istream modelStream(&buffer);
         model = torch::jit::load(modelStream);
         model.eval();
-        modelLoaded = true;
+        modelHash.store(hashModelBytes(data, size));
         
-        std::cout << "Neural model loaded successfully from embedded data (" 
-                  << modelData.size() << " bytes)\n";
+        const double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const size_t peakAfter = EmbeddedModelLoader::getPeakResidentBytes();
+        std::cout << "Neural model loaded successfully from " << source << " (" << size << " bytes) in "
+                  << loadMs << " ms, peak RSS " << peakAfter / (1024 * 1024) << " MB (+"
+                  << (peakAfter - std::min(peakBefore, peakAfter)) / (1024 * 1024) << " MB during load)\n";
+        
+        prepareLoadedModel();
+        modelLoaded.store(true);
         return true;
     }
+    catch (const c10::Error& e) {
+        std::cerr << "PyTorch error loading model from " << source << ": " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Failed to load model from " << source << ": " << e.what() << "\n";
+    }
+    catch (...) {
+        std::cerr << "Unknown error occurred while loading model from " << source << "\n";
+    }
+    
+    modelLoaded.store(false);
+    return false;
+}
+
+void NeuralModelWrapper::setWarmupBatchSizes(std::vector<int> batchSizes)
+{
+    std::lock_guard<std::mutex> lock(loadMutex);
+    batchSizes.erase(std::remove_if(batchSizes.begin(), batchSizes.end(), [](int n) { return n <= 0; }), batchSizes.end());
+    std::sort(batchSizes.begin(), batchSizes.end());
+    batchSizes.erase(std::unique(batchSizes.begin(), batchSizes.end()), batchSizes.end());
+    warmupBatchSizes = std::move(batchSizes);
+}
+
+void NeuralModelWrapper::prepareLoadedModel()
+{
+    // Called with loadMutex held, before modelLoaded is set, so no request ever
+    // sees an unoptimised or cold module
+    loadNativeDecoder();
+    
+    if (nativeDecoderActive) {
+        // TorchScript never runs, so don't pay for optimising and warming it; only
+        // the hash taken from its bytes is still needed
+        model = torch::jit::script::Module();
+        return;
+    }
+    
+    try {
+#if NDX7_HAS_FROZEN_MODULES
+        // Folds parameters and attributes into the graph as constants, then runs
+        // the inference passes (conv/linear folding, dropout removal, fusion)
+        model = torch::jit::optimize_for_inference(model);
+        std::cout << "Neural model frozen and optimized for inference\n";
+#else
+        std::cout << "This libtorch can't freeze modules, warming up the eval-mode module instead\n";
+#endif
+        warmUp();
+    }
     catch (const std::exception& e) {
-        std::cerr << "Failed to load embedded model: " << e.what() << "\n";
+        // The unoptimised module still works, it just pays the warm-up on first use
+        std::cerr << "Model optimization failed, continuing without it: " << e.what() << "\n";
+    }
+}
+
+void NeuralModelWrapper::warmUp()
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    
+    // Warm a pooled session, so its buckets are the ones real requests reuse
+    auto session = acquireSession();
+    std::vector<float> latents;
+    std::vector<uint8_t> parameters;
+    
+    for (int batchSize : warmupBatchSizes) {
+        latents.resize(static_cast<size_t>(batchSize) * LATENT_DIM);
+        parameters.resize(static_cast<size_t>(batchSize) * DX7Voice::N_PARAMS);
+        std::fill(latents.begin(), latents.end(), 0.0f);
         
-        // Fallback to external file
-        try {
-            std::string modelPath = "models/dx7_vae_model.pt";
-            
-            // Check if file exists and is readable
-            std::ifstream file(modelPath, std::ios::binary);
-            if (!file.good()) {
-                std::cerr << "Model file not found or not readable at: " << modelPath << "\n";
-                return false;
-            }
-            file.close();
-            
-            // Load the model
-            std::cout << "Loading neural model from fallback file: " << modelPath << "\n";
-            model = torch::jit::load(modelPath);
-            model.eval();
-            modelLoaded = true;
-            
-            std::cout << "Neural model loaded successfully from file\n";
-            return true;
-        }
-        catch (const c10::Error& e) {
-            std::cerr << "PyTorch error loading model: " << e.what() << "\n";
-            modelLoaded = false;
-            return false;
-        }
-        catch (const std::exception& e) {
-            std::cerr << "Failed to load model from file: " << e.what() << "\n";
-            modelLoaded = false;
-            return false;
-        }
-        catch (...) {
-            std::cerr << "Unknown error occurred while loading model\n";
-            modelLoaded = false;
-            return false;
+        // The profiling executor specialises the graph over the first runs
+        const auto start = std::chrono::steady_clock::now();
+        session->decode(latents.data(), batchSize, parameters.data());
+        const double firstCallMs = ms(std::chrono::steady_clock::now() - start).count();
+        
+        std::array<double, WARMUP_RUNS> runMs{};
+        for (auto& run : runMs) {
+            const auto runStart = std::chrono::steady_clock::now();
+            session->decode(latents.data(), batchSize, parameters.data());
+            run = ms(std::chrono::steady_clock::now() - runStart).count();
         }
+        
+        // Median, so one preempted run doesn't skew the report
+        std::sort(runMs.begin(), runMs.end());
+        const double steadyMs = runMs[WARMUP_RUNS / 2];
+        
+        std::cout << "Warm-up batch " << batchSize << " (bucket " << InferenceSession::bucketSizeFor(batchSize)
+                  << "): first call " << firstCallMs << " ms, steady state " << steadyMs << " ms ("
+                  << steadyMs / batchSize << " ms/voice)\n";
     }
+    
+    releaseSession(std::move(session));
+}
+
+uint64_t NeuralModelWrapper::hashModelBytes(const char* data, size_t size)
+{
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void NeuralModelWrapper::setIntraOpThreadsForCurrentThread(int numThreads)
+{
+    // With the OpenMP backend this only affects parallel regions started from the
+    // calling thread, which gives every worker its own intra-op budget
+    at::init_num_threads();
+    at::set_num_threads(std::max(1, numThreads));
 }
 
-std::vector<DX7Voice> NeuralModelWrapper::generateVoices(const std::vector<float>& latentVector)
+DX7VoiceBank NeuralModelWrapper::generateVoices(const std::vector<float>& latentVector)
 {
     if (!modelLoaded && !loadModelFromFile()) {
         return {};
@@ -89,74 +213,104 @@ std::vector<DX7Voice> NeuralModelWrapper::generateVoices(const std::vector<float
         return {};
     }
     
-    try {
-        // Create tensor from latent vector - assume latentVector is already batched correctly
-        torch::Tensor z = torch::tensor(latentVector).view({-1, LATENT_DIM});
-        
-        // Generate parameters using the model
-        std::vector<torch::jit::IValue> inputs;
-        inputs.push_back(z);
-        
-        torch::Tensor logits = model.forward(inputs).toTensor();
-        
-        // Infer number of voices from the output tensor size
-        int numVoices = logits.size(0);
-        
-        // Convert logits to parameters and then to voices
-        std::vector<DX7Voice> voices;
-        voices.reserve(numVoices);
-        
-        for (int i = 0; i < numVoices; ++i) {
-            torch::Tensor voiceLogits = logits[i];
-            auto parameters = DX7Voice::logitsToParameters(voiceLogits);
-            voices.push_back(DX7Voice::fromParameters(parameters));
-        }
-        
-        return voices;
+    if (int8Active) {
+        return generateVoicesNatively(*quantizedDecoder, latentVector);
     }
-    catch (const std::exception& e) {
-        std::cerr << "Error generating voices: " << e.what() << "\n";
-        return {};
+    
+    if (nativeDecoderActive) {
+        return generateVoicesNatively(nativeDecoder, latentVector);
     }
+    
+    return generateVoicesWithTorch(latentVector);
 }
 
-std::vector<DX7Voice> NeuralModelWrapper::generateRandomVoices()
+DX7VoiceBank NeuralModelWrapper::generateVoicesNatively(const NativeDecoder& decoder, const std::vector<float>& latentVector)
 {
-    if (!modelLoaded && !loadModelFromFile()) {
+    const int numVoices = static_cast<int>(latentVector.size() / LATENT_DIM);
+    DX7VoiceBank voices(numVoices);
+    decoder.decode(latentVector.data(), numVoices, voices.data());
+    
+    repairDecodedVoices(voices);
+    return voices;
+}
+
+DX7VoiceBank NeuralModelWrapper::generateVoicesWithTorch(const std::vector<float>& latentVector)
+{
+    const int numVoices = static_cast<int>(latentVector.size() / LATENT_DIM);
+    
+    // Argmax bytes land straight in the bank
+    DX7VoiceBank voices(numVoices);
+    
+    auto session = acquireSession();
+    const bool decoded = session->decode(latentVector.data(), numVoices, voices.data());
+    releaseSession(std::move(session));
+    
+    if (!decoded) {
         return {};
     }
     
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<float> dis(0.0f, 1.0f);
+    repairDecodedVoices(voices);
+    return voices;
+}
+
+void NeuralModelWrapper::repairDecodedVoices(DX7VoiceBank& voices)
+{
+    // An argmax can land outside a parameter's range; clamp it rather than lose the voice
+    // Only counted here; DX7VoiceValidator::describe() is for callers that want the detail
+    const auto repairs = DX7VoiceValidator::clamp(voices.data(), voices.size());
+    if (!repairs.empty()) {
+        repairedVoices.fetch_add(repairs.size(), std::memory_order_relaxed);
+        DBG("NeuralModelWrapper: Clamped out-of-range parameters in " << static_cast<int>(repairs.size())
+            << " of " << voices.size() << " voices");
+    }
+}
+
+std::unique_ptr<InferenceSession> NeuralModelWrapper::acquireSession()
+{
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        if (!idleSessions.empty()) {
+            auto session = std::move(idleSessions.back());
+            idleSessions.pop_back();
+            return session;
+        }
+    }
     
-    std::vector<float> latentVector(LATENT_DIM);
-    for (auto& val : latentVector) {
-        val = dis(gen);
+    // One per concurrently decoding thread, so this only happens while the pool grows
+    return std::make_unique<InferenceSession>(model);
+}
+
+void NeuralModelWrapper::releaseSession(std::unique_ptr<InferenceSession> session)
+{
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    idleSessions.push_back(std::move(session));
+}
+
+DX7VoiceBank NeuralModelWrapper::generateRandomVoices()
+{
+    if (!modelLoaded && !loadModelFromFile()) {
+        return {};
     }
     
-    return generateVoices(latentVector);
+    return generateVoices(makeRandomLatents(1));
+}
+
+std::vector<float> NeuralModelWrapper::makeRandomLatents(int numVoices)
+{
+    static_assert(LatentSampler::LATENT_DIM == LATENT_DIM, "Sampler rows must match the model input");
+    
+    // A one-off stream; reproducible banks go through LatentSampler with a kept seed
+    return LatentSampler::generate(LatentSampler::makeEntropySeed(), 0, numVoices, LatentSampler::Mode::NORMAL);
 }
 
-std::vector<DX7Voice> NeuralModelWrapper::generateMultipleRandomVoices()
+DX7VoiceBank NeuralModelWrapper::generateMultipleRandomVoices(int numVoices)
 {
     if (!modelLoaded && !loadModelFromFile()) {
         return {};
     }
     
     try {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::normal_distribution<float> dis(0.0f, 1.0f);
-        
-        // Create batched latent vectors for multiple voices
-        std::vector<float> batchedLatent(N_VOICES * LATENT_DIM);
-        
-        for (int i = 0; i < N_VOICES * LATENT_DIM; ++i) {
-            batchedLatent[i] = dis(gen);
-        }
-        
-        return generateVoices(batchedLatent);
+        return generateVoices(makeRandomLatents(numVoices));
     }
     catch (const std::exception& e) {
         std::cerr << "Error generating multiple random voices: " << e.what() << "\n";
@@ -164,3 +318,94 @@ std::vector<DX7Voice> NeuralModelWrapper::generateMultipleRandomVoices()
     }
 }
 
+void NeuralModelWrapper::loadNativeDecoder()
+{
+    nativeDecoderActive.store(false);
+    int8Active.store(false);
+    
+    const char* data = EmbeddedModelLoader::getNativeDecoderData();
+    const size_t size = EmbeddedModelLoader::getNativeDecoderSize();
+    
+    if (data == nullptr) {
+        if (int8Requested) {
+            std::cout << "Int8 inference needs the native decoder, which this build doesn't embed (see models/README.md), staying on fp32\n";
+        }
+        return;
+    }
+    
+    if (!nativeDecoder.loadFromMemory(data, size)) {
+        std::cerr << "Embedded native decoder is not a valid decoder blob, staying on TorchScript\n";
+        return;
+    }
+    
+    // Its argmax output is checked against TorchScript by NativeDecoderTests when
+    // it is built; here it only has to come from the model that was loaded
+    if (nativeDecoder.getSourceModelHash() != modelHash.load() || nativeDecoder.getLatentDim() != LATENT_DIM) {
+        std::cout << "Embedded native decoder was exported from a different model, staying on TorchScript\n";
+        return;
+    }
+    
+    nativeDecoderActive.store(true);
+    std::cout << "Using native decoder (" << NativeDecoder::getKernelName(NativeDecoder::getActiveKernel())
+              << " kernels) instead of TorchScript\n";
+    
+    if (int8Requested) {
+        enableInt8IfAccurate(data, size);
+    }
+}
+
+void NeuralModelWrapper::enableInt8IfAccurate(const char* data, size_t size)
+{
+    auto decoder = std::make_unique<NativeDecoder>();
+    if (!decoder->loadFromMemory(data, size)) {
+        return;
+    }
+    decoder->quantizeToInt8();
+    
+    // A fixed set, so the decision is the same on every load. The fp32 decoder is
+    // the reference; NativeDecoderTests holds it to TorchScript's exact output.
+    auto latents = LatentSampler::generate(INT8_CHECK_SEED, 0, INT8_CHECK_LATENTS, LatentSampler::Mode::NORMAL);
+    for (size_t i = latents.size() / 2; i < latents.size(); ++i) {
+        latents[i] *= 3.0f; // The ends of the slider range
+    }
+    
+    int worstParameter = 0;
+    const double worstAgreement = measureWorstAgreement(nativeDecoder, *decoder, latents, worstParameter);
+    
+    if (worstAgreement < int8MinAgreement) {
+        std::cout << "Int8 inference refused: parameter " << worstParameter << " agrees with fp32 on "
+                  << worstAgreement * 100.0 << "% of " << INT8_CHECK_LATENTS << " latents, below "
+                  << int8MinAgreement * 100.0 << "%, staying on fp32\n";
+        return;
+    }
+    
+    quantizedDecoder = std::move(decoder);
+    int8Active.store(true);
+    std::cout << "Using int8 inference (worst parameter agreement " << worstAgreement * 100.0 << "%)\n";
+}
+
+double NeuralModelWrapper::measureWorstAgreement(const NativeDecoder& reference, const NativeDecoder& candidate,
+                                                 const std::vector<float>& latents, int& worstParameter)
+{
+    const int numLatents = static_cast<int>(latents.size() / LATENT_DIM);
+    std::vector<uint8_t> expected(static_cast<size_t>(numLatents) * DX7Voice::N_PARAMS);
+    std::vector<uint8_t> actual(expected.size());
+    reference.decode(latents.data(), numLatents, expected.data());
+    candidate.decode(latents.data(), numLatents, actual.data());
+    
+    // The bar is the worst parameter, not the average
+    std::array<int, DX7Voice::N_PARAMS> agreeing{};
+    for (size_t i = 0; i < expected.size(); ++i) {
+        agreeing[i % DX7Voice::N_PARAMS] += expected[i] == actual[i] ? 1 : 0;
+    }
+    
+    const auto worst = std::min_element(agreeing.begin(), agreeing.end());
+    worstParameter = static_cast<int>(worst - agreeing.begin());
+    return numLatents > 0 ? static_cast<double>(*worst) / numLatents : 0.0;
+}
+
+void NeuralModelWrapper::setInt8Inference(bool enabled, double minAgreement)
+{
+    int8Requested = enabled;
+    int8MinAgreement = minAgreement;
+}
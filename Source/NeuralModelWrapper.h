@@ -6,7 +6,12 @@
 #include <string>
 #include <memory>
 #include <sstream>
+#include <atomic>
+#include <mutex>
 #include "DX7Voice.h"
+#include "DX7VoiceBank.h"
+#include "NativeDecoder.h"
+#include "InferenceSession.h"
 
 class NeuralModelWrapper
 {
@@ -18,14 +23,93 @@ public:
     ~NeuralModelWrapper();
     
     bool loadModelFromFile();
-    std::vector<DX7Voice> generateVoices(const std::vector<float>& latentVector);
-    std::vector<DX7Voice> generateRandomVoices();
-    std::vector<DX7Voice> generateMultipleRandomVoices();
     
-    bool isModelLoaded() const { return modelLoaded; }
+    // Loads a TorchScript checkpoint from disk instead of the embedded model
+    bool loadModelFromFile(const juce::File& modelFile);
+    
+    // One voice per LATENT_DIM floats of latentVector, decoded straight into the bank
+    DX7VoiceBank generateVoices(const std::vector<float>& latentVector);
+    DX7VoiceBank generateRandomVoices();
+    DX7VoiceBank generateMultipleRandomVoices(int numVoices = N_VOICES);
+    
+    bool isModelLoaded() const { return modelLoaded.load(); }
+    
+    // Decoded voices that needed out-of-range parameters clamped
+    uint64_t getRepairedVoiceCount() const { return repairedVoices.load(); }
+    
+    // numVoices standard-normal latents, flattened, as used by the random generators
+    static std::vector<float> makeRandomLatents(int numVoices);
+    
+    // FNV-1a hash of the serialized model that was loaded. Anything persisted from
+    // model output is tagged with it so a new checkpoint never serves stale voices.
+    // Int8 output differs slightly from fp32, so that mode gets its own hash.
+    uint64_t getModelHash() const { return modelHash.load() ^ (int8Active.load() ? INT8_HASH_SALT : 0); }
+    static uint64_t hashModelBytes(const char* data, size_t size);
+    
+    // Sets the libtorch intra-op thread budget for the calling thread.
+    // Each inference worker calls this once so workers don't oversubscribe cores.
+    static void setIntraOpThreadsForCurrentThread(int numThreads);
+    
+    // Batch sizes run through the model during loading so the first real request
+    // of each size doesn't pay for graph specialisation and allocator growth
+    void setWarmupBatchSizes(std::vector<int> batchSizes);
+    static constexpr int WARMUP_RUNS = 5;
+    
+    // True once the embedded native decoder (if the build has one) was found to
+    // come from the loaded model, and generation no longer goes through TorchScript.
+    // The TorchScript module is then released without being optimised or warmed up.
+    // Its output is checked against TorchScript by NativeDecoderTests, not at load.
+    bool isNativeDecoderActive() const { return nativeDecoderActive.load(); }
+    
+    // Optional int8 mode on top of the native decoder; call before loading. At load
+    // the quantised decoder runs INT8_CHECK_LATENTS fixed latents, and is only used
+    // if every parameter's argmax agrees with the fp32 decoder on at least
+    // minAgreement of them.
+    void setInt8Inference(bool enabled, double minAgreement = DEFAULT_INT8_MIN_AGREEMENT);
+    bool isInt8Active() const { return int8Active.load(); }
+    static constexpr double DEFAULT_INT8_MIN_AGREEMENT = 0.99;
+    static constexpr int INT8_CHECK_LATENTS = 2048;
+    
+    // Worst per-parameter argmax agreement of candidate with reference over the
+    // latents, and which parameter it was
+    static double measureWorstAgreement(const NativeDecoder& reference, const NativeDecoder& candidate,
+                                        const std::vector<float>& latents, int& worstParameter);
+    static constexpr uint64_t INT8_HASH_SALT = 0x494e5438ull; // "INT8"
     
 private:
+    // Shared by every inference worker; forward() is safe to call concurrently
     torch::jit::script::Module model;
-    bool modelLoaded = false;
+    std::atomic<bool> modelLoaded{false};
+    std::atomic<uint64_t> modelHash{0};
+    std::mutex loadMutex;
+    
+    bool loadModelFromMemory(const char* data, size_t size, const std::string& source);
+    bool loadMappedModel(const juce::File& modelFile);
+    
+    std::vector<int> warmupBatchSizes{ 1, N_VOICES };
+    void prepareLoadedModel();
+    void warmUp();
+    
+    // Idle inference sessions; each call borrows one so concurrent workers never share buffers
+    std::mutex sessionMutex;
+    std::vector<std::unique_ptr<InferenceSession>> idleSessions;
+    std::unique_ptr<InferenceSession> acquireSession();
+    void releaseSession(std::unique_ptr<InferenceSession> session);
+    
+    NativeDecoder nativeDecoder;
+    std::atomic<bool> nativeDecoderActive{false};
+    
+    std::unique_ptr<NativeDecoder> quantizedDecoder;
+    std::atomic<bool> int8Active{false};
+    bool int8Requested = false;
+    double int8MinAgreement = DEFAULT_INT8_MIN_AGREEMENT;
+    
+    DX7VoiceBank generateVoicesWithTorch(const std::vector<float>& latentVector);
+    DX7VoiceBank generateVoicesNatively(const NativeDecoder& decoder, const std::vector<float>& latentVector);
+    void repairDecodedVoices(DX7VoiceBank& voices);
+    std::atomic<uint64_t> repairedVoices{0};
+    void loadNativeDecoder();
+    void enableInt8IfAccurate(const char* data, size_t size);
+    static constexpr uint64_t INT8_CHECK_SEED = 0x51384e44;
     
 };
\ No newline at end of file
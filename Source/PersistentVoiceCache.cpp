@@ -0,0 +1,355 @@
+#include "PersistentVoiceCache.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr char CACHE_MAGIC[8] = { 'N', 'D', '7', 'V', 'C', 'A', 'C', 'H' };
+    constexpr uint32_t CACHE_VERSION = 2;
+    constexpr int KEY_BYTES = VoiceCacheKey::LATENT_DIM * 2;
+    constexpr int MARKER_OFFSET = KEY_BYTES + DX7Voice::N_PARAMS;
+    constexpr int CHECKSUM_OFFSET = MARKER_OFFSET + 1;
+    constexpr uint8_t RECORD_MARKER = 0xA5;
+    // The file grows by at least this many records (~700 KB) at a time, and
+    // doubles after that, so appends rarely have to remap it
+    constexpr size_t GROWTH_RECORDS = 4096;
+
+    static_assert(CHECKSUM_OFFSET < PersistentVoiceCache::RECORD_SIZE, "Record too small");
+
+    uint8_t recordChecksum(const uint8_t* record)
+    {
+        uint32_t sum = 0;
+        for (int i = 0; i < CHECKSUM_OFFSET; ++i)
+        {
+            sum += record[i];
+        }
+        return static_cast<uint8_t>(sum & 0xFF);
+    }
+}
+
+PersistentVoiceCache::PersistentVoiceCache() = default;
+
+PersistentVoiceCache::~PersistentVoiceCache()
+{
+    close();
+}
+
+juce::File PersistentVoiceCache::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("NintoracAudio")
+        .getChildFile("NeuralDX7PatchGenerator")
+        .getChildFile("voice_cache.bin");
+}
+
+juce::File PersistentVoiceCache::getFileForModel(const juce::File& baseFile, uint64_t hash)
+{
+    return baseFile.getSiblingFile(baseFile.getFileNameWithoutExtension() + "_v" + juce::String(CACHE_VERSION) + "_"
+                                   + juce::String::toHexString(static_cast<juce::int64>(hash)) + baseFile.getFileExtension());
+}
+
+bool PersistentVoiceCache::open(const juce::File& file, uint64_t hash, size_t maxBytes)
+{
+    close();
+
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    std::lock_guard<std::mutex> lock(mutex);
+
+    cacheFile = file;
+    modelHash = hash;
+    maxFileBytes = maxBytes;
+
+    if (!cacheFile.getParentDirectory().createDirectory())
+    {
+        std::cerr << "PersistentVoiceCache: Can't create " << cacheFile.getParentDirectory().getFullPathName() << std::endl;
+        return false;
+    }
+
+    // Per file, so processes using different models never wait on each other
+    fileLock = std::make_unique<juce::InterProcessLock>("NeuralDX7PatchGenerator_" + cacheFile.getFileNameWithoutExtension());
+
+    {
+        juce::InterProcessLock::ScopedLockType fileScopedLock(*fileLock);
+
+        if (!cacheFile.existsAsFile() || cacheFile.getSize() < HEADER_SIZE)
+        {
+            if (!writeFreshHeader())
+            {
+                return false;
+            }
+        }
+        else if (!validateHeader())
+        {
+            // The name already pins the model and format, so this is a damaged file;
+            // other processes may still have it open, so leave it alone
+            std::cerr << "PersistentVoiceCache: " << cacheFile.getFullPathName() << " has an unexpected header, not using it" << std::endl;
+            return false;
+        }
+    }
+
+    mapping = mapFile();
+    indexNewRecords();
+
+    std::cout << "PersistentVoiceCache: Opened " << cacheFile.getFullPathName() << " with "
+              << index.size() << " voices" << std::endl;
+    return mapping != nullptr;
+}
+
+void PersistentVoiceCache::close()
+{
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    std::lock_guard<std::mutex> lock(mutex);
+    mapping.reset();
+    index.clear();
+    indexedRecords = 0;
+}
+
+bool PersistentVoiceCache::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return mapping != nullptr;
+}
+
+size_t PersistentVoiceCache::getNumRecords() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.size();
+}
+
+bool PersistentVoiceCache::writeFreshHeader()
+{
+    Header header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.recordSize = RECORD_SIZE;
+    header.modelHash = modelHash;
+    header.numRecords = 0;
+
+    return cacheFile.replaceWithData(&header, sizeof(header));
+}
+
+bool PersistentVoiceCache::validateHeader()
+{
+    juce::FileInputStream stream(cacheFile);
+    Header header{};
+
+    if (!stream.openedOk() || stream.read(&header, sizeof(header)) != static_cast<int>(sizeof(header)))
+    {
+        return false;
+    }
+
+    return std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+        && header.version == CACHE_VERSION
+        && header.recordSize == RECORD_SIZE
+        && header.modelHash == modelHash;
+}
+
+bool PersistentVoiceCache::reserveSpace(juce::FileOutputStream& stream, size_t numRecords)
+{
+    // Writing the last byte extends the file; the gap reads as zeros, which no
+    // record decodes as, and stays sparse where the filesystem allows
+    const auto size = static_cast<juce::int64>(HEADER_SIZE + numRecords * RECORD_SIZE);
+    const uint8_t zero = 0;
+
+    if (!stream.setPosition(size - 1) || !stream.write(&zero, 1))
+    {
+        return false;
+    }
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
+
+std::unique_ptr<juce::MemoryMappedFile> PersistentVoiceCache::mapFile() const
+{
+    auto newMapping = std::make_unique<juce::MemoryMappedFile>(cacheFile, juce::MemoryMappedFile::readOnly, false);
+
+    if (newMapping->getData() == nullptr || newMapping->getSize() < static_cast<size_t>(HEADER_SIZE))
+    {
+        return nullptr;
+    }
+
+    return newMapping;
+}
+
+uint32_t PersistentVoiceCache::readPublishedRecords() const
+{
+    uint32_t numRecords = 0;
+    std::memcpy(&numRecords, static_cast<const uint8_t*>(mapping->getData()) + offsetof(Header, numRecords), sizeof(numRecords));
+    return numRecords;
+}
+
+void PersistentVoiceCache::indexNewRecords()
+{
+    if (mapping == nullptr)
+    {
+        return;
+    }
+
+    // Another process may have published records past the end of our mapping;
+    // they are picked up after the next remap
+    const auto* base = static_cast<const uint8_t*>(mapping->getData()) + HEADER_SIZE;
+    const size_t mappedRecords = (mapping->getSize() - HEADER_SIZE) / RECORD_SIZE;
+    const size_t numRecords = std::min<size_t>(readPublishedRecords(), mappedRecords);
+
+    for (size_t i = indexedRecords; i < numRecords; ++i)
+    {
+        VoiceCacheKey key;
+        if (decodeKey(base + i * RECORD_SIZE, key))
+        {
+            index[key] = static_cast<uint32_t>(i);
+        }
+    }
+
+    indexedRecords = std::max(indexedRecords, numRecords);
+}
+
+std::optional<DX7Voice> PersistentVoiceCache::lookup(const VoiceCacheKey& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (mapping == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    auto it = index.find(key);
+
+    // Other processes may have published records since; that's only a read of the mapped header
+    if (it == index.end())
+    {
+        indexNewRecords();
+        it = index.find(key);
+    }
+
+    if (it == index.end())
+    {
+        return std::nullopt;
+    }
+
+    const auto* record = static_cast<const uint8_t*>(mapping->getData()) + HEADER_SIZE + static_cast<size_t>(it->second) * RECORD_SIZE;
+    return DX7Voice::fromParameterBytes(record + KEY_BYTES);
+}
+
+void PersistentVoiceCache::append(const std::vector<Entry>& entries)
+{
+    // Only appends replace the mapping, so holding writeMutex it can be read without mutex
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+
+    std::vector<uint8_t> records;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (mapping == nullptr)
+        {
+            return;
+        }
+
+        records.reserve(entries.size() * RECORD_SIZE);
+        for (const auto& entry : entries)
+        {
+            if (entry.voice == nullptr || index.find(entry.key) != index.end())
+            {
+                continue;
+            }
+
+            records.resize(records.size() + RECORD_SIZE);
+            encodeRecord(entry.key, *entry.voice, records.data() + records.size() - RECORD_SIZE);
+        }
+    }
+
+    if (records.empty())
+    {
+        return;
+    }
+
+    const size_t maxRecords = maxFileBytes > static_cast<size_t>(HEADER_SIZE) ? (maxFileBytes - HEADER_SIZE) / RECORD_SIZE : 0;
+
+    {
+        juce::InterProcessLock::ScopedLockType fileScopedLock(*fileLock);
+
+        const size_t published = readPublishedRecords();
+        const size_t numNew = std::min(records.size() / RECORD_SIZE, maxRecords - std::min(maxRecords, published));
+        if (numNew == 0)
+        {
+            return; // Full - keep serving what we have
+        }
+
+        // FileOutputStream opens an existing file without truncating it
+        juce::FileOutputStream stream(cacheFile);
+        if (!stream.openedOk())
+        {
+            return;
+        }
+
+        const size_t capacity = (static_cast<size_t>(cacheFile.getSize()) - HEADER_SIZE) / RECORD_SIZE;
+        if (published + numNew > capacity
+            && !reserveSpace(stream, std::min(maxRecords, std::max({ published + numNew, capacity * 2, GROWTH_RECORDS }))))
+        {
+            return;
+        }
+
+        // Records first, then the count that makes them visible to readers
+        const auto numRecords = static_cast<uint32_t>(published + numNew);
+        if (!stream.setPosition(static_cast<juce::int64>(HEADER_SIZE + published * RECORD_SIZE))
+            || !stream.write(records.data(), numNew * RECORD_SIZE))
+        {
+            return;
+        }
+        stream.flush();
+
+        if (!stream.setPosition(static_cast<juce::int64>(offsetof(Header, numRecords)))
+            || !stream.write(&numRecords, sizeof(numRecords)))
+        {
+            return;
+        }
+        stream.flush();
+    }
+
+    // Remap only when the file has grown past the mapping, by us or another process
+    std::unique_ptr<juce::MemoryMappedFile> newMapping;
+    if (static_cast<size_t>(cacheFile.getSize()) > mapping->getSize())
+    {
+        newMapping = mapFile();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (newMapping != nullptr)
+    {
+        std::swap(mapping, newMapping);
+    }
+    indexNewRecords();
+}
+
+void PersistentVoiceCache::encodeRecord(const VoiceCacheKey& key, const DX7Voice& voice, uint8_t* record)
+{
+    std::memset(record, 0, RECORD_SIZE);
+
+    // Little-endian int16 per latent dimension
+    for (int i = 0; i < VoiceCacheKey::LATENT_DIM; ++i)
+    {
+        const auto value = static_cast<uint16_t>(key.values[i]);
+        record[i * 2] = static_cast<uint8_t>(value & 0xFF);
+        record[i * 2 + 1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    voice.toParameterBytes(record + KEY_BYTES);
+    record[MARKER_OFFSET] = RECORD_MARKER;
+    record[CHECKSUM_OFFSET] = recordChecksum(record);
+}
+
+bool PersistentVoiceCache::decodeKey(const uint8_t* record, VoiceCacheKey& key)
+{
+    if (record[MARKER_OFFSET] != RECORD_MARKER || record[CHECKSUM_OFFSET] != recordChecksum(record))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < VoiceCacheKey::LATENT_DIM; ++i)
+    {
+        key.values[i] = static_cast<int16_t>(record[i * 2] | (record[i * 2 + 1] << 8));
+    }
+
+    return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "DX7Voice.h"
+#include "VoiceCache.h"
+
+// On-disk voice cache shared between sessions and plugin processes.
+//
+// The file is a 64-byte header followed by fixed-size records, each holding a
+// quantised latent key and the 155 parameter bytes of a DX7Voice. The file is
+// preallocated in steps and mapped read-only once per step; records are written
+// into the free space (under an inter-process lock) and published by bumping
+// the record count in the header, so any number of processes can read while one
+// appends. Every model and format version has a file of its own (see
+// getFileForModel()), so a file is never deleted or rewritten by another model.
+class PersistentVoiceCache
+{
+public:
+    static constexpr int RECORD_SIZE = 176;
+    static constexpr int HEADER_SIZE = 64;
+
+    struct Entry
+    {
+        VoiceCacheKey key;
+        DX7VoiceHandle voice;
+    };
+
+    PersistentVoiceCache();
+    ~PersistentVoiceCache();
+
+    // Opens (or creates) the cache file. Returns false if the file can't be used.
+    bool open(const juce::File& file, uint64_t modelHash, size_t maxFileBytes);
+    void close();
+    bool isOpen() const;
+
+    // Only reads the mapping, so it is safe to call from the message thread
+    std::optional<DX7Voice> lookup(const VoiceCacheKey& key);
+
+    // Writes a request's worth of voices with one write and one flush. Does disk
+    // I/O and may grow and remap the file: call it from a worker.
+    void append(const std::vector<Entry>& entries);
+
+    size_t getNumRecords() const;
+
+    static juce::File getDefaultFile();
+
+    // The file for one model next to baseFile, named by model hash and format version
+    static juce::File getFileForModel(const juce::File& baseFile, uint64_t modelHash);
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint64_t modelHash;
+        uint32_t numRecords;   // records published so far; the rest of the file is free space
+        uint8_t reserved[36];
+    };
+    static_assert(sizeof(Header) == HEADER_SIZE, "Header layout is part of the file format");
+
+    bool writeFreshHeader();
+    bool validateHeader();
+    bool reserveSpace(juce::FileOutputStream& stream, size_t numRecords);
+    std::unique_ptr<juce::MemoryMappedFile> mapFile() const;
+    void indexNewRecords();
+    uint32_t readPublishedRecords() const;
+
+    static void encodeRecord(const VoiceCacheKey& key, const DX7Voice& voice, uint8_t* record);
+    static bool decodeKey(const uint8_t* record, VoiceCacheKey& key);
+
+    // mutex guards the mapping and index and is never held during file I/O;
+    // writeMutex keeps this process's appends in turn (the inter-process lock
+    // doesn't exclude other threads of the same process)
+    mutable std::mutex mutex;
+    std::mutex writeMutex;
+    juce::File cacheFile;
+    uint64_t modelHash = 0;
+    size_t maxFileBytes = 0;
+
+    std::unique_ptr<juce::InterProcessLock> fileLock;
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    size_t indexedRecords = 0;
+
+    // Compact index: key -> record number, rebuilt from the file on open
+    std::unordered_map<VoiceCacheKey, uint32_t, VoiceCacheKey::Hasher> index;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PersistentVoiceCache)
+};
@@ -1,7 +1,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include "DX7BulkPacker.h"
-#include "DX7VoicePacker.h"
+#include "DX7SysExWriter.h"
+#include "DX7VoiceValidator.h"
 
 // Simple debounce timer class
 class DebounceTimer : public juce::Timer
@@ -29,23 +29,28 @@ private:
 NeuralDX7PatchGeneratorProcessor::NeuralDX7PatchGeneratorProcessor()
      : AudioProcessor (BusesProperties())
 {
+    const double constructionStart = juce::Time::getMillisecondCounterHiRes();
+    
     latentVector.resize(NeuralModelWrapper::LATENT_DIM, 0.0f);
-    inferenceEngine = std::make_unique<ThreadedInferenceEngine>();
-    inferenceEngine->startInferenceThread();
+    // Joins the process-wide engine, creating it if this is the first instance.
+    // Nothing is loaded yet: that waits for the editor or the first generation.
+    inferenceService = std::make_unique<SharedInferenceService>();
     
     // Create debounce timer for slider changes
     debounceTimer = std::make_unique<DebounceTimer>([this]() {
-        // Pre-generate voice for current latent vector
-        inferenceEngine->preGenerateCustomVoice(latentVector);
+        // Slider has settled: pre-generate the current voice and every one-tick nudge from it
+        inferenceService->prefetchCustomVoices(LatentPrefetcher::buildNeighbourhood(latentVector));
     });
+    
+    std::cout << "NeuralDX7PatchGeneratorProcessor: Constructed in "
+              << juce::String(juce::Time::getMillisecondCounterHiRes() - constructionStart, 2) << " ms" << std::endl;
 }
 
 NeuralDX7PatchGeneratorProcessor::~NeuralDX7PatchGeneratorProcessor()
 {
-    if (inferenceEngine)
-    {
-        inferenceEngine->stopInferenceThread();
-    }
+    // No slider callback may fire into a service that is going away
+    debounceTimer.reset();
+    inferenceService.reset();
 }
 
 const juce::String NeuralDX7PatchGeneratorProcessor::getName() const
@@ -144,10 +149,8 @@ void NeuralDX7PatchGeneratorProcessor::processBlock (juce::AudioBuffer<float>& b
     
     // Add any pending MIDI messages to the output
     if (!pendingMidiMessages.isEmpty()) {
-        std::cout << "Processing " << pendingMidiMessages.getNumEvents() << " pending MIDI messages" << std::endl;
         midiMessages.addEvents(pendingMidiMessages, 0, buffer.getNumSamples(), 0);
         pendingMidiMessages.clear();
-        std::cout << "MIDI messages added to output buffer" << std::endl;
     }
 }
 
@@ -158,6 +161,8 @@ bool NeuralDX7PatchGeneratorProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* NeuralDX7PatchGeneratorProcessor::createEditor()
 {
+    // Start loading now so the model is likely ready by the first click
+    inferenceService->ensureStarted();
     return new NeuralDX7PatchGeneratorEditor (*this);
 }
 
@@ -181,34 +186,42 @@ void NeuralDX7PatchGeneratorProcessor::setStateInformation (const void* data, in
 
 void NeuralDX7PatchGeneratorProcessor::generateAndSendMidi()
 {
-    std::cout << "generateAndSendMidi() called" << std::endl;
-    
-    if (!inferenceEngine->isModelLoaded()) {
-        std::cout << "Neural model not loaded yet, request ignored" << std::endl;
-        return;
+    if (!inferenceService->isModelLoaded()) {
+        DBG("Neural model still loading, voice will be sent once it is ready");
     }
     
-    std::cout << "Generating voice with latent vector: [";
-    for (size_t i = 0; i < latentVector.size(); ++i) {
-        std::cout << latentVector[i];
-        if (i < latentVector.size() - 1) std::cout << ", ";
+   #if JUCE_DEBUG
+    juce::StringArray values;
+    for (float value : latentVector) {
+        values.add(juce::String(value));
     }
-    std::cout << "]" << std::endl;
+    DBG("Generating voice with latent vector: [" << values.joinIntoString(", ") << "]");
+   #endif
     
     // Use cached request for instant response if available
-    inferenceEngine->requestCachedCustomVoice(latentVector, [this](std::optional<DX7Voice> voiceOpt) {
-        if (!voiceOpt.has_value()) {
-            std::cout << "Warning: Attempted to send null voice - ignoring request" << std::endl;
+    inferenceService->requestCachedCustomVoice(latentVector, [this](DX7VoiceHandle voice) {
+        if (voice == nullptr) {
+            DBG("Warning: Attempted to send null voice - ignoring request");
             return;
         }
         
-        std::cout << "Got custom voice, sending as single voice SysEx" << std::endl;
-        
         // For customise functionality, send as single voice SysEx
-        auto sysexData = DX7VoicePacker::packSingleVoice(voiceOpt.value());
-        if (!sysexData.empty()) {
-            std::cout << "Packed single voice SysEx data: " << sysexData.size() << " bytes" << std::endl;
-            addMidiSysEx(sysexData);
+        DX7SysExWriter::SingleVoiceDump sysexData;
+        bool packed = false;
+        
+        // Voices from older caches may predate decode-time clamping. The handle is
+        // shared with the cache, so a repair goes to a private copy.
+        if (voice->validate()) {
+            packed = DX7SysExWriter::writeSingleVoice(*voice, sysexData);
+        } else {
+            DX7Voice repaired = *voice;
+            DX7VoiceValidator::clamp(repaired);
+            std::cout << "Clamped out-of-range parameters in custom voice" << std::endl;
+            packed = DX7SysExWriter::writeSingleVoice(repaired, sysexData);
+        }
+        
+        if (packed) {
+            addMidiSysEx(sysexData.data(), sysexData.size());
         } else {
             std::cout << "Failed to pack single voice SysEx data!" << std::endl;
         }
@@ -217,35 +230,52 @@ void NeuralDX7PatchGeneratorProcessor::generateAndSendMidi()
 
 void NeuralDX7PatchGeneratorProcessor::generateRandomVoicesAndSend()
 {
-    std::cout << "generateRandomVoicesAndSend() called" << std::endl;
+    // Takes the next bank from the ring; if the ring has run dry the request waits
+    // for the refill instead of being dropped, so rapid clicks are never lost
+    DBG("Buffered banks available: " << inferenceService->getBufferedBankCount());
     
-    // Try to use buffered voices first for instant response
-    if (inferenceEngine->hasBufferedRandomVoices()) {
-        std::cout << "Using buffered random voices for instant response" << std::endl;
-        auto voices = inferenceEngine->getBufferedRandomVoices();
-        
-        if (!voices.empty()) {
-            std::cout << "Got " << voices.size() << " buffered voices, packing into SysEx..." << std::endl;
-            auto sysexData = DX7BulkPacker::packBulkDump(voices);
-            
-            if (!sysexData.empty()) {
-                std::cout << "SysEx data packed successfully, sending..." << std::endl;
-                addMidiSysEx(sysexData);
-            } else {
-                std::cout << "Failed to pack SysEx data!" << std::endl;
-            }
+    inferenceService->requestBufferedRandomVoices([this](DX7VoiceBankHandle voices) {
+        if (voices == nullptr || voices->empty()) {
+            DBG("No random voices generated!");
             return;
         }
-    }
-    
-    // If no buffer available, do nothing to prevent weird behavior on rapid clicks
-    std::cout << "No buffered voices available, ignoring request" << std::endl;
+        
+        // Repair rather than drop the whole bank over one out-of-range field. The
+        // bank is shared and immutable, so only a bank needing repair is copied.
+        DX7VoiceBank repaired;
+        const DX7VoiceBank* toSend = voices.get();
+        if (!DX7VoiceValidator::isValid(voices->data(), voices->size())) {
+            repaired = *voices;
+            const auto repairs = DX7VoiceValidator::clamp(repaired.data(), repaired.size());
+            toSend = &repaired;
+            std::cout << "Clamped out-of-range parameters in " << repairs.size() << " voices" << std::endl
+                      << DX7VoiceValidator::describe(repairs);
+        }
+        
+        DX7SysExWriter::BulkDump sysexData;
+        
+        if (DX7SysExWriter::writeBulkDump(*toSend, sysexData)) {
+            addMidiSysEx(sysexData.data(), sysexData.size());
+        } else {
+            std::cout << "Failed to pack SysEx data!" << std::endl;
+        }
+    });
 }
 
 void NeuralDX7PatchGeneratorProcessor::setLatentValues(const std::vector<float>& values)
 {
     if (values.size() == NeuralModelWrapper::LATENT_DIM) {
         latentVector = values;
+        
+        // While the slider is moving, prefetch around where it is heading
+        const double nowMs = juce::Time::getMillisecondCounterHiRes();
+        latentPrefetcher.addSample(values, nowMs);
+        
+        if (latentPrefetcher.isMoving() && nowMs - lastPrefetchMs >= PREFETCH_INTERVAL_MS) {
+            lastPrefetchMs = nowMs;
+            inferenceService->prefetchCustomVoices(LatentPrefetcher::buildNeighbourhood(latentPrefetcher.predictTarget()));
+        }
+        
         // Trigger debounced pre-generation
         debouncedPreGeneration();
     }
@@ -259,42 +289,34 @@ void NeuralDX7PatchGeneratorProcessor::debouncedPreGeneration()
     }
 }
 
-void NeuralDX7PatchGeneratorProcessor::addMidiSysEx(const std::vector<uint8_t>& sysexData)
+void NeuralDX7PatchGeneratorProcessor::addMidiSysEx(const uint8_t* sysexData, size_t size)
 {
-    std::cout << "addMidiSysEx() called with " << sysexData.size() << " bytes" << std::endl;
-    
 #if JucePlugin_Build_LV2 || JucePlugin_Build_VST3
     // For LV2 and VST3, strip SysEx start (0xF0) and end (0xF7) bytes
-    if (sysexData.size() >= 2 && sysexData[0] == 0xF0 && sysexData[sysexData.size() - 1] == 0xF7)
+    if (size >= 2 && sysexData[0] == 0xF0 && sysexData[size - 1] == 0xF7)
     {
-        std::cout << "LV2/VST3 plugin detected - stripping SysEx start/end bytes" << std::endl;
-        std::vector<uint8_t> strippedData(sysexData.begin() + 1, sysexData.end() - 1);
-        
         juce::MidiMessage sysexMessage = juce::MidiMessage::createSysExMessage(
-            strippedData.data(), static_cast<int>(strippedData.size())
+            sysexData + 1, static_cast<int>(size - 2)
         );
         
         pendingMidiMessages.addEvent(sysexMessage, 0);
-        std::cout << "Added stripped SysEx message to pending MIDI buffer" << std::endl;
     }
     else
     {
-        std::cout << "SysEx data doesn't have expected start/end bytes, sending as-is" << std::endl;
+        DBG("SysEx data doesn't have expected start/end bytes, sending as-is");
         juce::MidiMessage sysexMessage = juce::MidiMessage::createSysExMessage(
-            sysexData.data(), static_cast<int>(sysexData.size())
+            sysexData, static_cast<int>(size)
         );
         
         pendingMidiMessages.addEvent(sysexMessage, 0);
-        std::cout << "Added SysEx message to pending MIDI buffer" << std::endl;
     }
 #else
     // For other plugin formats, send SysEx data as-is
     juce::MidiMessage sysexMessage = juce::MidiMessage::createSysExMessage(
-        sysexData.data(), static_cast<int>(sysexData.size())
+        sysexData, static_cast<int>(size)
     );
     
     pendingMidiMessages.addEvent(sysexMessage, 0);
-    std::cout << "Added SysEx message to pending MIDI buffer" << std::endl;
 #endif
 }
 
@@ -4,7 +4,8 @@
 #include <juce_audio_devices/juce_audio_devices.h>
 #include "NeuralModelWrapper.h"
 #include "DX7VoicePacker.h"
-#include "ThreadedInferenceEngine.h"
+#include "SharedInferenceService.h"
+#include "LatentPrefetcher.h"
 
 class NeuralDX7PatchGeneratorProcessor : public juce::AudioProcessor
 {
@@ -46,7 +47,7 @@ public:
     void debouncedPreGeneration(); // For slider changes
 
 private:
-    std::unique_ptr<ThreadedInferenceEngine> inferenceEngine;
+    std::unique_ptr<SharedInferenceService> inferenceService;
     std::vector<float> latentVector;
     juce::Random random;
     juce::MidiBuffer pendingMidiMessages;
@@ -54,7 +55,12 @@ private:
     // Debouncing for slider changes
     std::unique_ptr<juce::Timer> debounceTimer;
     
-    void addMidiSysEx(const std::vector<uint8_t>& sysexData);
+    // Speculative generation ahead of the slider while it is moving
+    LatentPrefetcher latentPrefetcher;
+    double lastPrefetchMs = 0.0;
+    static constexpr double PREFETCH_INTERVAL_MS = 50.0;
+    
+    void addMidiSysEx(const uint8_t* sysexData, size_t size);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NeuralDX7PatchGeneratorProcessor)
 };
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "SharedInferenceService.h"
+#include <iostream>
+
+namespace
+{
+    std::mutex serviceMutex;
+    std::weak_ptr<ThreadedInferenceEngine> sharedEngine;
+    int numClients = 0;
+    
+    // Stops and deletes engines off the message thread, where the last instance
+    // usually goes away. Stopping waits for the workers' current forward passes
+    // and for a model load already under way, which can take seconds. The thread
+    // only runs while there is something to retire.
+    class EngineReaper : public juce::Thread
+    {
+    public:
+        EngineReaper() : juce::Thread("InferenceEngineReaper") {}
+        
+        ~EngineReaper() override
+        {
+            // Unloading the library: finish whatever is still retiring first
+            signalThreadShouldExit();
+            waitForThreadToExit(-1);
+        }
+        
+        void retire(ThreadedInferenceEngine* engine)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            retired.push_back(engine);
+            
+            if (!running)
+            {
+                // A reaper that has just run out of work may still be on its way out
+                waitForThreadToExit(-1);
+                running = true;
+                startThread(juce::Thread::Priority::background);
+            }
+        }
+        
+        void run() override
+        {
+            for (;;)
+            {
+                std::vector<ThreadedInferenceEngine*> engines;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (retired.empty())
+                    {
+                        running = false;
+                        return;
+                    }
+                    engines.swap(retired);
+                }
+                
+                for (auto* engine : engines)
+                {
+                    engine->stopInferenceThread();
+                    destroy(engine);
+                }
+            }
+        }
+        
+    private:
+        void destroy(ThreadedInferenceEngine* engine)
+        {
+            // The engine is an AsyncUpdater; holding the message manager lock makes
+            // sure its last update isn't being delivered while it is deleted. The lock
+            // is given up when we're told to exit, and then the message thread is
+            // waiting in ~EngineReaper and can't be delivering anything.
+            if (juce::MessageManager::getInstanceWithoutCreating() != nullptr)
+            {
+                const juce::MessageManagerLock messageLock(this);
+                delete engine;
+            }
+            else
+            {
+                delete engine;
+            }
+            std::cout << "SharedInferenceService: Last instance gone, shared engine destroyed" << std::endl;
+        }
+        
+        std::mutex mutex;
+        std::vector<ThreadedInferenceEngine*> retired;
+        bool running = false;
+    };
+    
+    EngineReaper& getEngineReaper()
+    {
+        static EngineReaper reaper;
+        return reaper;
+    }
+}
+
+juce::File SharedInferenceService::getSettingsFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("NintoracAudio")
+        .getChildFile("NeuralDX7PatchGenerator")
+        .getChildFile("inference_settings.json");
+}
+
+InferenceEngineConfig SharedInferenceService::loadSettings(const juce::File& settingsFile)
+{
+    InferenceEngineConfig config;
+    if (!settingsFile.existsAsFile())
+    {
+        return config;
+    }
+    
+    const juce::var settings = juce::JSON::parse(settingsFile);
+    if (!settings.isObject())
+    {
+        std::cerr << "SharedInferenceService: Ignoring " << settingsFile.getFullPathName()
+                  << ", not a JSON object" << std::endl;
+        return config;
+    }
+    
+    auto readFlag = [&settings](const char* name, bool& flag) {
+        if (settings.hasProperty(name))
+        {
+            flag = static_cast<bool>(settings[name]);
+        }
+    };
+    
+    readFlag("useInferenceHost", config.useInferenceHost);
+    readFlag("useInt8Inference", config.useInt8Inference);
+    readFlag("useLatentAtlas", config.useLatentAtlas);
+    readFlag("usePersistentVoiceCache", config.usePersistentVoiceCache);
+    
+    if (settings.hasProperty("int8MinAgreement"))
+    {
+        config.int8MinAgreement = juce::jlimit(0.0, 1.0, static_cast<double>(settings["int8MinAgreement"]));
+    }
+    
+    if (settings.hasProperty("randomSeed"))
+    {
+        config.randomSeed = static_cast<uint64_t>(static_cast<juce::int64>(settings["randomSeed"]));
+    }
+    
+    if (settings.hasProperty("randomLatentMode"))
+    {
+        const auto mode = settings["randomLatentMode"].toString();
+        if (mode == "sobol")
+        {
+            config.randomLatentMode = LatentSampler::Mode::SOBOL;
+        }
+        else if (mode != "normal")
+        {
+            std::cerr << "SharedInferenceService: Unknown randomLatentMode " << mode << ", using normal" << std::endl;
+        }
+    }
+    
+    std::cout << "SharedInferenceService: Loaded settings from " << settingsFile.getFullPathName() << std::endl;
+    return config;
+}
+
+std::shared_ptr<ThreadedInferenceEngine> SharedInferenceService::acquireEngine(const InferenceEngineConfig* config)
+{
+    std::lock_guard<std::mutex> lock(serviceMutex);
+    ++numClients;
+    
+    if (auto engine = sharedEngine.lock())
+    {
+        std::cout << "SharedInferenceService: Joined shared engine (" << numClients << " instances)" << std::endl;
+        return engine;
+    }
+    
+    const auto engineConfig = config != nullptr ? *config : loadSettings(getSettingsFile());
+    
+    // The last reference out, usually on the message thread, only asks the workers
+    // to stop; waiting for them and deleting the engine happen on the reaper
+    std::shared_ptr<ThreadedInferenceEngine> engine(new ThreadedInferenceEngine(engineConfig), [](ThreadedInferenceEngine* e) {
+        e->signalStop();
+        getEngineReaper().retire(e);
+    });
+    
+    // Workers start on first use, so hosts scanning the plugin never load the model
+    sharedEngine = engine;
+    
+    std::cout << "SharedInferenceService: Created shared engine" << std::endl;
+    return engine;
+}
+
+int SharedInferenceService::getNumClients()
+{
+    std::lock_guard<std::mutex> lock(serviceMutex);
+    return numClients;
+}
+
+SharedInferenceService::SharedInferenceService()
+    : engine(acquireEngine(nullptr))
+{
+    coalescingKey = engine->acquireCoalescingKey();
+}
+
+SharedInferenceService::SharedInferenceService(const InferenceEngineConfig& config)
+    : engine(acquireEngine(&config))
+{
+    coalescingKey = engine->acquireCoalescingKey();
+}
+
+SharedInferenceService::~SharedInferenceService()
+{
+    // Anything still queued for this instance is dropped unrun, and results already
+    // on their way back are swallowed by the guard
+    alive.cancel();
+    engine->releaseCoalescingKey(coalescingKey);
+    
+    {
+        std::lock_guard<std::mutex> lock(serviceMutex);
+        --numClients;
+    }
+    
+    engine.reset();
+}
+
+void SharedInferenceService::requestCachedCustomVoice(const std::vector<float>& latentVector, std::function<void(DX7VoiceHandle)> callback)
+{
+    InferenceRequestOptions options;
+    options.cancellation = alive;
+    engine->ensureStarted();
+    engine->requestCachedCustomVoice(latentVector, guard(std::move(callback)), options);
+}
+
+void SharedInferenceService::requestBufferedRandomVoices(std::function<void(DX7VoiceBankHandle)> callback)
+{
+    engine->ensureStarted();
+    engine->requestBufferedRandomVoices(guard(std::move(callback)));
+}
+
+void SharedInferenceService::requestRandomBank(uint64_t seed, uint64_t bankIndex, std::function<void(DX7VoiceBankHandle)> callback)
+{
+    InferenceRequestOptions options;
+    options.cancellation = alive;
+    engine->ensureStarted();
+    engine->requestRandomBank(seed, bankIndex, guard(std::move(callback)), options);
+}
+
+void SharedInferenceService::prefetchCustomVoices(const std::vector<float>& latents)
+{
+    engine->prefetchCustomVoices(latents, coalescingKey);
+}
+
+void SharedInferenceService::loadModelVariant(const juce::File& modelFile, bool activate, std::function<void(uint64_t)> callback)
+{
+    engine->ensureStarted();
+    engine->loadModelVariant(modelFile, activate, guard(std::move(callback)));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ThreadedInferenceEngine.h"
+
+// One inference engine per process, shared by every plugin instance.
+//
+// The engine (model, worker pool, voice caches, random bank ring and atlas) is
+// created when the first client connects and stopped when the last one goes
+// away. It stays idle until some instance first needs it: opening an editor
+// calls ensureStarted(), and every request starts it implicitly. Requests from all instances land in the same worker rings, so
+// concurrent single-voice requests are micro-batched into the same forward
+// passes regardless of which instance sent them.
+//
+// Each plugin instance owns a SharedInferenceService. It keeps per-instance
+// behaviour separate:
+//  - callbacks only reach the instance while it is alive; queued requests of a
+//    destroyed instance are dropped before they reach the model
+//  - the instance leases its own coalescing key, so its slider prefetches only
+//    supersede its own and never another instance's
+//  - banks and clicks are served first come, first served across instances
+//
+// The engine is built from the config of the instance that creates it; instances
+// joining a running engine share it as configured and their config is ignored.
+// Plugin instances use the process-wide settings from getSettingsFile().
+class SharedInferenceService
+{
+public:
+    SharedInferenceService();
+    explicit SharedInferenceService(const InferenceEngineConfig& config);
+    ~SharedInferenceService();
+    
+    bool isModelLoaded() const { return engine->isModelLoaded(); }
+    void ensureStarted() { engine->ensureStarted(); }
+    int getBufferedBankCount() const { return engine->getBufferedBankCount(); }
+    
+    // Same contracts as the ThreadedInferenceEngine methods; callbacks run on the message thread
+    void requestCachedCustomVoice(const std::vector<float>& latentVector, std::function<void(DX7VoiceHandle)> callback);
+    void requestBufferedRandomVoices(std::function<void(DX7VoiceBankHandle)> callback);
+    void prefetchCustomVoices(const std::vector<float>& latents);
+    
+    // Random banks are identified by (seed, bank index) across every instance
+    uint64_t getRandomSeed() const { return engine->getRandomSeed(); }
+    int64_t getLastServedRandomBank() const { return engine->getLastServedRandomBank(); }
+    void requestRandomBank(uint64_t seed, uint64_t bankIndex, std::function<void(DX7VoiceBankHandle)> callback);
+    
+    // Model variants are engine-wide: switching affects every instance sharing it
+    void loadModelVariant(const juce::File& modelFile, bool activate, std::function<void(uint64_t)> callback);
+    bool switchToModel(uint64_t modelHash) { return engine->switchToModel(modelHash); }
+    uint64_t getActiveModelHash() const { return engine->getActiveModelHash(); }
+    
+    // Plugin instances currently sharing the engine
+    static int getNumClients();
+    
+    // Optional JSON object overriding InferenceEngineConfig defaults for every
+    // instance in the process, e.g. { "useInt8Inference": true, "randomSeed": 42 }.
+    // Recognised keys: useInferenceHost, useInt8Inference, int8MinAgreement,
+    // useLatentAtlas, usePersistentVoiceCache, randomSeed and randomLatentMode
+    // ("normal" or "sobol"). Read when the shared engine is created.
+    static juce::File getSettingsFile();
+    static InferenceEngineConfig loadSettings(const juce::File& settingsFile);
+    
+private:
+    // config == nullptr: the process-wide settings
+    static std::shared_ptr<ThreadedInferenceEngine> acquireEngine(const InferenceEngineConfig* config);
+    
+    template <typename Result>
+    std::function<void(Result)> guard(std::function<void(Result)> callback) const
+    {
+        // Checked on the message thread, where the instance is also destroyed
+        return [alive = alive, callback = std::move(callback)](Result result) {
+            if (!alive.isCancelled() && callback)
+            {
+                callback(std::move(result));
+            }
+        };
+    }
+    
+    std::shared_ptr<ThreadedInferenceEngine> engine;
+    CancellationToken alive = CancellationToken::create(); // Cancelled when this instance goes away
+    uint32_t coalescingKey = ThreadedInferenceEngine::PREFETCH_COALESCING_KEY;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedInferenceService)
+};
@@ -1,380 +1,1760 @@
 #include "ThreadedInferenceEngine.h"
+#include <algorithm>
 #include <iostream>
 
-ThreadedInferenceEngine::ThreadedInferenceEngine()
-    : juce::Thread("InferenceEngine")
+static_assert(VoiceCacheKey::LATENT_DIM == NeuralModelWrapper::LATENT_DIM, "Cache keys must cover the whole latent");
+
+ThreadedInferenceEngine::ThreadedInferenceEngine(const InferenceEngineConfig& config)
+    : engineConfig(config),
+      completionRing(static_cast<size_t>(juce::jmax(2, config.completionRingCapacity))),
+      constructionMs(juce::Time::getMillisecondCounterHiRes())
+{
+    neuralModel = std::make_shared<NeuralModelWrapper>();
+    
+    // Default to half the cores as workers (bank refills and slider pre-generation
+    // can then overlap) and hand the remaining cores out as intra-op threads
+    const int numCpus = juce::jmax(1, juce::SystemStats::getNumCpus());
+    numWorkers = config.numWorkers > 0 ? juce::jmin(config.numWorkers, MAX_WORKERS) : juce::jlimit(1, 4, numCpus / 2);
+    intraOpThreadsPerWorker = config.intraOpThreadsPerWorker > 0
+        ? config.intraOpThreadsPerWorker
+        : juce::jmax(1, numCpus / numWorkers);
+    microBatchWindowMs = juce::jmax(0.0, config.microBatchWindowMs);
+    maxMicroBatchSize = juce::jmax(1, config.maxMicroBatchSize);
+    
+    bankRingDepth = juce::jmax(1, config.randomBankRingDepth);
+    bankLowWatermark = juce::jlimit(1, bankRingDepth, config.randomBankLowWatermark);
+    randomSeed = config.randomSeed != 0 ? config.randomSeed : LatentSampler::makeEntropySeed();
+    randomLatentMode = config.randomLatentMode;
+    std::cout << "ThreadedInferenceEngine: Random banks use seed " << juce::String::toHexString(static_cast<juce::int64>(randomSeed))
+              << " (" << LatentSampler::getModeName(randomLatentMode) << " latents)" << std::endl;
+    
+    configureModel(*neuralModel);
+    
+    usePersistentCache = config.usePersistentVoiceCache;
+    persistentCacheFile = config.persistentVoiceCacheFile == juce::File()
+        ? PersistentVoiceCache::getDefaultFile()
+        : config.persistentVoiceCacheFile;
+    persistentCacheMaxBytes = config.persistentVoiceCacheMaxBytes;
+    
+    useLatentAtlas = config.useLatentAtlas;
+    latentAtlasFile = config.latentAtlasFile == juce::File()
+        ? LatentAtlas::getDefaultFile()
+        : config.latentAtlasFile;
+    latentAtlasSettings = config.latentAtlasSettings;
+    latentAtlasChunkSize = juce::jmax(1, config.latentAtlasChunkSize);
+    
+    useInferenceHost = config.useInferenceHost;
+    inferenceHostSocket = config.inferenceHostSocket.empty()
+        ? InferenceHostClient::getDefaultSocketPath()
+        : config.inferenceHostSocket;
+    inferenceHostExecutable = config.inferenceHostExecutable == juce::File()
+        ? InferenceHostClient::findHostExecutable()
+        : config.inferenceHostExecutable;
+    
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back(std::make_unique<InferenceWorker>(*this, i, config));
+    }
+    
+    if (config.warmUpInBackground)
+    {
+        warmUpThread = std::make_unique<WarmUpThread>(*this, juce::jmax(0, config.backgroundWarmUpDelayMs));
+        warmUpThread->startThread(juce::Thread::Priority::background);
+    }
+}
+
+void ThreadedInferenceEngine::configureModel(NeuralModelWrapper& model) const
+{
+    model.setInt8Inference(engineConfig.useInt8Inference, engineConfig.int8MinAgreement);
+    
+    // Warm up exactly the shapes the engine submits: single voices, full micro-batches,
+    // one bank and a full ring refill
+    model.setWarmupBatchSizes({ 1, maxMicroBatchSize, NeuralModelWrapper::N_VOICES,
+                                bankRingDepth * NeuralModelWrapper::N_VOICES });
+}
+
+ThreadedInferenceEngine::~ThreadedInferenceEngine()
+{
+    stopInferenceThread();
+    cancelPendingUpdate();
+}
+
+ThreadedInferenceEngine::InferenceWorker::InferenceWorker(ThreadedInferenceEngine& owner, int index, const InferenceEngineConfig& config)
+    : juce::Thread("InferenceWorker" + juce::String(index)), owner(owner), index(index)
+{
+    // Every ring slot is allocated here, so queueing never grows a container. The
+    // request itself still owns heap state: its callback, a batch's latents and
+    // the pinned variant.
+    for (int priority = 0; priority < NUM_PRIORITIES; ++priority)
+    {
+        singleVoiceRings[priority] = std::make_unique<LockFreeRing<InferenceRequest>>(static_cast<size_t>(juce::jmax(2, config.singleVoiceRingCapacity)));
+        batchRings[priority] = std::make_unique<LockFreeRing<InferenceRequest>>(static_cast<size_t>(juce::jmax(2, config.batchRingCapacity)));
+    }
+    
+    const int maxBatch = juce::jmax(1, config.maxMicroBatchSize);
+    batch.resize(static_cast<size_t>(maxBatch));
+    batch.clear();
+    batchedLatent.reserve(static_cast<size_t>(maxBatch * NeuralModelWrapper::LATENT_DIM));
+}
+
+void ThreadedInferenceEngine::InferenceWorker::run()
+{
+    owner.runWorker(index);
+}
+
+ThreadedInferenceEngine::WarmUpThread::WarmUpThread(ThreadedInferenceEngine& owner, int delayMs)
+    : juce::Thread("InferenceWarmUp"), owner(owner), delayMs(delayMs)
+{
+}
+
+void ThreadedInferenceEngine::WarmUpThread::run()
+{
+    // Returns early when the engine is torn down during the delay, e.g. in a plugin scan
+    wait(delayMs);
+    if (threadShouldExit() || owner.modelLoaded.load())
+    {
+        return;
+    }
+    
+    if (!owner.useInferenceHost.load())
+    {
+        NeuralModelWrapper::setIntraOpThreadsForCurrentThread(owner.intraOpThreadsPerWorker);
+    }
+    
+    std::cout << "ThreadedInferenceEngine: Warming up in the background" << std::endl;
+    owner.ensureModelLoaded();
+}
+
+double ThreadedInferenceEngine::millisecondsSinceConstruction() const
+{
+    return juce::Time::getMillisecondCounterHiRes() - constructionMs;
+}
+
+void ThreadedInferenceEngine::ensureStarted()
+{
+    if (started.exchange(true))
+    {
+        return;
+    }
+    
+    const double elapsed = millisecondsSinceConstruction();
+    startRequestedMs.store(elapsed);
+    std::cout << "ThreadedInferenceEngine: First use " << juce::String(elapsed, 1)
+              << " ms after construction" << std::endl;
+    
+    startInferenceThread();
+}
+
+InferenceEngineStartupTimings ThreadedInferenceEngine::getStartupTimings() const
+{
+    InferenceEngineStartupTimings timings;
+    timings.startRequestedMs = startRequestedMs.load();
+    timings.loadStartedMs = loadStartedMs.load();
+    timings.readyMs = readyMs.load();
+    return timings;
+}
+
+void ThreadedInferenceEngine::startInferenceThread()
+{
+    shouldStop.store(false);
+    modelLoadFailed.store(false);
+    started.store(true);
+    
+    for (auto& worker : workers)
+    {
+        if (!worker->isThreadRunning())
+        {
+            worker->startThread(juce::Thread::Priority::high);
+        }
+    }
+    
+    std::cout << "ThreadedInferenceEngine: Started " << numWorkers << " inference workers ("
+              << intraOpThreadsPerWorker << " intra-op threads each)" << std::endl;
+    
+    // Don't pre-generate buffer here - let the workers handle it after model loads
+}
+
+void ThreadedInferenceEngine::signalStop()
+{
+    shouldStop.store(true);
+    
+    if (warmUpThread != nullptr)
+    {
+        // Ends the warm-up delay early; a load already under way runs to completion
+        warmUpThread->signalThreadShouldExit();
+        warmUpThread->notify();
+    }
+    
+    // Wake up every worker
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wakeEvent.signal();
+    }
+}
+
+void ThreadedInferenceEngine::stopInferenceThread()
+{
+    signalStop();
+    
+    if (warmUpThread != nullptr)
+    {
+        warmUpThread->waitForThreadToExit(-1);
+    }
+    
+    bool stoppedAny = false;
+    for (auto& worker : workers)
+    {
+        if (worker->isThreadRunning())
+        {
+            worker->waitForThreadToExit(-1);
+            stoppedAny = true;
+        }
+    }
+    
+    if (stoppedAny)
+    {
+        std::cout << "ThreadedInferenceEngine: Stopped inference workers" << std::endl;
+    }
+}
+
+bool ThreadedInferenceEngine::ensureModelLoaded()
+{
+    // The first worker in loads the shared model, the rest block here until it is ready
+    std::unique_lock<std::mutex> lock(modelLoadMutex);
+    
+    if (modelLoaded.load())
+    {
+        return true;
+    }
+    
+    loadStartedMs.store(millisecondsSinceConstruction());
+    const double loadStart = juce::Time::getMillisecondCounterHiRes();
+    
+    std::shared_ptr<ModelVariant> variant;
+    if (useInferenceHost && connectToInferenceHost())
+    {
+        std::cout << "ThreadedInferenceEngine: Running inference in the helper process" << std::endl;
+        variant = createVariant(nullptr, hostModelHash, true);
+    }
+    else
+    {
+        std::cout << "ThreadedInferenceEngine: Loading model..." << std::endl;
+        
+        if (!neuralModel->loadModelFromFile())
+        {
+            std::cout << "ThreadedInferenceEngine: Failed to load model" << std::endl;
+            return false;
+        }
+        variant = createVariant(neuralModel, neuralModel->getModelHash(), true);
+    }
+    
+    {
+        std::lock_guard<std::mutex> variantsLock(variantsMutex);
+        loadedVariants.push_back(variant);
+    }
+    std::atomic_store(&activeVariant, variant);
+    
+    readyMs.store(millisecondsSinceConstruction());
+    modelLoaded.store(true);
+    std::cout << "ThreadedInferenceEngine: Model loaded successfully, ready "
+              << juce::String(readyMs.load(), 1) << " ms after construction (load took "
+              << juce::String(juce::Time::getMillisecondCounterHiRes() - loadStart, 1) << " ms)" << std::endl;
+    return true;
+}
+
+void ThreadedInferenceEngine::startBackgroundGeneration()
+{
+    // Bank and atlas generation wait for the workers, so a background warm-up alone
+    // only loads the model. The first worker past the load kicks them off.
+    if (backgroundGenerationStarted.exchange(true))
+    {
+        return;
+    }
+    
+    preGenerateRandomVoices();
+    scheduleAtlasChunk(getActiveVariant());
+}
+
+bool ThreadedInferenceEngine::connectToInferenceHost()
+{
+    // Called with modelLoadMutex held. The first connection starts the host if needed.
+    auto connection = std::make_unique<InferenceHostClient>();
+    if (!connection->connect(inferenceHostSocket, inferenceHostExecutable))
+    {
+        std::cerr << "ThreadedInferenceEngine: Inference host unavailable, running the model in-process" << std::endl;
+        useInferenceHost.store(false);
+        return false;
+    }
+    
+    hostModelHash = connection->getModelHash();
+    releaseHostConnection(std::move(connection));
+    return true;
+}
+
+std::unique_ptr<InferenceHostClient> ThreadedInferenceEngine::acquireHostConnection()
+{
+    {
+        std::lock_guard<std::mutex> lock(hostConnectionMutex);
+        if (!idleHostConnections.empty())
+        {
+            auto connection = std::move(idleHostConnections.back());
+            idleHostConnections.pop_back();
+            return connection;
+        }
+    }
+    
+    // One connection per concurrently decoding worker; a crashed host is restarted here
+    auto connection = std::make_unique<InferenceHostClient>();
+    if (!connection->connect(inferenceHostSocket, inferenceHostExecutable))
+    {
+        return nullptr;
+    }
+    
+    // Its voices wouldn't match what the caches and the active variant hold
+    if (connection->getModelHash() != hostModelHash)
+    {
+        std::cerr << "ThreadedInferenceEngine: Inference host came back with a different model, running the model in-process" << std::endl;
+        fallBackToInProcess();
+        return nullptr;
+    }
+    return connection;
+}
+
+void ThreadedInferenceEngine::fallBackToInProcess()
+{
+    std::shared_ptr<ModelVariant> variant;
+    
+    {
+        // Later callers wait here until the first one has loaded the model
+        std::unique_lock<std::mutex> lock(modelLoadMutex);
+        
+        if (!useInferenceHost.exchange(false))
+        {
+            return;
+        }
+        
+        {
+            std::lock_guard<std::mutex> connectionsLock(hostConnectionMutex);
+            idleHostConnections.clear();
+        }
+        
+        if (!neuralModel->loadModelFromFile())
+        {
+            std::cerr << "ThreadedInferenceEngine: Failed to load model, requests will fail" << std::endl;
+            return;
+        }
+        variant = createVariant(neuralModel, neuralModel->getModelHash(), true);
+        
+        std::lock_guard<std::mutex> variantsLock(variantsMutex);
+        loadedVariants.push_back(variant);
+    }
+    
+    activateVariant(variant);
+}
+
+void ThreadedInferenceEngine::releaseHostConnection(std::unique_ptr<InferenceHostClient> connection)
+{
+    if (connection != nullptr && connection->isConnected())
+    {
+        std::lock_guard<std::mutex> lock(hostConnectionMutex);
+        idleHostConnections.push_back(std::move(connection));
+    }
+}
+
+DX7VoiceBank ThreadedInferenceEngine::decodeVoices(const ModelVariant& variant, const std::vector<float>& latents)
+{
+    if (variant.model != nullptr)
+    {
+        return variant.model->generateVoices(latents);
+    }
+    
+    // Pinned to the host's variant before we fell back to in-process inference
+    if (!useInferenceHost.load())
+    {
+        return {};
+    }
+    
+    DX7VoiceBank voices;
+    auto connection = acquireHostConnection();
+    if (connection == nullptr || !connection->decode(latents, voices))
+    {
+        // The request fails like a model error would; the next one reconnects
+        std::cerr << "ThreadedInferenceEngine: Inference host request failed" << std::endl;
+        voices.clear();
+    }
+    releaseHostConnection(std::move(connection));
+    return voices;
+}
+
+DX7VoiceBank ThreadedInferenceEngine::decodeRandomBanks(const ModelVariant& variant, uint64_t firstBank, int numBanks)
+{
+    return decodeVoices(variant, LatentSampler::generateBanks(randomSeed, firstBank, numBanks, randomLatentMode));
+}
+
+void ThreadedInferenceEngine::runWorker(int workerIndex)
+{
+    std::cout << "ThreadedInferenceEngine: Worker " << workerIndex << " started" << std::endl;
+    
+    // In host mode libtorch's thread pools stay out of the DAW unless we fall back,
+    // at startup or later on
+    bool inProcessThreadsSet = !useInferenceHost.load();
+    if (inProcessThreadsSet)
+    {
+        NeuralModelWrapper::setIntraOpThreadsForCurrentThread(intraOpThreadsPerWorker);
+    }
+    
+    // Load model in background thread
+    if (!ensureModelLoaded())
+    {
+        // Nothing can run without a model: answer what is queued now, and what is
+        // submitted from here on, with a null result
+        modelLoadFailed.store(true);
+        failQueuedRequests();
+        return;
+    }
+    
+    startBackgroundGeneration();
+    
+    auto& worker = *workers[workerIndex];
+    InferenceRequest request;
+    
+    // Main inference loop
+    while (!shouldStop.load())
+    {
+        if (!takeRequest(workerIndex, request))
+        {
+            // Block until a submitter or stopInferenceThread wakes us
+            waitForWork(workerIndex);
+            continue;
+        }
+        
+        if (!inProcessThreadsSet && !useInferenceHost.load())
+        {
+            NeuralModelWrapper::setIntraOpThreadsForCurrentThread(intraOpThreadsPerWorker);
+            inProcessThreadsSet = true;
+        }
+        
+        if (request.type == InferenceRequest::SINGLE_CUSTOM_VOICE)
+        {
+            worker.batch.clear();
+            worker.batch.push_back(std::move(request));
+            gatherMicroBatch(workerIndex);
+            processSingleVoiceBatch(worker);
+        }
+        else
+        {
+            processInferenceRequest(request);
+        }
+        
+        // Release captured state now rather than when the slot is next reused
+        request = InferenceRequest();
+    }
+    
+    std::cout << "ThreadedInferenceEngine: Worker " << workerIndex << " exiting" << std::endl;
+}
+
+void ThreadedInferenceEngine::waitForWork(int workerIndex)
+{
+    const uint32_t bit = 1u << workerIndex;
+    
+    // Publish that we're going to sleep, then re-check so a request submitted in
+    // between can't be missed (its submitter either sees our bit or we see its count)
+    sleepingWorkers.fetch_or(bit);
+    
+    if (pendingRequests.load() <= 0 && !shouldStop.load())
+    {
+        workers[workerIndex]->wakeEvent.wait(-1);
+    }
+    
+    sleepingWorkers.fetch_and(~bit);
+}
+
+void ThreadedInferenceEngine::submitRequest(InferenceRequest&& request)
+{
+    if (modelLoadFailed.load())
+    {
+        failRequest(request);
+        return;
+    }
+    
+    // Pin the model the request will run on; null before the first model has loaded
+    if (request.variant == nullptr)
+    {
+        request.variant = getActiveVariant();
+    }
+    
+    const uint32_t key = request.options.coalescingKey;
+    if (key != 0)
+    {
+        jassert(key < MAX_COALESCING_KEYS);
+        // Anything already queued under this key is now stale and will be dropped
+        request.coalescingGeneration = coalescingGenerations[key % MAX_COALESCING_KEYS].fetch_add(1) + 1;
+    }
+    
+    const bool singleVoice = request.type == InferenceRequest::SINGLE_CUSTOM_VOICE;
+    const int priority = static_cast<int>(request.options.priority);
+    
+    // Spread requests round-robin; idle workers steal whatever is left queued.
+    // If the chosen worker's ring is full, spill over to the next one.
+    const int first = static_cast<int>(nextWorker.fetch_add(1) % static_cast<unsigned int>(numWorkers));
+    
+    for (int offset = 0; offset < numWorkers; ++offset)
+    {
+        const int target = (first + offset) % numWorkers;
+        auto& worker = *workers[target];
+        auto& ring = singleVoice ? *worker.singleVoiceRings[priority] : *worker.batchRings[priority];
+        
+        if (ring.push(std::move(request)))
+        {
+            pendingRequests.fetch_add(1);
+            if (singleVoice)
+            {
+                pendingSingleVoiceRequests.fetch_add(1);
+            }
+            wakeWorkerFor(target, singleVoice);
+            
+            // The workers may have given up on the model after our check above
+            if (modelLoadFailed.load())
+            {
+                failQueuedRequests();
+            }
+            return;
+        }
+    }
+    
+    // Never silently: the caller gets a null result, just later on the message thread
+    std::cerr << "ThreadedInferenceEngine: Request queues full, failing request" << std::endl;
+    failRequest(request);
+}
+
+void ThreadedInferenceEngine::wakeWorkerFor(int targetIndex, bool singleVoice)
+{
+    // A worker holding a micro-batch window open will take a single voice request
+    if (singleVoice)
+    {
+        const uint32_t gathering = gatheringWorkers.load();
+        if (gathering != 0)
+        {
+            workers[pickWorkerToWake(gathering, targetIndex)]->wakeEvent.signal();
+            return;
+        }
+    }
+    
+    // Prefer the worker we queued on; otherwise any sleeper will steal it
+    const uint32_t sleeping = sleepingWorkers.load();
+    if (sleeping == 0)
+    {
+        return; // Everyone is busy and will look at the rings before sleeping again
+    }
+    
+    workers[pickWorkerToWake(sleeping, targetIndex)]->wakeEvent.signal();
+}
+
+int ThreadedInferenceEngine::pickWorkerToWake(uint32_t candidates, int preferredIndex)
+{
+    if ((candidates & (1u << preferredIndex)) != 0)
+    {
+        return preferredIndex;
+    }
+    
+    int index = 0;
+    while ((candidates & (1u << index)) == 0)
+    {
+        ++index;
+    }
+    return index;
+}
+
+uint32_t ThreadedInferenceEngine::acquireCoalescingKey()
+{
+    uint64_t leased = leasedCoalescingKeys.load();
+    
+    for (;;)
+    {
+        uint32_t key = FIRST_CLIENT_COALESCING_KEY;
+        while (key < MAX_COALESCING_KEYS && (leased & (1ull << key)) != 0)
+        {
+            ++key;
+        }
+        
+        if (key == MAX_COALESCING_KEYS)
+        {
+            return PREFETCH_COALESCING_KEY;
+        }
+        
+        if (leasedCoalescingKeys.compare_exchange_weak(leased, leased | (1ull << key)))
+        {
+            return key;
+        }
+    }
+}
+
+void ThreadedInferenceEngine::releaseCoalescingKey(uint32_t key)
+{
+    if (key >= FIRST_CLIENT_COALESCING_KEY && key < MAX_COALESCING_KEYS)
+    {
+        // Whatever the old lessee still has queued goes stale with the release
+        coalescingGenerations[key].fetch_add(1);
+        leasedCoalescingKeys.fetch_and(~(1ull << key));
+    }
+}
+
+bool ThreadedInferenceEngine::isStale(const InferenceRequest& request) const
+{
+    if (request.options.cancellation.isCancelled())
+    {
+        return true;
+    }
+    
+    const uint32_t key = request.options.coalescingKey;
+    return key != 0
+        && coalescingGenerations[key % MAX_COALESCING_KEYS].load() != request.coalescingGeneration;
+}
+
+void ThreadedInferenceEngine::dropRequest(InferenceRequest& request)
+{
+    // Release the cache key this request reserved so it can be generated again later
+    if (request.cacheResult && request.variant != nullptr && request.type == InferenceRequest::PREFETCH_VOICES)
+    {
+        for (size_t offset = 0; offset + NeuralModelWrapper::LATENT_DIM <= request.latentVector.size(); offset += NeuralModelWrapper::LATENT_DIM)
+        {
+            request.variant->voiceCache.cancelReservation(VoiceCacheKey::fromLatent(request.latentVector.data() + offset, NeuralModelWrapper::LATENT_DIM));
+        }
+    }
+    else if (request.cacheResult && request.variant != nullptr)
+    {
+        request.variant->voiceCache.cancelReservation(VoiceCacheKey::fromLatent(request.latent.data(), request.latent.size()));
+    }
+    
+    if (request.type == InferenceRequest::LOAD_MODEL_VARIANT && request.modelCallback)
+    {
+        InferenceResult result;
+        result.modelCallback = std::move(request.modelCallback);
+        postResult(std::move(result));
+    }
+    
+    // Let the next low-watermark check schedule another refill
+    if (request.type == InferenceRequest::REFILL_RANDOM_BANKS)
+    {
+        isGeneratingBuffer.store(false);
+    }
+    
+    // Likewise for the next atlas chunk
+    if (request.type == InferenceRequest::BUILD_ATLAS_CHUNK && request.variant != nullptr)
+    {
+        request.variant->atlasChunkQueued.store(false);
+    }
+}
+
+void ThreadedInferenceEngine::failRequest(InferenceRequest& request)
+{
+    // Accepted but never run: release what it holds like a dropped request, and
+    // give a waiting caller a null result instead of leaving it hanging
+    dropRequest(request);
+    
+    if (request.singleCallback || request.callback)
+    {
+        InferenceResult result;
+        result.singleCallback = std::move(request.singleCallback);
+        result.callback = std::move(request.callback);
+        postResult(std::move(result));
+    }
+    
+    // Clicks parked on the ring were waiting for this refill
+    if (request.type == InferenceRequest::REFILL_RANDOM_BANKS)
+    {
+        failWaitingBankCallbacks();
+    }
+}
+
+void ThreadedInferenceEngine::failQueuedRequests()
+{
+    InferenceRequest request;
+    
+    for (auto& worker : workers)
+    {
+        for (int priority = 0; priority < NUM_PRIORITIES; ++priority)
+        {
+            for (auto* ring : { worker->singleVoiceRings[priority].get(), worker->batchRings[priority].get() })
+            {
+                while (ring->pop(request))
+                {
+                    countTakenRequest(request);
+                    
+                    if (isStale(request))
+                    {
+                        dropRequest(request);
+                    }
+                    else
+                    {
+                        failRequest(request);
+                    }
+                    
+                    request = InferenceRequest();
+                }
+            }
+        }
+    }
+    
+    failWaitingBankCallbacks();
+}
+
+void ThreadedInferenceEngine::failWaitingBankCallbacks()
+{
+    std::deque<std::function<void(DX7VoiceBankHandle)>> waiting;
+    {
+        std::unique_lock<std::mutex> lock(bufferMutex);
+        waiting.swap(waitingBankCallbacks);
+    }
+    
+    for (auto& callback : waiting)
+    {
+        InferenceResult result;
+        result.callback = std::move(callback);
+        postResult(std::move(result));
+    }
+}
+
+void ThreadedInferenceEngine::countTakenRequest(const InferenceRequest& request)
+{
+    pendingRequests.fetch_sub(1);
+    if (request.type == InferenceRequest::SINGLE_CUSTOM_VOICE)
+    {
+        pendingSingleVoiceRequests.fetch_sub(1);
+    }
+}
+
+bool ThreadedInferenceEngine::takeRequest(int workerIndex, InferenceRequest& request)
+{
+    // Highest priority first. Within a priority, own rings first, then steal from
+    // siblings. Single voice requests go first since they are the cheapest.
+    for (int priority = 0; priority < NUM_PRIORITIES; ++priority)
+    {
+        for (int offset = 0; offset < numWorkers; ++offset)
+        {
+            auto& worker = *workers[(workerIndex + offset) % numWorkers];
+            
+            for (auto* ring : { worker.singleVoiceRings[priority].get(), worker.batchRings[priority].get() })
+            {
+                while (ring->pop(request))
+                {
+                    countTakenRequest(request);
+                    
+                    // Superseded or cancelled work never reaches the model
+                    if (!isStale(request))
+                    {
+                        return true;
+                    }
+                    
+                    dropRequest(request);
+                }
+            }
+        }
+    }
+    
+    return false;
+}
+
+bool ThreadedInferenceEngine::takeSingleVoiceRequest(int workerIndex, InferenceRequest& request)
+{
+    // Like takeRequest, but only looks at the single voice rings so the request
+    // can join a micro-batch; everything else is left for the next pass
+    for (int priority = 0; priority < NUM_PRIORITIES; ++priority)
+    {
+        for (int offset = 0; offset < numWorkers; ++offset)
+        {
+            auto& ring = *workers[(workerIndex + offset) % numWorkers]->singleVoiceRings[priority];
+            
+            while (ring.pop(request))
+            {
+                countTakenRequest(request);
+                
+                if (!isStale(request))
+                {
+                    return true;
+                }
+                
+                dropRequest(request);
+            }
+        }
+    }
+    
+    return false;
+}
+
+void ThreadedInferenceEngine::gatherMicroBatch(int workerIndex)
+{
+    const auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::microseconds(static_cast<int64_t>(microBatchWindowMs * 1000.0));
+    
+    auto& worker = *workers[workerIndex];
+    const uint32_t bit = 1u << workerIndex;
+    
+    InferenceRequest next;
+    
+    while (static_cast<int>(worker.batch.size()) < maxMicroBatchSize && !shouldStop.load())
+    {
+        if (takeSingleVoiceRequest(workerIndex, next))
+        {
+            worker.batch.push_back(std::move(next));
+            continue;
+        }
+        
+        const auto remaining = std::chrono::duration<double, std::milli>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0.0)
+        {
+            break;
+        }
+        
+        // Give other callers until the end of the window to join this batch. Only a
+        // single voice request ends the wait early; queued batch work waits its turn.
+        gatheringWorkers.fetch_or(bit);
+        if (pendingSingleVoiceRequests.load() <= 0)
+        {
+            worker.wakeEvent.wait(remaining);
+        }
+        gatheringWorkers.fetch_and(~bit);
+    }
+}
+
+void ThreadedInferenceEngine::processSingleVoiceBatch(InferenceWorker& worker)
+{
+    auto& batch = worker.batch;
+    
+    // Requests can be superseded while the batch window is open
+    batch.erase(std::remove_if(batch.begin(), batch.end(), [this](InferenceRequest& r) {
+        if (!isStale(r))
+            return false;
+        dropRequest(r);
+        return true;
+    }), batch.end());
+    
+    if (batch.empty())
+    {
+        return;
+    }
+    
+    if (!modelLoaded.load())
+    {
+        DBG("ThreadedInferenceEngine: Model not loaded, skipping request");
+        for (auto& request : batch)
+        {
+            failRequest(request);
+        }
+        batch.clear();
+        return;
+    }
+    
+    DBG("ThreadedInferenceEngine: Processing batch of " << batch.size() << " single voice requests");
+    
+    // Requests pinned to different models (around a switch) can't share a forward pass
+    for (size_t first = 0, end = 0; first < batch.size(); first = end)
+    {
+        end = first + 1;
+        while (end < batch.size() && batch[end].variant == batch[first].variant)
+        {
+            ++end;
+        }
+        
+        const auto variant = batch[first].variant != nullptr ? batch[first].variant : getActiveVariant();
+        
+        // Stack every latent into one [N,8] input so the run costs a single forward pass
+        auto& batchedLatent = worker.batchedLatent;
+        batchedLatent.clear();
+        for (size_t i = first; i < end; ++i)
+        {
+            batchedLatent.insert(batchedLatent.end(), batch[i].latent.begin(), batch[i].latent.end());
+        }
+        
+        DX7VoiceBank voices;
+        try
+        {
+            voices = decodeVoices(*variant, batchedLatent);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "ThreadedInferenceEngine: Error processing micro-batch: " << e.what() << std::endl;
+        }
+        
+        const bool complete = static_cast<size_t>(voices.size()) == end - first;
+        
+        // The whole run goes to disk in one write
+        std::vector<PersistentVoiceCache::Entry> persistentWrites;
+        for (size_t i = first; i < end; ++i)
+        {
+            completeSingleVoice(variant.get(), batch[i],
+                                complete ? std::make_shared<const DX7Voice>(voices[static_cast<int>(i - first)].toVoice()) : nullptr,
+                                persistentWrites);
+        }
+        
+        if (variant != nullptr && !persistentWrites.empty())
+        {
+            variant->persistentCache.append(persistentWrites);
+        }
+    }
+    
+    batch.clear();
+}
+
+void ThreadedInferenceEngine::completeSingleVoice(ModelVariant* variant, InferenceRequest& request, DX7VoiceHandle voice,
+                                                  std::vector<PersistentVoiceCache::Entry>& persistentWrites)
+{
+    // Only requests that reserved a key in their pinned variant's cache fill it;
+    // the caller writes persistentWrites to the variant's disk cache afterwards
+    if (request.cacheResult && variant != nullptr && variant == request.variant.get())
+    {
+        const auto key = VoiceCacheKey::fromLatent(request.latent.data(), request.latent.size());
+        
+        if (voice != nullptr)
+        {
+            variant->voiceCache.insert(key, voice);
+            persistentWrites.push_back({ key, voice });
+        }
+        else
+        {
+            variant->voiceCache.cancelReservation(key);
+        }
+    }
+    
+    if (request.singleCallback)
+    {
+        InferenceResult result;
+        result.singleCallback = std::move(request.singleCallback);
+        result.voice = std::move(voice);
+        postResult(std::move(result));
+    }
+}
+
+void ThreadedInferenceEngine::completePrefetch(ModelVariant& variant, InferenceRequest& request, const DX7VoiceBank& voices)
+{
+    const size_t numLatents = request.latentVector.size() / NeuralModelWrapper::LATENT_DIM;
+    
+    if (static_cast<size_t>(voices.size()) != numLatents)
+    {
+        dropRequest(request);
+        return;
+    }
+    
+    std::vector<PersistentVoiceCache::Entry> persistentWrites;
+    persistentWrites.reserve(numLatents);
+    
+    for (size_t i = 0; i < numLatents; ++i)
+    {
+        const auto key = VoiceCacheKey::fromLatent(request.latentVector.data() + i * NeuralModelWrapper::LATENT_DIM,
+                                                   NeuralModelWrapper::LATENT_DIM);
+        auto voice = std::make_shared<const DX7Voice>(voices[static_cast<int>(i)].toVoice());
+        variant.voiceCache.insert(key, voice);
+        persistentWrites.push_back({ key, std::move(voice) });
+    }
+    
+    variant.persistentCache.append(persistentWrites);
+}
+
+void ThreadedInferenceEngine::processInferenceRequest(InferenceRequest& request)
+{
+    if (!modelLoaded.load())
+    {
+        DBG("ThreadedInferenceEngine: Model not loaded, skipping request");
+        failRequest(request);
+        return;
+    }
+    
+    if (isStale(request))
+    {
+        DBG("ThreadedInferenceEngine: Dropping superseded request");
+        dropRequest(request);
+        return;
+    }
+    
+    // Submitted before the first model loaded: run on whatever is active now
+    if (request.variant == nullptr)
+    {
+        request.variant = getActiveVariant();
+    }
+    auto& variant = *request.variant;
+    
+    DX7VoiceBank voices;
+    
+    try
+    {
+        switch (request.type)
+        {
+            case InferenceRequest::RANDOM_VOICES:
+            {
+                const uint64_t bank = nextRandomBank.fetch_add(1);
+                DBG("ThreadedInferenceEngine: Processing random voices request (bank " << bank << ")");
+                voices = decodeRandomBanks(variant, bank, 1);
+                break;
+            }
+            
+            case InferenceRequest::REFILL_RANDOM_BANKS:
+            {
+                refillRandomBanks(request.variant);
+                return;
+            }
+            
+            case InferenceRequest::BUILD_ATLAS_CHUNK:
+            {
+                buildAtlasChunk(request.variant);
+                return;
+            }
+            
+            case InferenceRequest::LOAD_MODEL_VARIANT:
+            {
+                loadVariantFromFile(request);
+                return;
+            }
+            
+            case InferenceRequest::PREFETCH_VOICES:
+            {
+                DBG("ThreadedInferenceEngine: Prefetching " << request.latentVector.size() / NeuralModelWrapper::LATENT_DIM << " voices");
+                completePrefetch(variant, request, decodeVoices(variant, request.latentVector));
+                return;
+            }
+            
+            case InferenceRequest::CUSTOM_VOICES:
+            {
+                DBG("ThreadedInferenceEngine: Processing custom voices request");
+                voices = decodeVoices(variant, request.latentVector);
+                break;
+            }
+            
+            case InferenceRequest::SINGLE_CUSTOM_VOICE:
+            {
+                // runWorker sends every single voice through processSingleVoiceBatch
+                jassertfalse;
+                failRequest(request);
+                return;
+            }
+        }
+        
+        // Call multi-voice callback on main thread; a failed decode gets a null bank
+        if (request.callback)
+        {
+            InferenceResult result;
+            result.callback = std::move(request.callback);
+            result.voices = voices.empty() ? nullptr : std::make_shared<const DX7VoiceBank>(std::move(voices));
+            postResult(std::move(result));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "ThreadedInferenceEngine: Error processing request: " << e.what() << std::endl;
+        
+        // Releases a single voice's cache reservation and answers its caller too
+        failRequest(request);
+    }
+}
+
+void ThreadedInferenceEngine::postResult(InferenceResult&& result)
+{
+    if (!completionRing.push(std::move(result)))
+    {
+        // Ring full - the message thread is badly behind, fall back to a one-off message
+        std::cerr << "ThreadedInferenceEngine: Completion ring full, posting directly" << std::endl;
+        juce::MessageManager::callAsync([r = std::make_shared<InferenceResult>(std::move(result))]() {
+            if (r->singleCallback)
+                r->singleCallback(std::move(r->voice));
+            else if (r->callback)
+                r->callback(std::move(r->voices));
+            else if (r->modelCallback)
+                r->modelCallback(r->modelHash);
+        });
+        return;
+    }
+    
+    // Coalesces with any update that is already pending
+    triggerAsyncUpdate();
+}
+
+void ThreadedInferenceEngine::handleAsyncUpdate()
+{
+    InferenceResult result;
+    
+    while (completionRing.pop(result))
+    {
+        if (result.singleCallback)
+        {
+            result.singleCallback(std::move(result.voice));
+        }
+        else if (result.callback)
+        {
+            result.callback(std::move(result.voices));
+        }
+        else if (result.modelCallback)
+        {
+            result.modelCallback(result.modelHash);
+        }
+        
+        result = InferenceResult();
+    }
+}
+
+void ThreadedInferenceEngine::requestRandomVoices(std::function<void(DX7VoiceBankHandle)> callback,
+                                                  const InferenceRequestOptions& options)
 {
-    neuralModel = std::make_unique<NeuralModelWrapper>();
+    InferenceRequest request(InferenceRequest::RANDOM_VOICES, std::move(callback));
+    request.options = options;
+    submitRequest(std::move(request));
 }
 
-ThreadedInferenceEngine::~ThreadedInferenceEngine()
+void ThreadedInferenceEngine::requestRandomBank(uint64_t seed, uint64_t bankIndex, std::function<void(DX7VoiceBankHandle)> callback,
+                                                const InferenceRequestOptions& options)
 {
-    stopInferenceThread();
+    // A plain batch request; the latents are a pure function of (seed, bankIndex)
+    InferenceRequest request(InferenceRequest::CUSTOM_VOICES, LatentSampler::generateBanks(seed, bankIndex, 1, randomLatentMode), std::move(callback));
+    request.options = options;
+    submitRequest(std::move(request));
 }
 
-void ThreadedInferenceEngine::startInferenceThread()
+void ThreadedInferenceEngine::requestCustomVoices(const std::vector<float>& latentVector, std::function<void(DX7VoiceBankHandle)> callback,
+                                                  const InferenceRequestOptions& options)
 {
-    if (!isThreadRunning())
+    InferenceRequest request(InferenceRequest::CUSTOM_VOICES, latentVector, std::move(callback));
+    request.options = options;
+    submitRequest(std::move(request));
+}
+
+void ThreadedInferenceEngine::requestSingleCustomVoice(const std::vector<float>& latentVector, std::function<void(DX7VoiceHandle)> callback,
+                                                       const InferenceRequestOptions& options)
+{
+    if (latentVector.size() != NeuralModelWrapper::LATENT_DIM)
     {
-        shouldStop.store(false);
-        startThread(juce::Thread::Priority::high);
-        std::cout << "ThreadedInferenceEngine: Started inference thread" << std::endl;
-        
-        // Don't pre-generate buffer here - let the thread handle it after model loads
+        std::cerr << "ThreadedInferenceEngine: Single voice request needs " << NeuralModelWrapper::LATENT_DIM << " latent values" << std::endl;
+        failSingleVoice(std::move(callback));
+        return;
     }
+    
+    InferenceRequest request(InferenceRequest::SINGLE_CUSTOM_VOICE, latentVector, std::move(callback));
+    request.options = options;
+    submitRequest(std::move(request));
 }
 
-void ThreadedInferenceEngine::stopInferenceThread()
+void ThreadedInferenceEngine::failSingleVoice(std::function<void(DX7VoiceHandle)> callback)
 {
-    if (isThreadRunning())
+    // Rejected before it was queued, but the caller still hears back on the message thread
+    if (callback)
     {
-        shouldStop.store(true);
-        
-        // Wake up the thread
-        {
-            std::unique_lock<std::mutex> lock(requestMutex);
-            requestCondition.notify_all();
-        }
-        
-        // Wait for thread to finish
-        stopThread(2000); // 2 second timeout
-        std::cout << "ThreadedInferenceEngine: Stopped inference thread" << std::endl;
+        InferenceResult result;
+        result.singleCallback = std::move(callback);
+        postResult(std::move(result));
     }
 }
 
-void ThreadedInferenceEngine::run()
+bool ThreadedInferenceEngine::hasBufferedRandomVoices() const
+{
+    return bufferedBankCount.load() > 0;
+}
+
+int ThreadedInferenceEngine::getBufferedBankCount() const
 {
-    std::cout << "ThreadedInferenceEngine: Thread started, loading model..." << std::endl;
-    
-    // Load model in background thread
-    if (neuralModel->loadModelFromFile())
+    return bufferedBankCount.load();
+}
+
+DX7VoiceBankHandle ThreadedInferenceEngine::popBufferedBank()
+{
+    // Called with bufferMutex held; null if the ring is empty
+    if (bufferedBanks.empty())
     {
-        modelLoaded.store(true);
-        std::cout << "ThreadedInferenceEngine: Model loaded successfully" << std::endl;
-        
-        // Now that model is loaded, generate initial buffer
-        preGenerateRandomVoices();
+        return nullptr;
     }
-    else
+    
+    DX7VoiceBankHandle voices = std::move(bufferedBanks.front().voices);
+    lastServedRandomBank.store(static_cast<int64_t>(bufferedBanks.front().index));
+    bufferedBanks.pop_front();
+    bufferedBankCount.store(static_cast<int>(bufferedBanks.size()));
+    return voices;
+}
+
+DX7VoiceBankHandle ThreadedInferenceEngine::getBufferedRandomVoices()
+{
+    DX7VoiceBankHandle voices;
+    
     {
-        std::cout << "ThreadedInferenceEngine: Failed to load model" << std::endl;
-        return;
+        std::unique_lock<std::mutex> lock(bufferMutex);
+        voices = popBufferedBank();
     }
     
-    // Main inference loop
-    while (!shouldStop.load())
+    // Top the ring back up once it runs low
+    if (bufferedBankCount.load() < bankLowWatermark)
     {
-        processInferenceRequests();
-        
-        // Wait for new requests or stop signal
-        std::unique_lock<std::mutex> lock(requestMutex);
-        requestCondition.wait_for(lock, std::chrono::milliseconds(100), [this]() {
-            return !requestQueue.empty() || shouldStop.load();
-        });
+        preGenerateRandomVoices();
     }
     
-    std::cout << "ThreadedInferenceEngine: Thread exiting" << std::endl;
+    return voices;
 }
 
-void ThreadedInferenceEngine::processInferenceRequests()
+void ThreadedInferenceEngine::requestBufferedRandomVoices(std::function<void(DX7VoiceBankHandle)> callback)
 {
-    std::queue<InferenceRequest> localQueue;
+    InferenceResult result;
+    
+    {
+        // Checked and taken under one lock: a model switch clearing the ring in
+        // between would otherwise leave the caller with a null bank
+        std::unique_lock<std::mutex> lock(bufferMutex);
+        result.voices = popBufferedBank();
+        
+        if (result.voices == nullptr)
+        {
+            // Served by the refill that is (or is about to be) in flight
+            DBG("ThreadedInferenceEngine: Bank ring empty, queueing request for next refill");
+            waitingBankCallbacks.push_back(std::move(callback));
+        }
+    }
     
-    // Copy requests to local queue to minimize lock time
+    if (result.voices != nullptr)
     {
-        std::unique_lock<std::mutex> lock(requestMutex);
-        localQueue.swap(requestQueue);
+        result.callback = std::move(callback);
+        postResult(std::move(result));
     }
     
-    // Process all requests
-    while (!localQueue.empty() && !shouldStop.load())
+    // Top the ring back up once it runs low (or start the refill the queued click waits for)
+    if (bufferedBankCount.load() < bankLowWatermark)
     {
-        processInferenceRequest(localQueue.front());
-        localQueue.pop();
+        preGenerateRandomVoices();
     }
 }
 
-void ThreadedInferenceEngine::processInferenceRequest(const InferenceRequest& request)
+void ThreadedInferenceEngine::preGenerateRandomVoices()
 {
-    if (!modelLoaded.load())
+    bool expected = false;
+    if (isGeneratingBuffer.compare_exchange_strong(expected, true))
+    {
+        // Refill the ring for next time
+        InferenceRequest request;
+        request.type = InferenceRequest::REFILL_RANDOM_BANKS;
+        request.options.priority = InferencePriority::BANK_REFILL;
+        submitRequest(std::move(request));
+    }
+}
+
+void ThreadedInferenceEngine::refillRandomBanks(const std::shared_ptr<ModelVariant>& variant)
+{
+    int missingBanks = 0;
     {
-        std::cout << "ThreadedInferenceEngine: Model not loaded, skipping request" << std::endl;
+        std::unique_lock<std::mutex> lock(bufferMutex);
+        missingBanks = bankRingDepth - static_cast<int>(bufferedBanks.size())
+                     + static_cast<int>(waitingBankCallbacks.size());
+    }
+    
+    if (missingBanks <= 0)
+    {
+        isGeneratingBuffer.store(false);
         return;
     }
     
-    std::vector<DX7Voice> voices;
+    // Every missing bank comes out of one [K*32, 8] forward pass
+    const uint64_t firstBank = nextRandomBank.fetch_add(static_cast<uint64_t>(missingBanks));
+    DBG("ThreadedInferenceEngine: Refilling " << missingBanks << " random banks (" << firstBank
+        << " to " << firstBank + static_cast<uint64_t>(missingBanks) - 1 << ")");
+    auto voices = decodeRandomBanks(*variant, firstBank, missingBanks);
     
-    try
+    if (voices.size() != missingBanks * DX7VoiceBank::N_VOICES)
     {
-        switch (request.type)
+        // Clicks parked on the ring get a null bank rather than waiting for good
+        std::cerr << "ThreadedInferenceEngine: Random bank refill failed" << std::endl;
+        isGeneratingBuffer.store(false);
+        failWaitingBankCallbacks();
+        return;
+    }
+    
+    // The model was switched while this pass ran; refill from the new one instead
+    if (variant != getActiveVariant())
+    {
+        isGeneratingBuffer.store(false);
+        preGenerateRandomVoices();
+        return;
+    }
+    
+    std::vector<InferenceResult> served;
+    {
+        std::unique_lock<std::mutex> lock(bufferMutex);
+        
+        for (int bank = 0; bank < missingBanks; ++bank)
         {
-            case InferenceRequest::RANDOM_VOICES:
-            {
-                std::cout << "ThreadedInferenceEngine: Processing random voices request" << std::endl;
-                voices = neuralModel->generateMultipleRandomVoices();
-                
-                // Update buffer with new voices for next time
-                if (!voices.empty())
-                {
-                    std::unique_lock<std::mutex> lock(bufferMutex);
-                    bufferedRandomVoices = voices;
-                    hasBufferedVoices.store(true);
-                    isGeneratingBuffer.store(false);
-                }
-                break;
-            }
+            DX7VoiceBankHandle bankVoices = std::make_shared<const DX7VoiceBank>(voices.slice(bank * DX7VoiceBank::N_VOICES, DX7VoiceBank::N_VOICES));
             
-            case InferenceRequest::CUSTOM_VOICES:
+            const uint64_t bankIndex = firstBank + static_cast<uint64_t>(bank);
+            
+            // Clicks that arrived while the ring was empty are served first, in order
+            if (!waitingBankCallbacks.empty())
             {
-                std::cout << "ThreadedInferenceEngine: Processing custom voices request" << std::endl;
-                voices = neuralModel->generateVoices(request.latentVector);
-                break;
+                InferenceResult result;
+                result.callback = std::move(waitingBankCallbacks.front());
+                result.voices = std::move(bankVoices);
+                waitingBankCallbacks.pop_front();
+                served.push_back(std::move(result));
+                lastServedRandomBank.store(static_cast<int64_t>(bankIndex));
             }
-            
-            case InferenceRequest::SINGLE_CUSTOM_VOICE:
+            else if (static_cast<int>(bufferedBanks.size()) < bankRingDepth)
             {
-                std::cout << "ThreadedInferenceEngine: Processing single custom voice request" << std::endl;
-                voices = neuralModel->generateVoices(request.latentVector);
-                
-                // Call single voice callback with first voice (or nullopt if empty)
-                if (request.singleCallback)
-                {
-                    std::optional<DX7Voice> voiceOpt = voices.empty() ? std::nullopt : std::make_optional(voices[0]);
-                    juce::MessageManager::callAsync([callback = request.singleCallback, voiceOpt]() {
-                        callback(voiceOpt);
-                    });
-                }
-                return;
+                bufferedBanks.push_back({ bankIndex, std::move(bankVoices) });
             }
         }
         
-        // Call multi-voice callback on main thread
-        if (request.callback && !voices.empty())
-        {
-            juce::MessageManager::callAsync([callback = request.callback, voices]() {
-                callback(voices);
-            });
-        }
+        bufferedBankCount.store(static_cast<int>(bufferedBanks.size()));
+        isGeneratingBuffer.store(false);
     }
-    catch (const std::exception& e)
+    
+    DBG("ThreadedInferenceEngine: Bank ring depth now " << bufferedBankCount.load());
+    
+    for (auto& result : served)
     {
-        std::cerr << "ThreadedInferenceEngine: Error processing request: " << e.what() << std::endl;
+        postResult(std::move(result));
+    }
+    
+    // Clicks may have queued up while this pass was running
+    bool needsMore = false;
+    {
+        std::unique_lock<std::mutex> lock(bufferMutex);
+        needsMore = !waitingBankCallbacks.empty() || static_cast<int>(bufferedBanks.size()) < bankLowWatermark;
+    }
+    
+    if (needsMore)
+    {
+        preGenerateRandomVoices();
     }
 }
 
-void ThreadedInferenceEngine::requestRandomVoices(std::function<void(std::vector<DX7Voice>)> callback)
+bool ThreadedInferenceEngine::hasCachedVoice(const std::vector<float>& latentVector) const
 {
-    std::unique_lock<std::mutex> lock(requestMutex);
-    requestQueue.emplace(InferenceRequest::RANDOM_VOICES, callback);
-    requestCondition.notify_one();
+    const auto variant = getActiveVariant();
+    return variant != nullptr
+        && (variant->latentAtlas.lookup(latentVector.data(), latentVector.size()).has_value()
+            || variant->voiceCache.contains(VoiceCacheKey::fromLatent(latentVector)));
 }
 
-void ThreadedInferenceEngine::requestCustomVoices(const std::vector<float>& latentVector, std::function<void(std::vector<DX7Voice>)> callback)
+DX7VoiceHandle ThreadedInferenceEngine::getCachedVoice(const std::vector<float>& latentVector) const
 {
-    std::unique_lock<std::mutex> lock(requestMutex);
-    requestQueue.emplace(InferenceRequest::CUSTOM_VOICES, latentVector, callback);
-    requestCondition.notify_one();
+    const auto variant = getActiveVariant();
+    if (variant == nullptr)
+    {
+        return nullptr;
+    }
+    
+    if (auto voice = variant->latentAtlas.lookup(latentVector.data(), latentVector.size()))
+    {
+        return std::make_shared<const DX7Voice>(std::move(*voice));
+    }
+    
+    return variant->voiceCache.lookup(VoiceCacheKey::fromLatent(latentVector));
 }
 
-void ThreadedInferenceEngine::requestSingleCustomVoice(const std::vector<float>& latentVector, std::function<void(std::optional<DX7Voice>)> callback)
+VoiceCache::Stats ThreadedInferenceEngine::getCacheStats() const
 {
-    std::unique_lock<std::mutex> lock(requestMutex);
-    requestQueue.emplace(InferenceRequest::SINGLE_CUSTOM_VOICE, latentVector, callback);
-    requestCondition.notify_one();
+    const auto variant = getActiveVariant();
+    return variant != nullptr ? variant->voiceCache.getStats() : VoiceCache::Stats();
 }
 
-bool ThreadedInferenceEngine::hasBufferedRandomVoices() const
+void ThreadedInferenceEngine::requestCachedCustomVoice(const std::vector<float>& latentVector, std::function<void(DX7VoiceHandle)> callback,
+                                                       const InferenceRequestOptions& options)
 {
-    return hasBufferedVoices.load();
+    if (latentVector.size() != NeuralModelWrapper::LATENT_DIM)
+    {
+        std::cerr << "ThreadedInferenceEngine: Single voice request needs " << NeuralModelWrapper::LATENT_DIM << " latent values" << std::endl;
+        failSingleVoice(std::move(callback));
+        return;
+    }
+    
+    const auto variant = getActiveVariant();
+    if (variant == nullptr)
+    {
+        // Nothing loaded yet, so nothing cached; runs once the model is up
+        InferenceRequest request(InferenceRequest::SINGLE_CUSTOM_VOICE, latentVector, std::move(callback));
+        request.options = options;
+        submitRequest(std::move(request));
+        return;
+    }
+    
+    // Lattice points are answered straight from the atlas
+    DX7VoiceHandle cachedVoice;
+    if (auto atlasVoice = variant->latentAtlas.lookup(latentVector.data(), latentVector.size()))
+    {
+        cachedVoice = std::make_shared<const DX7Voice>(std::move(*atlasVoice));
+    }
+    VoiceCache::LookupResult lookup = VoiceCache::LookupResult::HIT;
+    const auto key = VoiceCacheKey::fromLatent(latentVector);
+    
+    // Otherwise one lookup: either a hit (a shared handle, nothing copied), or the
+    // key is reserved for the request below
+    if (cachedVoice == nullptr)
+    {
+        lookup = variant->voiceCache.lookupOrReserve(key, cachedVoice);
+    }
+    
+    if (lookup == VoiceCache::LookupResult::HIT
+        || (lookup == VoiceCache::LookupResult::RESERVED && fillFromPersistentCache(*variant, key, cachedVoice)))
+    {
+        DBG("ThreadedInferenceEngine: Cache hit for custom voice");
+        InferenceResult result;
+        result.singleCallback = std::move(callback);
+        result.voice = std::move(cachedVoice);
+        postResult(std::move(result));
+        return;
+    }
+    
+    // Not in cache (or still being pre-generated), generate and let the worker cache it.
+    // Only the request that owns the reservation may release it if dropped.
+    InferenceRequest request(InferenceRequest::SINGLE_CUSTOM_VOICE, latentVector, std::move(callback));
+    request.cacheResult = lookup == VoiceCache::LookupResult::RESERVED;
+    request.options = options;
+    request.variant = variant;
+    submitRequest(std::move(request));
 }
 
-std::vector<DX7Voice> ThreadedInferenceEngine::getBufferedRandomVoices()
+void ThreadedInferenceEngine::preGenerateCustomVoice(const std::vector<float>& latentVector, uint32_t coalescingKey)
 {
-    std::unique_lock<std::mutex> lock(bufferMutex);
-    if (hasBufferedVoices.load())
+    if (latentVector.size() != NeuralModelWrapper::LATENT_DIM)
     {
-        auto voices = bufferedRandomVoices;
-        hasBufferedVoices.store(false);
-        
-        // Trigger generation of new buffer
-        preGenerateRandomVoices();
-        
-        return voices;
+        return;
+    }
+    
+    const auto variant = getActiveVariant();
+    if (variant == nullptr)
+    {
+        return;
+    }
+    
+    // Only generate if not already in the atlas, cached (in memory or on disk) or being generated
+    const auto key = VoiceCacheKey::fromLatent(latentVector);
+    DX7VoiceHandle cachedVoice;
+    if (variant->latentAtlas.lookup(latentVector.data(), latentVector.size()).has_value()
+        || variant->voiceCache.lookupOrReserve(key, cachedVoice) != VoiceCache::LookupResult::RESERVED
+        || fillFromPersistentCache(*variant, key, cachedVoice))
+    {
+        return;
     }
     
-    return {};
+    // Latest slider position wins: a newer pre-generation supersedes any still queued.
+    // The worker caches the result itself, so there is nothing to call back.
+    InferenceRequest request(InferenceRequest::SINGLE_CUSTOM_VOICE, latentVector, std::function<void(DX7VoiceHandle)>());
+    request.cacheResult = true;
+    request.options.priority = InferencePriority::SPECULATIVE;
+    request.options.coalescingKey = coalescingKey;
+    request.variant = variant;
+    
+    DBG("ThreadedInferenceEngine: Pre-generating custom voice for cache");
+    submitRequest(std::move(request));
 }
 
-void ThreadedInferenceEngine::preGenerateRandomVoices()
+void ThreadedInferenceEngine::prefetchCustomVoices(const std::vector<float>& latents, uint32_t coalescingKey)
 {
-    if (!isGeneratingBuffer.load())
+    constexpr size_t dim = NeuralModelWrapper::LATENT_DIM;
+    
+    const auto variant = getActiveVariant();
+    if (variant == nullptr)
+    {
+        return;
+    }
+    
+    // Reserve every point that isn't cached yet; duplicates within the batch
+    // come back PENDING and are skipped, so each voice is generated once
+    std::vector<float> missing;
+    missing.reserve(latents.size());
+    
+    for (size_t offset = 0; offset + dim <= latents.size(); offset += dim)
     {
-        isGeneratingBuffer.store(true);
+        const auto key = VoiceCacheKey::fromLatent(latents.data() + offset, dim);
+        DX7VoiceHandle cachedVoice;
         
-        // Request new random voices for the buffer
-        requestRandomVoices([this](std::vector<DX7Voice> voices) {
-            // Callback is handled in processInferenceRequest
-            std::cout << "ThreadedInferenceEngine: Buffer regenerated with " << voices.size() << " voices" << std::endl;
-        });
+        if (!variant->latentAtlas.lookup(latents.data() + offset, dim).has_value()
+            && variant->voiceCache.lookupOrReserve(key, cachedVoice) == VoiceCache::LookupResult::RESERVED
+            && !fillFromPersistentCache(*variant, key, cachedVoice))
+        {
+            missing.insert(missing.end(), latents.begin() + offset, latents.begin() + offset + dim);
+        }
+    }
+    
+    if (missing.empty())
+    {
+        return;
     }
+    
+    InferenceRequest request(InferenceRequest::PREFETCH_VOICES, missing, std::function<void(DX7VoiceBankHandle)>());
+    request.cacheResult = true;
+    request.options.priority = InferencePriority::SPECULATIVE;
+    request.options.coalescingKey = coalescingKey;
+    request.variant = variant;
+    
+    DBG("ThreadedInferenceEngine: Prefetching " << missing.size() / dim << " of " << latents.size() / dim << " latents");
+    submitRequest(std::move(request));
 }
 
-std::string ThreadedInferenceEngine::latentVectorToKey(const std::vector<float>& latentVector) const
+bool ThreadedInferenceEngine::fillFromPersistentCache(ModelVariant& variant, const VoiceCacheKey& key, DX7VoiceHandle& voice)
 {
-    std::string key;
-    key.reserve(latentVector.size() * 8); // Rough estimate for string size
+    // Called with the key reserved in the variant's cache; a disk hit fulfils the reservation
+    auto stored = variant.persistentCache.lookup(key);
     
-    for (float value : latentVector)
+    if (!stored.has_value())
     {
-        // Round to 3 decimal places to create reasonable cache keys
-        int rounded = static_cast<int>(value * 1000.0f);
-        key += std::to_string(rounded) + ",";
+        return false;
     }
     
-    return key;
+    DBG("ThreadedInferenceEngine: Persistent cache hit for custom voice");
+    voice = std::make_shared<const DX7Voice>(std::move(*stored));
+    variant.voiceCache.insert(key, voice);
+    return true;
+}
+
+bool ThreadedInferenceEngine::isModelLoaded() const
+{
+    return modelLoaded.load();
 }
 
-void ThreadedInferenceEngine::addToCache(const std::vector<float>& latentVector, const DX7Voice& voice)
+juce::File ThreadedInferenceEngine::partitionFile(const juce::File& file, uint64_t hash)
 {
-    std::unique_lock<std::mutex> lock(cacheMutex);
+    return file.getSiblingFile(file.getFileNameWithoutExtension() + "_" + juce::String::toHexString(static_cast<juce::int64>(hash))
+                               + file.getFileExtension());
+}
+
+std::shared_ptr<ThreadedInferenceEngine::ModelVariant> ThreadedInferenceEngine::createVariant(std::shared_ptr<NeuralModelWrapper> model,
+                                                                                              uint64_t hash, bool isStartupModel)
+{
+    auto variant = std::make_shared<ModelVariant>(engineConfig);
+    variant->hash = hash;
+    variant->model = std::move(model);
     
-    std::string key = latentVectorToKey(latentVector);
+    // Every model gets its own on-disk partition, so switching back and forth never
+    // discards one model's cache for another's. The voice cache names every file
+    // by model hash; the atlas keeps the original file name for the startup model.
+    if (usePersistentCache)
+    {
+        variant->persistentCache.open(PersistentVoiceCache::getFileForModel(persistentCacheFile, hash),
+                                      hash, persistentCacheMaxBytes);
+    }
     
-    // If cache is full, evict oldest entry
-    if (voiceCache.size() >= MAX_CACHE_SIZE)
+    if (useLatentAtlas)
     {
-        evictOldestFromCache();
+        variant->latentAtlas.open(isStartupModel ? latentAtlasFile : partitionFile(latentAtlasFile, hash),
+                                  hash, latentAtlasSettings);
     }
     
-    // Add new entry
-    voiceCache.emplace(key, voice);
-    cacheOrder.push(key);
+    return variant;
+}
+
+void ThreadedInferenceEngine::activateVariant(std::shared_ptr<ModelVariant> variant)
+{
+    // From here on new requests go to the new model; anything already submitted
+    // holds its own reference to the old one and finishes there
+    std::atomic_store(&activeVariant, variant);
+    
+    std::cout << "ThreadedInferenceEngine: Switched to model " << juce::String::toHexString(static_cast<juce::int64>(variant->hash)) << std::endl;
+    
+    // Buffered banks came from the previous model
+    {
+        std::unique_lock<std::mutex> lock(bufferMutex);
+        bufferedBanks.clear();
+        bufferedBankCount.store(0);
+    }
     
-    std::cout << "ThreadedInferenceEngine: Added voice to cache (size: " << voiceCache.size() << ")" << std::endl;
+    preGenerateRandomVoices();
+    scheduleAtlasChunk(variant);
 }
 
-void ThreadedInferenceEngine::evictOldestFromCache()
+void ThreadedInferenceEngine::loadModelVariant(const juce::File& modelFile, bool activate, std::function<void(uint64_t)> callback)
 {
-    if (!cacheOrder.empty())
+    // Loading and warming up takes a while, so it runs on a worker like any other request
+    InferenceRequest request;
+    request.type = InferenceRequest::LOAD_MODEL_VARIANT;
+    request.modelFile = modelFile;
+    request.activateModel = activate;
+    request.modelCallback = std::move(callback);
+    request.options.priority = InferencePriority::BANK_REFILL;
+    submitRequest(std::move(request));
+}
+
+void ThreadedInferenceEngine::loadVariantFromFile(InferenceRequest& request)
+{
+    uint64_t hash = 0;
+    
+    if (useInferenceHost.load())
+    {
+        std::cerr << "ThreadedInferenceEngine: Model variants need the in-process engine" << std::endl;
+    }
+    else
+    {
+        auto model = std::make_shared<NeuralModelWrapper>();
+        configureModel(*model);
+        
+        if (model->loadModelFromFile(request.modelFile))
+        {
+            hash = model->getModelHash();
+            std::shared_ptr<ModelVariant> variant;
+            
+            {
+                std::lock_guard<std::mutex> lock(variantsMutex);
+                for (const auto& loaded : loadedVariants)
+                {
+                    if (loaded->hash == hash)
+                    {
+                        variant = loaded; // Same checkpoint again, keep its warm caches
+                    }
+                }
+                
+                if (variant == nullptr)
+                {
+                    variant = createVariant(std::move(model), hash, false);
+                    loadedVariants.push_back(variant);
+                }
+            }
+            
+            std::cout << "ThreadedInferenceEngine: Loaded model variant " << juce::String::toHexString(static_cast<juce::int64>(hash))
+                      << " from " << request.modelFile.getFullPathName() << std::endl;
+            
+            if (request.activateModel)
+            {
+                activateVariant(variant);
+            }
+        }
+        else
+        {
+            std::cerr << "ThreadedInferenceEngine: Failed to load model variant " << request.modelFile.getFullPathName() << std::endl;
+        }
+    }
+    
+    if (request.modelCallback)
     {
-        std::string oldestKey = cacheOrder.front();
-        cacheOrder.pop();
-        voiceCache.erase(oldestKey);
-        std::cout << "ThreadedInferenceEngine: Evicted oldest cache entry" << std::endl;
+        InferenceResult result;
+        result.modelCallback = std::move(request.modelCallback);
+        result.modelHash = hash;
+        postResult(std::move(result));
     }
 }
 
-bool ThreadedInferenceEngine::hasCachedVoice(const std::vector<float>& latentVector) const
+bool ThreadedInferenceEngine::switchToModel(uint64_t modelHash)
 {
-    std::unique_lock<std::mutex> lock(cacheMutex);
-    std::string key = latentVectorToKey(latentVector);
-    return voiceCache.find(key) != voiceCache.end();
+    std::shared_ptr<ModelVariant> variant;
+    {
+        std::lock_guard<std::mutex> lock(variantsMutex);
+        for (const auto& loaded : loadedVariants)
+        {
+            if (loaded->hash == modelHash)
+            {
+                variant = loaded;
+            }
+        }
+    }
+    
+    if (variant == nullptr)
+    {
+        return false;
+    }
+    
+    if (variant != getActiveVariant())
+    {
+        activateVariant(variant);
+    }
+    return true;
 }
 
-std::optional<DX7Voice> ThreadedInferenceEngine::getCachedVoice(const std::vector<float>& latentVector) const
+bool ThreadedInferenceEngine::unloadModelVariant(uint64_t modelHash)
 {
-    std::unique_lock<std::mutex> lock(cacheMutex);
-    std::string key = latentVectorToKey(latentVector);
-    auto it = voiceCache.find(key);
+    const auto active = getActiveVariant();
+    std::lock_guard<std::mutex> lock(variantsMutex);
+    
+    const auto it = std::find_if(loadedVariants.begin(), loadedVariants.end(), [modelHash](const auto& loaded) {
+        return loaded->hash == modelHash;
+    });
     
-    if (it != voiceCache.end())
+    if (it == loadedVariants.end() || *it == active)
     {
-        std::cout << "ThreadedInferenceEngine: Cache hit for custom voice" << std::endl;
-        return it->second;
+        return false;
     }
     
-    std::cout << "ThreadedInferenceEngine: Voice not found in cache, returning null" << std::endl;
-    return std::nullopt;
+    // Requests still holding it keep it alive until they finish
+    loadedVariants.erase(it);
+    return true;
 }
 
-void ThreadedInferenceEngine::requestCachedCustomVoice(const std::vector<float>& latentVector, std::function<void(std::optional<DX7Voice>)> callback)
+uint64_t ThreadedInferenceEngine::getActiveModelHash() const
 {
-    // Check cache first
-    if (hasCachedVoice(latentVector))
+    const auto variant = getActiveVariant();
+    return variant != nullptr ? variant->hash : 0;
+}
+
+std::vector<uint64_t> ThreadedInferenceEngine::getLoadedModelHashes() const
+{
+    std::lock_guard<std::mutex> lock(variantsMutex);
+    std::vector<uint64_t> hashes;
+    for (const auto& loaded : loadedVariants)
+    {
+        hashes.push_back(loaded->hash);
+    }
+    return hashes;
+}
+
+void ThreadedInferenceEngine::scheduleAtlasChunk(const std::shared_ptr<ModelVariant>& variant)
+{
+    if (variant == nullptr || !variant->latentAtlas.isOpen() || variant->latentAtlas.isComplete() || shouldStop.load()
+        || variant->atlasChunkQueued.exchange(true))
     {
-        std::optional<DX7Voice> cachedVoice = getCachedVoice(latentVector);
-        juce::MessageManager::callAsync([callback, cachedVoice]() {
-            callback(cachedVoice);
-        });
         return;
     }
     
-    // Not in cache, generate and cache
-    requestSingleCustomVoice(latentVector, [this, latentVector, callback](std::optional<DX7Voice> voiceOpt) {
-        // Add to cache if voice was generated successfully
-        if (voiceOpt.has_value())
-        {
-            addToCache(latentVector, voiceOpt.value());
-        }
-        
-        // Call original callback
-        callback(voiceOpt);
-    });
+    // One chunk in flight at a time, behind everything interactive
+    InferenceRequest request;
+    request.type = InferenceRequest::BUILD_ATLAS_CHUNK;
+    request.options.priority = InferencePriority::SPECULATIVE;
+    request.variant = variant;
+    submitRequest(std::move(request));
 }
 
-void ThreadedInferenceEngine::preGenerateCustomVoice(const std::vector<float>& latentVector)
+void ThreadedInferenceEngine::buildAtlasChunk(const std::shared_ptr<ModelVariant>& variant)
 {
-    // Only generate if not already cached
-    if (hasCachedVoice(latentVector))
+    variant->atlasChunkQueued.store(false);
+    
+    auto& latentAtlas = variant->latentAtlas;
+    const uint64_t first = latentAtlas.getNumDecoded();
+    
+    std::vector<float> latents;
+    latentAtlas.getLatticeLatents(first, latentAtlasChunkSize, latents);
+    
+    if (latents.empty())
     {
         return;
     }
     
-    std::unique_lock<std::mutex> lock(scheduleMutex);
+    const auto voices = decodeVoices(*variant, latents);
+    if (static_cast<size_t>(voices.size()) != latents.size() / NeuralModelWrapper::LATENT_DIM)
+    {
+        std::cerr << "ThreadedInferenceEngine: Latent atlas chunk failed, stopping atlas build" << std::endl;
+        return;
+    }
     
-    // If no request is currently inflight, start one immediately
-    if (!isPreGenerating.load())
+    // Losing a chunk to another process moves the decoded count on. If it didn't
+    // move, the write failed or the file is no longer ours, and retrying would
+    // only decode the same chunk again.
+    if (!latentAtlas.appendVoices(first, voices) && latentAtlas.getNumDecoded() == first)
     {
-        isPreGenerating.store(true);
-        lock.unlock(); // Release lock before making request
-        
-        std::cout << "ThreadedInferenceEngine: Pre-generating custom voice for cache" << std::endl;
-        requestSingleCustomVoice(latentVector, [this, latentVector](std::optional<DX7Voice> voiceOpt) {
-            // Add to cache for future use if voice was generated
-            if (voiceOpt.has_value())
-            {
-                addToCache(latentVector, voiceOpt.value());
-            }
-            
-            // Check if there's a scheduled request to process
-            std::unique_lock<std::mutex> scheduleLock(scheduleMutex);
-            if (scheduledRequest.has_value())
-            {
-                auto nextRequest = std::move(scheduledRequest.value());
-                scheduledRequest.reset();
-                scheduleLock.unlock();
-                
-                std::cout << "ThreadedInferenceEngine: Processing scheduled request" << std::endl;
-                // Process the scheduled request
-                requestSingleCustomVoice(nextRequest.latentVector, [this, nextRequest](std::optional<DX7Voice> scheduledVoiceOpt) {
-                    if (scheduledVoiceOpt.has_value())
-                    {
-                        addToCache(nextRequest.latentVector, scheduledVoiceOpt.value());
-                    }
-                    isPreGenerating.store(false); // Allow new pre-generation requests
-                    std::cout << "ThreadedInferenceEngine: Scheduled request completed" << std::endl;
-                });
-            }
-            else
-            {
-                isPreGenerating.store(false); // Allow new pre-generation requests
-                std::cout << "ThreadedInferenceEngine: Pre-generated voice cached" << std::endl;
-            }
-        });
+        std::cerr << "ThreadedInferenceEngine: Can't write latent atlas chunk, stopping atlas build" << std::endl;
+        return;
     }
-    else
+    
+    // Log roughly every 10% rather than every chunk
+    const uint64_t decoded = latentAtlas.getNumDecoded();
+    const uint64_t step = juce::jmax<uint64_t>(1, latentAtlas.getNumPoints() / 10);
+    if (decoded / step != first / step || decoded == latentAtlas.getNumPoints())
     {
-        // Request is inflight, schedule this one (overwriting any previous scheduled request)
-        if (scheduledRequest.has_value()) {
-            std::cout << "ThreadedInferenceEngine: Overwriting previously scheduled request" << std::endl;
-        } else {
-            std::cout << "ThreadedInferenceEngine: Scheduling request to run after current completes" << std::endl;
-        }
-        scheduledRequest = InferenceRequest(InferenceRequest::SINGLE_CUSTOM_VOICE, latentVector, [](std::optional<DX7Voice>){});
+        std::cout << "ThreadedInferenceEngine: Latent atlas " << juce::roundToInt(100.0 * static_cast<double>(decoded) / static_cast<double>(latentAtlas.getNumPoints()))
+                  << "% built" << std::endl;
+    }
+    
+    // Only the active model's atlas keeps building; a switch back resumes it
+    if (variant == getActiveVariant())
+    {
+        scheduleAtlasChunk(variant);
     }
 }
 
-bool ThreadedInferenceEngine::isModelLoaded() const
+double ThreadedInferenceEngine::getLatentAtlasProgress() const
 {
-    return modelLoaded.load();
-}
\ No newline at end of file
+    const auto variant = getActiveVariant();
+    if (variant == nullptr)
+    {
+        return 0.0;
+    }
+    
+    const uint64_t total = variant->latentAtlas.getNumPoints();
+    return total > 0 ? static_cast<double>(variant->latentAtlas.getNumDecoded()) / static_cast<double>(total) : 0.0;
+}
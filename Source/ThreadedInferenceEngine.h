@@ -5,101 +5,460 @@
 #include <atomic>
 #include <memory>
 #include <vector>
-#include <queue>
-#include <condition_variable>
 #include <mutex>
-#include <unordered_map>
 #include <string>
+#include <deque>
 #include <chrono>
-#include <optional>
+#include <array>
+#include <functional>
+#include <algorithm>
 #include "NeuralModelWrapper.h"
 #include "DX7Voice.h"
+#include "DX7VoiceBank.h"
+#include "LockFreeRing.h"
+#include "VoiceCache.h"
+#include "PersistentVoiceCache.h"
+#include "LatentAtlas.h"
+#include "LatentSampler.h"
+#include "InferenceHostClient.h"
 
-class ThreadedInferenceEngine : public juce::Thread
+// Scheduling class of a request. Workers always drain higher classes first, so a
+// click never waits behind speculative work that hasn't started yet.
+enum class InferencePriority
 {
+    INTERACTIVE = 0, // User clicked Generate / Randomise
+    BANK_REFILL,     // Keeping the random voice buffer topped up
+    SPECULATIVE      // Slider pre-generation that may never be used
+};
+
+// Lets a caller drop a request that hasn't reached the model yet.
+// A default-constructed token can never be cancelled and costs nothing.
+class CancellationToken
+{
+public:
+    static CancellationToken create() { return CancellationToken(std::make_shared<std::atomic<bool>>(false)); }
+    
+    CancellationToken() = default;
+    
+    void cancel() const { if (flag) flag->store(true); }
+    bool isCancelled() const { return flag && flag->load(); }
+    
+private:
+    explicit CancellationToken(std::shared_ptr<std::atomic<bool>> f) : flag(std::move(f)) {}
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+struct InferenceRequestOptions
+{
+    InferencePriority priority = InferencePriority::INTERACTIVE;
+    
+    // Requests sharing a non-zero key supersede each other: only the newest one
+    // queued under a key is run, older ones are dropped without a callback.
+    uint32_t coalescingKey = 0;
+    
+    CancellationToken cancellation;
+};
+
+struct InferenceEngineConfig
+{
+    int numWorkers = 0;              // 0 = derive from the number of cores
+    int intraOpThreadsPerWorker = 0; // 0 = split the cores evenly between workers
+    
+    // Single-voice requests arriving within this window are run as one [N,8] batch
+    double microBatchWindowMs = 2.0;
+    int maxMicroBatchSize = 16;
+    
+    // Preallocated slots per worker and priority; submissions spill to the next
+    // worker when a ring is full, and fail with a null result when every one is
+    int singleVoiceRingCapacity = 64;
+    int batchRingCapacity = 16;
+    int completionRingCapacity = 256;
+    
+    // Generated single voices are kept in a sharded LRU cache of this size
+    size_t voiceCacheBytes = 2 * 1024 * 1024;
+    int voiceCacheShards = 16;
+    
+    // Optional on-disk cache shared across sessions; an empty file means the default location.
+    // Each model's cache sits next to it, named by model hash (PersistentVoiceCache::getFileForModel).
+    bool usePersistentVoiceCache = true;
+    juce::File persistentVoiceCacheFile;
+    size_t persistentVoiceCacheMaxBytes = 64 * 1024 * 1024;
+    
+    // Ring of pre-generated 32-voice random banks. When the depth drops below the
+    // low watermark every missing bank is refilled in one forward pass.
+    int randomBankRingDepth = 4;
+    int randomBankLowWatermark = 2;
+    
+    // Bank b of a session is decoded from LatentSampler latents (randomSeed, b), so
+    // any bank can be rebuilt later with requestRandomBank. 0 = a new seed per session.
+    uint64_t randomSeed = 0;
+    LatentSampler::Mode randomLatentMode = LatentSampler::Mode::NORMAL;
+    
+    // Precomputed lattice of voices, decoded in the background a chunk at a time
+    // at SPECULATIVE priority. Latents on (or within snapRadius of) a decoded
+    // lattice point are answered from it without inference. Off by default: the
+    // default lattice is 390,625 decodes (about 60 MB) per model, and with a zero
+    // snapRadius slider positions almost never land exactly on a point.
+    bool useLatentAtlas = false;
+    juce::File latentAtlasFile;
+    LatentAtlas::Settings latentAtlasSettings;
+    int latentAtlasChunkSize = 256;
+    
+    // Int8 decoding (needs a build with the native decoder embedded). Refused at load
+    // unless every parameter's argmax agrees with fp32 on at least int8MinAgreement
+    // of NeuralModelWrapper::INT8_CHECK_LATENTS fixed latents.
+    bool useInt8Inference = false;
+    double int8MinAgreement = NeuralModelWrapper::DEFAULT_INT8_MIN_AGREEMENT;
+    
+    // Run the model in the NeuralDX7InferenceHost helper instead of the DAW process
+    // (macOS/Linux). One host serves every plugin instance of the user. If it can't
+    // be reached at startup, the engine loads the model in-process as usual.
+    bool useInferenceHost = false;
+    std::string inferenceHostSocket;    // Empty = InferenceHostClient::getDefaultSocketPath()
+    juce::File inferenceHostExecutable; // Empty = InferenceHostClient::findHostExecutable()
+    
+    // Nothing is loaded until ensureStarted(), so a host scanning or restoring the
+    // plugin doesn't pay for the model. Optionally the model is loaded anyway by a
+    // background-priority thread once the engine has existed for the warm-up delay;
+    // a plugin scan destroys the instance long before that.
+    bool warmUpInBackground = true;
+    int backgroundWarmUpDelayMs = 3000;
+};
+
+// Milliseconds since the engine was constructed; negative until the stage is reached
+struct InferenceEngineStartupTimings
+{
+    double startRequestedMs = -1.0; // First ensureStarted()
+    double loadStartedMs = -1.0;    // Model load began (worker or warm-up thread)
+    double readyMs = -1.0;          // Model loaded and serving
+};
+
+class ThreadedInferenceEngine : private juce::AsyncUpdater
+{
+    struct ModelVariant;
+    
 public:
     struct InferenceRequest
     {
-        enum Type { RANDOM_VOICES, CUSTOM_VOICES, SINGLE_CUSTOM_VOICE };
-        Type type;
-        std::vector<float> latentVector;
-        std::function<void(std::vector<DX7Voice>)> callback;
-        std::function<void(std::optional<DX7Voice>)> singleCallback;
+        enum Type { RANDOM_VOICES, CUSTOM_VOICES, SINGLE_CUSTOM_VOICE, REFILL_RANDOM_BANKS, PREFETCH_VOICES, BUILD_ATLAS_CHUNK, LOAD_MODEL_VARIANT };
+        Type type = RANDOM_VOICES;
+        std::array<float, NeuralModelWrapper::LATENT_DIM> latent{}; // SINGLE_CUSTOM_VOICE, stored inline
+        std::vector<float> latentVector;                            // CUSTOM_VOICES and PREFETCH_VOICES batches
+        std::function<void(DX7VoiceBankHandle)> callback;
+        std::function<void(DX7VoiceHandle)> singleCallback;
+        InferenceRequestOptions options;
+        uint64_t coalescingGeneration = 0;
+        bool cacheResult = false; // Worker adds the generated voice(s) to the variant's voice cache itself
+        
+        // Model (and cache partition) the request runs on, pinned when it was
+        // submitted so a model switch never strands a cache reservation
+        std::shared_ptr<ModelVariant> variant;
+        
+        juce::File modelFile;                         // LOAD_MODEL_VARIANT
+        std::function<void(uint64_t)> modelCallback;  // LOAD_MODEL_VARIANT
+        bool activateModel = false;                   // LOAD_MODEL_VARIANT
         
-        InferenceRequest(Type t, std::function<void(std::vector<DX7Voice>)> cb)
-            : type(t), callback(cb) {}
+        InferenceRequest() = default;
+        
+        InferenceRequest(Type t, std::function<void(DX7VoiceBankHandle)> cb)
+            : type(t), callback(std::move(cb)) {}
             
-        InferenceRequest(Type t, const std::vector<float>& latent, std::function<void(std::vector<DX7Voice>)> cb)
-            : type(t), latentVector(latent), callback(cb) {}
+        InferenceRequest(Type t, const std::vector<float>& latent, std::function<void(DX7VoiceBankHandle)> cb)
+            : type(t), latentVector(latent), callback(std::move(cb)) {}
             
-        InferenceRequest(Type t, const std::vector<float>& latent, std::function<void(std::optional<DX7Voice>)> cb)
-            : type(t), latentVector(latent), singleCallback(cb) {}
+        InferenceRequest(Type t, const std::vector<float>& latentValues, std::function<void(DX7VoiceHandle)> cb)
+            : type(t), singleCallback(std::move(cb))
+        {
+            std::copy_n(latentValues.begin(), std::min(latentValues.size(), latent.size()), latent.begin());
+        }
     };
     
-    ThreadedInferenceEngine();
-    ~ThreadedInferenceEngine() override;
+    explicit ThreadedInferenceEngine(const InferenceEngineConfig& config = {});
+    ~ThreadedInferenceEngine();
     
-    // Thread management
+    // Thread management. stopInferenceThread() waits, without a timeout, for each
+    // worker to finish its current forward pass and for a model load already under
+    // way, which can take seconds; threads inside libtorch are never killed.
+    // signalStop() only asks them to stop and returns at once.
     void startInferenceThread();
     void stopInferenceThread();
+    void signalStop();
+    int getNumWorkers() const { return numWorkers; }
+    
+    // Starts the workers (and with them model loading) the first time it is called.
+    // Requests submitted before then simply wait in the rings.
+    void ensureStarted();
+    bool isStarted() const { return started.load(); }
+    InferenceEngineStartupTimings getStartupTimings() const;
     
-    // Request inference
-    void requestRandomVoices(std::function<void(std::vector<DX7Voice>)> callback);
-    void requestCustomVoices(const std::vector<float>& latentVector, std::function<void(std::vector<DX7Voice>)> callback);
-    void requestSingleCustomVoice(const std::vector<float>& latentVector, std::function<void(std::optional<DX7Voice>)> callback);
+    // Coalescing keys are small integers; these are reserved by the engine itself
+    static constexpr uint32_t MAX_COALESCING_KEYS = 64;
+    static constexpr uint32_t PREFETCH_COALESCING_KEY = 1;
     
-    // Double buffer management
+    // Keys from FIRST_CLIENT_COALESCING_KEY up are leased to clients sharing the
+    // engine, so one client's speculative work only ever supersedes its own.
+    // Falls back to PREFETCH_COALESCING_KEY once every key is leased.
+    static constexpr uint32_t FIRST_CLIENT_COALESCING_KEY = 2;
+    uint32_t acquireCoalescingKey();
+    void releaseCoalescingKey(uint32_t key);
+    
+    // Request inference. Callbacks run on the message thread; a request that was
+    // rejected (e.g. a latent of the wrong size) or accepted but couldn't be run
+    // gets a null handle. Only superseded and cancelled requests are dropped
+    // without a callback.
+    void requestRandomVoices(std::function<void(DX7VoiceBankHandle)> callback,
+                             const InferenceRequestOptions& options = {});
+    void requestCustomVoices(const std::vector<float>& latentVector, std::function<void(DX7VoiceBankHandle)> callback,
+                             const InferenceRequestOptions& options = {});
+    void requestSingleCustomVoice(const std::vector<float>& latentVector, std::function<void(DX7VoiceHandle)> callback,
+                                  const InferenceRequestOptions& options = {});
+    
+    // Random bank ring management
     bool hasBufferedRandomVoices() const;
-    std::vector<DX7Voice> getBufferedRandomVoices();
+    int getBufferedBankCount() const;
+    DX7VoiceBankHandle getBufferedRandomVoices();
     void preGenerateRandomVoices();
     
+    // Hands out the next buffered bank, or the next one generated if the ring is
+    // empty, so a click is never dropped. The callback runs on the message thread.
+    void requestBufferedRandomVoices(std::function<void(DX7VoiceBankHandle)> callback);
+    
+    // Random banks are numbered within the session's seed; the pair identifies a
+    // bank for good (given the same model and latent mode)
+    uint64_t getRandomSeed() const { return randomSeed; }
+    int64_t getLastServedRandomBank() const { return lastServedRandomBank.load(); } // -1 before the first
+    void requestRandomBank(uint64_t seed, uint64_t bankIndex, std::function<void(DX7VoiceBankHandle)> callback,
+                           const InferenceRequestOptions& options = {});
+    
     // Custom voice caching
     bool hasCachedVoice(const std::vector<float>& latentVector) const;
-    std::optional<DX7Voice> getCachedVoice(const std::vector<float>& latentVector) const;
-    void requestCachedCustomVoice(const std::vector<float>& latentVector, std::function<void(std::optional<DX7Voice>)> callback);
-    void preGenerateCustomVoice(const std::vector<float>& latentVector); // For debounced pre-generation
+    DX7VoiceHandle getCachedVoice(const std::vector<float>& latentVector) const;
+    void requestCachedCustomVoice(const std::vector<float>& latentVector, std::function<void(DX7VoiceHandle)> callback,
+                                  const InferenceRequestOptions& options = {});
+    void preGenerateCustomVoice(const std::vector<float>& latentVector, uint32_t coalescingKey = PREFETCH_COALESCING_KEY);
+    
+    // Speculatively generates a flattened batch of latents (e.g. a prefetch
+    // neighbourhood) into the cache in one forward pass. Points already cached
+    // or in flight are skipped; a newer prefetch supersedes one still queued.
+    void prefetchCustomVoices(const std::vector<float>& latents, uint32_t coalescingKey = PREFETCH_COALESCING_KEY); // For debounced pre-generation
+    VoiceCache::Stats getCacheStats() const;
+    double getLatentAtlasProgress() const;
+    
+    // Model variants, for comparing checkpoints without restarting the engine.
+    // Loading runs on a worker; the callback gets the variant's model hash, or 0
+    // on failure, on the message thread. Switching is an atomic pointer swap:
+    // requests already queued or running finish on the model they were submitted
+    // to, and every variant has its own voice cache, disk cache and atlas.
+    void loadModelVariant(const juce::File& modelFile, bool activate, std::function<void(uint64_t)> callback);
+    bool switchToModel(uint64_t modelHash);
+    bool unloadModelVariant(uint64_t modelHash); // Not the active one
+    uint64_t getActiveModelHash() const;
+    std::vector<uint64_t> getLoadedModelHashes() const;
     
     // Thread safety
     bool isModelLoaded() const;
     
 private:
-    void run() override;
-    void processInferenceRequests();
-    void processInferenceRequest(const InferenceRequest& request);
+    static constexpr int NUM_PRIORITIES = 3;
+    static constexpr int MAX_WORKERS = 32; // One bit each in the wakeup masks
+    
+    // A finished request on its way back to the message thread. Voices travel as
+    // shared handles that are moved from the worker to the callback, never copied.
+    struct InferenceResult
+    {
+        std::function<void(DX7VoiceBankHandle)> callback;
+        std::function<void(DX7VoiceHandle)> singleCallback;
+        DX7VoiceBankHandle voices;
+        DX7VoiceHandle voice;
+        std::function<void(uint64_t)> modelCallback;
+        uint64_t modelHash = 0;
+    };
+    
+    // Everything tied to one loaded checkpoint. Published RCU-style: readers take
+    // a snapshot of activeVariant and hold it for as long as they use it, so a
+    // variant is only destroyed once nothing references it any more.
+    struct ModelVariant
+    {
+        explicit ModelVariant(const InferenceEngineConfig& config)
+            : voiceCache(config.voiceCacheBytes, config.voiceCacheShards) {}
+        
+        uint64_t hash = 0;
+        std::shared_ptr<NeuralModelWrapper> model; // Null when the inference host runs it
+        VoiceCache voiceCache;
+        PersistentVoiceCache persistentCache;
+        LatentAtlas latentAtlas;
+        std::atomic<bool> atlasChunkQueued{false};
+    };
+    
+    std::shared_ptr<ModelVariant> getActiveVariant() const { return std::atomic_load(&activeVariant); }
+    std::shared_ptr<ModelVariant> createVariant(std::shared_ptr<NeuralModelWrapper> model, uint64_t hash, bool isStartupModel);
+    void activateVariant(std::shared_ptr<ModelVariant> variant);
+    void loadVariantFromFile(InferenceRequest& request);
+    void configureModel(NeuralModelWrapper& model) const;
+    static juce::File partitionFile(const juce::File& file, uint64_t hash);
+    
+    // One of a pool of threads sharing the loaded model. Each worker owns lock-free
+    // rings of requests per priority and steals from its siblings when its own run
+    // dry. Idle workers block on wakeEvent with no timeout.
+    class InferenceWorker : public juce::Thread
+    {
+    public:
+        InferenceWorker(ThreadedInferenceEngine& owner, int index, const InferenceEngineConfig& config);
+        void run() override;
+        
+        std::array<std::unique_ptr<LockFreeRing<InferenceRequest>>, NUM_PRIORITIES> singleVoiceRings;
+        std::array<std::unique_ptr<LockFreeRing<InferenceRequest>>, NUM_PRIORITIES> batchRings;
+        juce::WaitableEvent wakeEvent;
+        
+        // Scratch space reused for every micro-batch
+        std::vector<InferenceRequest> batch;
+        std::vector<float> batchedLatent;
+        
+    private:
+        ThreadedInferenceEngine& owner;
+        const int index;
+    };
+    
+    // Loads the model at background priority once the warm-up delay has passed
+    class WarmUpThread : public juce::Thread
+    {
+    public:
+        WarmUpThread(ThreadedInferenceEngine& owner, int delayMs);
+        void run() override;
+        
+    private:
+        ThreadedInferenceEngine& owner;
+        const int delayMs;
+    };
+    
+    void runWorker(int workerIndex);
+    bool ensureModelLoaded();
+    void startBackgroundGeneration();
+    void submitRequest(InferenceRequest&& request);
+    void wakeWorkerFor(int targetIndex, bool singleVoice);
+    static int pickWorkerToWake(uint32_t candidates, int preferredIndex);
+    void waitForWork(int workerIndex);
+    bool takeRequest(int workerIndex, InferenceRequest& request);
+    void countTakenRequest(const InferenceRequest& request);
+    bool takeSingleVoiceRequest(int workerIndex, InferenceRequest& request);
+    void gatherMicroBatch(int workerIndex);
+    bool isStale(const InferenceRequest& request) const;
+    void dropRequest(InferenceRequest& request);
+    void failRequest(InferenceRequest& request);
+    void failQueuedRequests();
+    void failWaitingBankCallbacks();
+    void failSingleVoice(std::function<void(DX7VoiceHandle)> callback);
+    void processInferenceRequest(InferenceRequest& request);
+    void processSingleVoiceBatch(InferenceWorker& worker);
+    void completeSingleVoice(ModelVariant* variant, InferenceRequest& request, DX7VoiceHandle voice,
+                             std::vector<PersistentVoiceCache::Entry>& persistentWrites);
+    void completePrefetch(ModelVariant& variant, InferenceRequest& request, const DX7VoiceBank& voices);
+    
+    // Results are handed to the message thread through a ring drained by one async update
+    void postResult(InferenceResult&& result);
+    void handleAsyncUpdate() override;
+    
+    // Startup model, shared by every worker until another variant is activated
+    const InferenceEngineConfig engineConfig;
+    std::shared_ptr<NeuralModelWrapper> neuralModel;
+    std::mutex modelLoadMutex;
+    uint64_t hostModelHash = 0; // Written once under modelLoadMutex, before modelLoaded
+    
+    // Loaded variants and the one new requests go to (std::atomic_load/store only)
+    std::shared_ptr<ModelVariant> activeVariant;
+    mutable std::mutex variantsMutex;
+    std::vector<std::shared_ptr<ModelVariant>> loadedVariants;
+    
+    // Every decode goes through these, in-process or over a pooled host connection
+    DX7VoiceBank decodeVoices(const ModelVariant& variant, const std::vector<float>& latents);
+    DX7VoiceBank decodeRandomBanks(const ModelVariant& variant, uint64_t firstBank, int numBanks);
+    
+    // Out-of-process inference; cleared if the host can't be reached at startup,
+    // or comes back running a different model, and the model then runs in-process
+    std::atomic<bool> useInferenceHost{false};
+    std::string inferenceHostSocket;
+    juce::File inferenceHostExecutable;
+    std::mutex hostConnectionMutex;
+    std::vector<std::unique_ptr<InferenceHostClient>> idleHostConnections;
+    
+    bool connectToInferenceHost();
+    std::unique_ptr<InferenceHostClient> acquireHostConnection();
+    void releaseHostConnection(std::unique_ptr<InferenceHostClient> connection);
+    void fallBackToInProcess();
     
-    // Neural model wrapper
-    std::unique_ptr<NeuralModelWrapper> neuralModel;
+    // Worker pool
+    int numWorkers = 1;
+    int intraOpThreadsPerWorker = 1;
+    double microBatchWindowMs = 0.0;
+    int maxMicroBatchSize = 1;
+    std::vector<std::unique_ptr<InferenceWorker>> workers;
+    std::atomic<unsigned int> nextWorker{0};
     
-    // Thread synchronization
-    std::mutex requestMutex;
-    std::condition_variable requestCondition;
-    std::queue<InferenceRequest> requestQueue;
+    // Thread synchronization. Workers publish themselves in these masks before
+    // blocking so submitters know whom to wake; nobody polls.
+    std::atomic<int> pendingRequests{0};
+    std::atomic<int> pendingSingleVoiceRequests{0}; // The part of pendingRequests a micro-batch can take
+    std::atomic<uint32_t> sleepingWorkers{0};
+    std::atomic<uint32_t> gatheringWorkers{0};
     std::atomic<bool> shouldStop{false};
     
-    // Double buffer for random voices
-    std::mutex bufferMutex;
-    std::vector<DX7Voice> bufferedRandomVoices;
-    std::atomic<bool> hasBufferedVoices{false};
+    LockFreeRing<InferenceResult> completionRing;
+    
+    // Latest generation submitted under each coalescing key, and which keys are leased
+    std::array<std::atomic<uint64_t>, MAX_COALESCING_KEYS> coalescingGenerations{};
+    std::atomic<uint64_t> leasedCoalescingKeys{0};
+    
+    // Ring of random banks, plus callers waiting for a bank while it was empty
+    struct RandomBank
+    {
+        uint64_t index = 0;
+        DX7VoiceBankHandle voices;
+    };
+    
+    int bankRingDepth = 1;
+    int bankLowWatermark = 1;
+    uint64_t randomSeed = 0;
+    LatentSampler::Mode randomLatentMode = LatentSampler::Mode::NORMAL;
+    std::atomic<uint64_t> nextRandomBank{0};
+    std::atomic<int64_t> lastServedRandomBank{-1};
+    mutable std::mutex bufferMutex;
+    std::deque<RandomBank> bufferedBanks;
+    std::deque<std::function<void(DX7VoiceBankHandle)>> waitingBankCallbacks;
+    std::atomic<int> bufferedBankCount{0};
     std::atomic<bool> isGeneratingBuffer{false};
     
-    // Custom voice caching
-    static constexpr size_t MAX_CACHE_SIZE = 1000;
-    mutable std::mutex cacheMutex;
-    std::unordered_map<std::string, DX7Voice> voiceCache;
-    std::queue<std::string> cacheOrder; // For LRU eviction
-    std::atomic<bool> isPreGenerating{false}; // Prevent multiple inflight cache fills
+    void refillRandomBanks(const std::shared_ptr<ModelVariant>& variant);
+    DX7VoiceBankHandle popBufferedBank();
+    
+    // Custom voice caching, partitioned per model variant
+    bool usePersistentCache = false;
+    juce::File persistentCacheFile;
+    size_t persistentCacheMaxBytes = 0;
     
-    // Request scheduling for inflight handling
-    std::mutex scheduleMutex;
-    std::optional<InferenceRequest> scheduledRequest; // Next request to run after current completes
+    bool fillFromPersistentCache(ModelVariant& variant, const VoiceCacheKey& key, DX7VoiceHandle& voice);
     
-    // Helper methods
-    std::string latentVectorToKey(const std::vector<float>& latentVector) const;
-    void addToCache(const std::vector<float>& latentVector, const DX7Voice& voice);
-    void evictOldestFromCache();
+    // Latent lattice atlas
+    bool useLatentAtlas = false;
+    juce::File latentAtlasFile;
+    LatentAtlas::Settings latentAtlasSettings;
+    int latentAtlasChunkSize = 1;
+    
+    void buildAtlasChunk(const std::shared_ptr<ModelVariant>& variant);
+    void scheduleAtlasChunk(const std::shared_ptr<ModelVariant>& variant);
     
     // Model loading state
     std::atomic<bool> modelLoaded{false};
+    std::atomic<bool> modelLoadFailed{false}; // Set by workers that gave up; new requests fail at once
+    std::atomic<bool> started{false};
+    std::atomic<bool> backgroundGenerationStarted{false};
+    std::unique_ptr<WarmUpThread> warmUpThread;
+    
+    // Startup instrumentation, relative to constructionMs
+    const double constructionMs;
+    std::atomic<double> startRequestedMs{-1.0};
+    std::atomic<double> loadStartedMs{-1.0};
+    std::atomic<double> readyMs{-1.0};
+    double millisecondsSinceConstruction() const;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ThreadedInferenceEngine)
 };
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "VoiceCache.h"
+#include <algorithm>
+#include <cmath>
+
+VoiceCacheKey VoiceCacheKey::fromLatent(const float* latent, size_t size)
+{
+    VoiceCacheKey key;
+    const size_t count = std::min(size, key.values.size());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Slider values are multiples of the step, so rounding maps each position to exactly one key
+        const long quantised = std::lround(latent[i] / QUANTISATION_STEP);
+        key.values[i] = static_cast<int16_t>(std::clamp(quantised, -32768L, 32767L));
+    }
+
+    return key;
+}
+
+uint64_t VoiceCacheKey::hash() const
+{
+    // FNV-1a over the quantised values
+    uint64_t h = 1469598103934665603ull;
+    for (int16_t value : values)
+    {
+        h ^= static_cast<uint16_t>(value);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+VoiceCache::VoiceCache(size_t byteBudget, int requestedShards)
+    : numShards(static_cast<size_t>(std::max(1, requestedShards)))
+{
+    shards.reset(new Shard[numShards]);
+    maxEntriesPerShard = std::max<size_t>(1, byteBudget / ENTRY_BYTES / numShards);
+}
+
+VoiceCache::Shard& VoiceCache::shardFor(const VoiceCacheKey& key) const
+{
+    // Use the high bits so the shard choice is independent of the bucket choice
+    return shards[(key.hash() >> 32) % numShards];
+}
+
+VoiceCache::LookupResult VoiceCache::lookupOrReserve(const VoiceCacheKey& key, DX7VoiceHandle& voice)
+{
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end())
+    {
+        if (it->second->voice == nullptr)
+        {
+            ++shard.misses;
+            return LookupResult::PENDING;
+        }
+
+        ++shard.hits;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        voice = it->second->voice;
+        return LookupResult::HIT;
+    }
+
+    ++shard.misses;
+    shard.lru.push_front(Entry{ key, nullptr });
+    shard.index.emplace(key, shard.lru.begin());
+    evictIfNeeded(shard);
+    return LookupResult::RESERVED;
+}
+
+DX7VoiceHandle VoiceCache::lookup(const VoiceCacheKey& key)
+{
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end() || it->second->voice == nullptr)
+    {
+        ++shard.misses;
+        return nullptr;
+    }
+
+    ++shard.hits;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->voice;
+}
+
+bool VoiceCache::contains(const VoiceCacheKey& key) const
+{
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    return it != shard.index.end() && it->second->voice != nullptr;
+}
+
+void VoiceCache::insert(const VoiceCacheKey& key, DX7VoiceHandle voice)
+{
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end())
+    {
+        // Fulfil a reservation (or refresh an existing entry)
+        it->second->voice = std::move(voice);
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.push_front(Entry{ key, std::move(voice) });
+    shard.index.emplace(key, shard.lru.begin());
+    evictIfNeeded(shard);
+}
+
+void VoiceCache::cancelReservation(const VoiceCacheKey& key)
+{
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end() && it->second->voice == nullptr)
+    {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+void VoiceCache::evictIfNeeded(Shard& shard)
+{
+    // Evict least recently used entries; outstanding reservations are skipped
+    // since their owner will still insert into them
+    auto it = shard.lru.end();
+    while (shard.lru.size() > maxEntriesPerShard && it != shard.lru.begin())
+    {
+        --it;
+        if (it->voice == nullptr)
+        {
+            continue;
+        }
+
+        shard.index.erase(it->key);
+        it = shard.lru.erase(it);
+        ++shard.evictions;
+    }
+}
+
+void VoiceCache::clear()
+{
+    for (size_t i = 0; i < numShards; ++i)
+    {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        shards[i].lru.clear();
+        shards[i].index.clear();
+    }
+}
+
+VoiceCache::Stats VoiceCache::getStats() const
+{
+    Stats stats;
+
+    for (size_t i = 0; i < numShards; ++i)
+    {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        stats.hits += shards[i].hits;
+        stats.misses += shards[i].misses;
+        stats.evictions += shards[i].evictions;
+        stats.entries += shards[i].lru.size();
+    }
+
+    stats.bytes = stats.entries * ENTRY_BYTES;
+    return stats;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "DX7Voice.h"
+
+// Latent vector quantised to the 0.01 step of DX7LatentSlider, one int16 per
+// dimension. Fixed width, so building and hashing a key never allocates.
+struct VoiceCacheKey
+{
+    static constexpr int LATENT_DIM = 8;
+    static constexpr float QUANTISATION_STEP = 0.01f;
+
+    std::array<int16_t, LATENT_DIM> values{};
+
+    static VoiceCacheKey fromLatent(const float* latent, size_t size);
+    static VoiceCacheKey fromLatent(const std::vector<float>& latent) { return fromLatent(latent.data(), latent.size()); }
+
+    bool operator==(const VoiceCacheKey& other) const { return values == other.values; }
+    uint64_t hash() const;
+
+    struct Hasher
+    {
+        size_t operator()(const VoiceCacheKey& key) const { return static_cast<size_t>(key.hash()); }
+    };
+};
+
+// Sharded LRU cache of generated voices bounded by a byte budget.
+// A miss can reserve its key so concurrent callers don't generate the same voice twice.
+// Voices are held as shared handles, so a hit only bumps a reference count under the lock.
+class VoiceCache
+{
+public:
+    enum class LookupResult
+    {
+        HIT,      // voice was filled in
+        RESERVED, // caller now owns the key and must insert() or cancelReservation()
+        PENDING   // another caller already reserved the key
+    };
+
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit VoiceCache(size_t byteBudget = 2 * 1024 * 1024, int numShards = 16);
+
+    LookupResult lookupOrReserve(const VoiceCacheKey& key, DX7VoiceHandle& voice);
+    DX7VoiceHandle lookup(const VoiceCacheKey& key);
+    bool contains(const VoiceCacheKey& key) const;
+
+    void insert(const VoiceCacheKey& key, DX7VoiceHandle voice);
+    void cancelReservation(const VoiceCacheKey& key);
+    void clear();
+
+    Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        VoiceCacheKey key;
+        DX7VoiceHandle voice; // null while reserved
+    };
+
+    // Approximate footprint of one entry including list and hash map nodes and the shared voice
+    static constexpr size_t ENTRY_BYTES = sizeof(Entry) + sizeof(DX7Voice) + 10 * sizeof(void*);
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; // most recently used at the front
+        std::unordered_map<VoiceCacheKey, std::list<Entry>::iterator, VoiceCacheKey::Hasher> index;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    Shard& shardFor(const VoiceCacheKey& key) const;
+    void evictIfNeeded(Shard& shard);
+
+    std::unique_ptr<Shard[]> shards;
+    size_t numShards;
+    size_t maxEntriesPerShard;
+};
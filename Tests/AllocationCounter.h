@@ -0,0 +1,43 @@
+#pragma once
+
+#include <c10/core/Allocator.h>
+#include <c10/core/CPUAllocator.h>
+#include <atomic>
+
+// Counts the tensor storage libtorch allocates on the CPU while it is in scope,
+// by putting itself in front of the CPU allocator. Storage wrapped with from_blob
+// never reaches the allocator, so only real allocations are counted.
+class AllocationCounter : public c10::Allocator
+{
+public:
+    AllocationCounter() : wrapped(c10::GetCPUAllocator())
+    {
+        c10::SetCPUAllocator(this);
+    }
+    
+    ~AllocationCounter() override
+    {
+        c10::SetCPUAllocator(wrapped);
+    }
+    
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+    
+    c10::DataPtr allocate(size_t numBytes) const override
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return wrapped->allocate(numBytes);
+    }
+    
+    c10::DeleterFnPtr raw_deleter() const override
+    {
+        return wrapped->raw_deleter();
+    }
+    
+    void reset() { allocations.store(0); }
+    int getAllocations() const { return allocations.load(); }
+    
+private:
+    c10::Allocator* wrapped;
+    mutable std::atomic<int> allocations{0};
+};
@@ -0,0 +1,200 @@
+#include <juce_core/juce_core.h>
+#include <cstring>
+#include <vector>
+#include "DX7SysExLibrary.h"
+#include "DX7SysExReader.h"
+#include "DX7SysExWriter.h"
+#include "TestVoices.h"
+
+// Round trips through DX7SysExWriter, every way a message can be rejected, and
+// how a library scan treats damaged files and duplicate voices
+class DX7SysExTests : public juce::UnitTest
+{
+public:
+    DX7SysExTests() : juce::UnitTest("DX7SysEx", "SysEx") {}
+
+    using Status = DX7SysExReader::Status;
+
+    void runTest() override
+    {
+        const auto bank = TestVoices::makeRandomBank(DX7SysExWriter::N_VOICES, 0x44583721);
+
+        DX7SysExWriter::BulkDump bulk;
+        expect(DX7SysExWriter::writeBulkDump(bank, bulk));
+
+        beginTest("Bulk dump reads back as written");
+        {
+            DX7VoiceBank read;
+            size_t messageBytes = 0;
+            expect(DX7SysExReader::readMessage(bulk.data(), bulk.size(), read, messageBytes) == Status::OK);
+            expectEquals(static_cast<int>(messageBytes), static_cast<int>(DX7SysExWriter::BULK_DUMP_BYTES));
+            expect(sameVoices(read, 0, bank, 0, DX7SysExWriter::N_VOICES));
+
+            DX7VoiceBank readAsBulk;
+            expect(DX7SysExReader::readBulkDump(bulk.data(), bulk.size(), readAsBulk) == Status::OK);
+            expect(sameVoices(readAsBulk, 0, bank, 0, DX7SysExWriter::N_VOICES));
+        }
+
+        beginTest("Single voice dump reads back as written");
+        {
+            for (int v = 0; v < bank.size(); ++v)
+            {
+                DX7SysExWriter::SingleVoiceDump single;
+                expect(DX7SysExWriter::writeSingleVoice(bank[v], single));
+
+                DX7VoiceBank read;
+                size_t messageBytes = 0;
+                expect(DX7SysExReader::readMessage(single.data(), single.size(), read, messageBytes) == Status::OK);
+                expectEquals(static_cast<int>(messageBytes), static_cast<int>(DX7SysExWriter::SINGLE_VOICE_BYTES));
+                expect(sameVoices(read, 0, bank, v, 1), "voice " + juce::String(v));
+
+                DX7VoiceBank readAsSingle;
+                expect(DX7SysExReader::readSingleVoice(single.data(), single.size(), readAsSingle) == Status::OK);
+                expect(sameVoices(readAsSingle, 0, bank, v, 1));
+            }
+        }
+
+        beginTest("Damaged messages are rejected without adding voices");
+        {
+            const std::vector<uint8_t> message(bulk.begin(), bulk.end());
+            const size_t checksumByte = message.size() - 2;
+
+            expectStatus({}, Status::TRUNCATED, "empty");
+            expectStatus({ 0xF0, 0x43, 0x00 }, Status::TRUNCATED, "header cut short");
+            expectStatus(std::vector<uint8_t>(message.begin(), message.end() - 1), Status::TRUNCATED, "F7 cut off");
+
+            expectStatus(withByte(message, 0, 0x00), Status::NOT_SYSEX, "no F0");
+
+            expectStatus(withByte(message, 1, 0x41), Status::NOT_VOICE_DUMP, "another manufacturer");
+            expectStatus(withByte(message, 2, 0x10), Status::NOT_VOICE_DUMP, "parameter change sub-status");
+            expectStatus(withByte(message, 3, 0x05), Status::NOT_VOICE_DUMP, "another format");
+
+            expectStatus(withByte(message, 5, static_cast<uint8_t>(message[5] ^ 1)), Status::BAD_BYTE_COUNT, "byte count");
+            expectStatus(withByte(message, message.size() - 1, 0x00), Status::MISSING_END, "no F7");
+            expectStatus(withByte(message, 100, static_cast<uint8_t>(message[100] | 0x80)), Status::BAD_DATA_BYTE, "top bit set");
+
+            const auto badChecksum = withByte(message, checksumByte, static_cast<uint8_t>((message[checksumByte] + 1) & 0x7F));
+            expectStatus(badChecksum, Status::BAD_CHECKSUM, "checksum");
+
+            // Everything else is still checked when the checksum isn't
+            DX7VoiceBank read;
+            expect(DX7SysExReader::readBulkDump(badChecksum.data(), badChecksum.size(), read, false) == Status::OK);
+            expect(sameVoices(read, 0, bank, 0, DX7SysExWriter::N_VOICES));
+
+            // The format-specific readers only accept their own format
+            DX7SysExWriter::SingleVoiceDump single;
+            expect(DX7SysExWriter::writeSingleVoice(bank[0], single));
+            DX7VoiceBank wrongFormat;
+            expect(DX7SysExReader::readSingleVoice(bulk.data(), bulk.size(), wrongFormat) == Status::NOT_VOICE_DUMP);
+            expect(DX7SysExReader::readBulkDump(single.data(), single.size(), wrongFormat) == Status::NOT_VOICE_DUMP);
+            expect(wrongFormat.empty());
+        }
+
+        beginTest("readAll resynchronises on the next F0 after a damaged message");
+        {
+            DX7SysExWriter::SingleVoiceDump single;
+            expect(DX7SysExWriter::writeSingleVoice(bank[7], single));
+
+            // Junk, a bulk dump cut off after 100 bytes, then two good messages
+            std::vector<uint8_t> buffer = { 0x12, 0x34, 0xF7 };
+            buffer.insert(buffer.end(), bulk.begin(), bulk.begin() + 100);
+            buffer.insert(buffer.end(), single.begin(), single.end());
+            buffer.insert(buffer.end(), bulk.begin(), bulk.end());
+
+            DX7VoiceBank read;
+            const auto summary = DX7SysExReader::readAll(buffer.data(), buffer.size(), read);
+
+            expectEquals(summary.voices, 1 + DX7SysExWriter::N_VOICES);
+            expectEquals(summary.count(Status::OK), 2);
+            expectEquals(summary.voices, read.size());
+
+            int rejected = 0;
+            for (int s = 1; s < DX7SysExReader::NUM_STATUSES; ++s)
+            {
+                rejected += summary.messages[static_cast<size_t>(s)];
+            }
+            expectEquals(rejected, 1, "rejected messages");
+
+            expect(sameVoices(read, 0, bank, 7, 1));
+            expect(sameVoices(read, 1, bank, 0, DX7SysExWriter::N_VOICES));
+        }
+
+        beginTest("Library scans skip duplicate voices across and within files");
+        {
+            const auto extra = TestVoices::makeRandomBank(1, 0x5eed);
+
+            DX7SysExWriter::SingleVoiceDump copied;
+            DX7SysExWriter::SingleVoiceDump unique;
+            expect(DX7SysExWriter::writeSingleVoice(bank[3], copied));
+            expect(DX7SysExWriter::writeSingleVoice(extra[0], unique));
+
+            // The bank; one of its voices again, a new voice and that new voice again
+            juce::TemporaryFile bankFile(".syx");
+            juce::TemporaryFile singlesFile(".syx");
+            expect(bankFile.getFile().replaceWithData(bulk.data(), bulk.size()));
+
+            std::vector<uint8_t> singles(copied.begin(), copied.end());
+            singles.insert(singles.end(), unique.begin(), unique.end());
+            singles.insert(singles.end(), unique.begin(), unique.end());
+            expect(singlesFile.getFile().replaceWithData(singles.data(), singles.size()));
+
+            const juce::File missingFile = bankFile.getFile().getSiblingFile("missing_" + bankFile.getFile().getFileName());
+            const std::vector<juce::File> files = { bankFile.getFile(), missingFile, singlesFile.getFile() };
+
+            DX7SysExLibrary::Options options;
+            options.numThreads = 2;
+            options.repairVoices = false;
+
+            DX7SysExLibrary library;
+            const auto stats = library.scanFiles(files, options);
+
+            expectEquals(stats.filesScanned, 3);
+            expectEquals(stats.filesUnreadable, 1);
+            expectEquals(stats.filesWithVoices, 2);
+            expectEquals(stats.voicesFound, DX7SysExWriter::N_VOICES + 3);
+            expectEquals(stats.duplicatesSkipped, 2);
+            expectEquals(library.size(), DX7SysExWriter::N_VOICES + 1);
+
+            expect(sameVoices(library.getVoices(), 0, bank, 0, DX7SysExWriter::N_VOICES));
+            expect(sameVoices(library.getVoices(), DX7SysExWriter::N_VOICES, extra, 0, 1));
+
+            // The kept copy of the new voice is the first one, in the third file
+            if (library.size() > DX7SysExWriter::N_VOICES)
+            {
+                const auto& source = library.getSource(DX7SysExWriter::N_VOICES);
+                expectEquals(static_cast<int>(source.fileIndex), 2);
+                expectEquals(static_cast<int>(source.voiceIndex), 1);
+            }
+
+            options.skipDuplicates = false;
+            const auto allStats = library.scanFiles(files, options);
+            expectEquals(allStats.duplicatesSkipped, 0);
+            expectEquals(library.size(), DX7SysExWriter::N_VOICES + 3);
+        }
+    }
+
+private:
+    void expectStatus(const std::vector<uint8_t>& message, Status expected, const juce::String& what)
+    {
+        DX7VoiceBank read;
+        size_t messageBytes = 0;
+        const Status status = DX7SysExReader::readMessage(message.data(), message.size(), read, messageBytes);
+        expect(status == expected, what + ": got " + DX7SysExReader::getStatusName(status)
+                                       + ", expected " + DX7SysExReader::getStatusName(expected));
+        expect(read.empty(), what + ": voices added");
+    }
+
+    static std::vector<uint8_t> withByte(std::vector<uint8_t> message, size_t index, uint8_t value)
+    {
+        message[index] = value;
+        return message;
+    }
+
+    static bool sameVoices(const DX7VoiceBank& a, int firstA, const DX7VoiceBank& b, int firstB, int count)
+    {
+        return firstA + count <= a.size() && firstB + count <= b.size()
+            && std::memcmp(a.voiceData(firstA), b.voiceData(firstB), static_cast<size_t>(count) * DX7Voice::N_PARAMS) == 0;
+    }
+};
+
+static DX7SysExTests dx7SysExTests;
@@ -0,0 +1,214 @@
+#include <juce_core/juce_core.h>
+#include <random>
+#include <vector>
+#include "DX7VoiceValidator.h"
+#include "TestVoices.h"
+
+// The range table drives 16-byte compares, so every field (including the ones
+// only reached by the overlapping last chunk) is checked against the limits
+// DX7Voice::validate used to test one field at a time
+class DX7VoiceValidatorTests : public juce::UnitTest
+{
+public:
+    DX7VoiceValidatorTests() : juce::UnitTest("DX7VoiceValidator", "Voices") {}
+
+    void runTest() override
+    {
+        const auto limits = makeFieldLimits();
+
+        beginTest("Range table matches the per-field limits");
+        {
+            const auto& maxValues = DX7VoiceValidator::getMaxValues();
+            for (int i = 0; i < DX7Voice::N_PARAMS; ++i)
+            {
+                expectEquals(static_cast<int>(maxValues[static_cast<size_t>(i)]), static_cast<int>(limits[static_cast<size_t>(i)]),
+                             DX7VoiceValidator::getParameterName(i));
+            }
+        }
+
+        beginTest("Each field is rejected just above its limit and accepted at it");
+        {
+            const auto bank = TestVoices::makeRandomBank(1, 0x76616c69);
+
+            for (int i = 0; i < DX7Voice::N_PARAMS; ++i)
+            {
+                auto voice = bank;
+                uint8_t* parameters = voice.voiceData(0);
+                const juce::String name = DX7VoiceValidator::getParameterName(i);
+
+                parameters[i] = limits[static_cast<size_t>(i)];
+                expect(DX7VoiceValidator::isValid(parameters, 1), name + " at its limit");
+
+                for (int value : { limits[static_cast<size_t>(i)] + 1, 255 })
+                {
+                    parameters[i] = static_cast<uint8_t>(value);
+                    expect(!DX7VoiceValidator::isValid(parameters, 1), name + " = " + juce::String(value));
+                    expectEquals(DX7VoiceValidator::findInvalidParameter(parameters), i, name);
+                }
+            }
+        }
+
+        beginTest("Batches agree with a field-by-field check");
+        {
+            constexpr int numVoices = 512;
+            auto bank = TestVoices::makeRandomBank(numVoices, 0x62616463);
+
+            // About one voice in eight gets a few random bytes, often out of range
+            std::mt19937 generator(7);
+            for (int v = 0; v < numVoices; ++v)
+            {
+                if (generator() % 8 == 0)
+                {
+                    for (int n = 0; n < 3; ++n)
+                    {
+                        bank.voiceData(v)[generator() % DX7Voice::N_PARAMS] = static_cast<uint8_t>(generator());
+                    }
+                }
+            }
+
+            int firstInvalid = -1;
+            for (int v = 0; v < numVoices; ++v)
+            {
+                const int expected = firstFieldOutOfRange(limits, bank.voiceData(v));
+                expectEquals(DX7VoiceValidator::findInvalidParameter(bank.voiceData(v)), expected);
+                expectEquals(DX7VoiceValidator::isValid(bank.voiceData(v), 1), expected < 0);
+
+                if (firstInvalid < 0 && expected >= 0)
+                {
+                    firstInvalid = v;
+                }
+            }
+            expect(firstInvalid >= 0, "no voice was made invalid");
+            expectEquals(DX7VoiceValidator::findInvalidVoice(bank.data(), numVoices), firstInvalid);
+        }
+
+        beginTest("clamp() reports exactly the fields it clamped");
+        {
+            constexpr int numVoices = 64;
+            const auto original = TestVoices::makeRandomBank(numVoices, 0x636c6d70);
+            auto bank = original;
+
+            // Voice v breaks field (v * 7) % N_PARAMS, and every fifth voice the last field too
+            std::vector<std::bitset<DX7Voice::N_PARAMS>> broken(numVoices);
+            for (int v = 0; v < numVoices; v += 3)
+            {
+                for (int field : { (v * 7) % DX7Voice::N_PARAMS, v % 5 == 0 ? DX7Voice::N_PARAMS - 1 : -1 })
+                {
+                    if (field >= 0)
+                    {
+                        bank.voiceData(v)[field] = static_cast<uint8_t>(limits[static_cast<size_t>(field)] + 1);
+                        broken[static_cast<size_t>(v)].set(static_cast<size_t>(field));
+                    }
+                }
+            }
+
+            const auto repairs = DX7VoiceValidator::clamp(bank.data(), numVoices);
+
+            size_t next = 0;
+            for (int v = 0; v < numVoices; ++v)
+            {
+                const auto& fields = broken[static_cast<size_t>(v)];
+                if (fields.none())
+                {
+                    continue;
+                }
+
+                expect(next < repairs.size(), "voice " + juce::String(v) + " not reported");
+                if (next < repairs.size())
+                {
+                    expectEquals(repairs[next].voiceIndex, v);
+                    expect(repairs[next].fields == fields, "voice " + juce::String(v) + " reported the wrong fields");
+                    ++next;
+                }
+
+                for (int i = 0; i < DX7Voice::N_PARAMS; ++i)
+                {
+                    const uint8_t expected = fields.test(static_cast<size_t>(i)) ? limits[static_cast<size_t>(i)]
+                                                                                 : original.voiceData(v)[i];
+                    expectEquals(static_cast<int>(bank.voiceData(v)[i]), static_cast<int>(expected));
+                }
+            }
+            expectEquals(static_cast<int>(repairs.size()), static_cast<int>(next), "voices reported but not broken");
+            expect(DX7VoiceValidator::isValid(bank.data(), numVoices));
+
+            // The DX7Voice overload reports the same fields
+            auto voiceBank = TestVoices::makeRandomBank(1, 0x766f6963);
+            voiceBank.voiceData(0)[13] = 15;  // Osc 0 DET
+            voiceBank.voiceData(0)[134] = 32; // ALG
+            DX7Voice voice = voiceBank[0].toVoice();
+
+            const auto fields = DX7VoiceValidator::clamp(voice);
+            expect(fields.count() == 2 && fields.test(13) && fields.test(134), "DX7Voice clamp fields");
+
+            uint8_t clamped[DX7Voice::N_PARAMS];
+            voice.toParameterBytes(clamped);
+            expectEquals(static_cast<int>(clamped[13]), 14);
+            expectEquals(static_cast<int>(clamped[134]), 31);
+        }
+    }
+
+private:
+    using Limits = DX7VoiceValidator::Ranges;
+
+    // The limits of the old DX7Voice::validate, field by field. It didn't check
+    // the name at all; the table allows any SysEx data byte there.
+    static Limits makeFieldLimits()
+    {
+        Limits limits{};
+        int index = 0;
+
+        for (int osc = 0; osc < DX7Voice::N_OSC; ++osc)
+        {
+            for (int i = 0; i < 11; ++i)
+            {
+                limits[static_cast<size_t>(index++)] = 99; // R1-R4, L1-L4, BP, LD, RD
+            }
+            limits[static_cast<size_t>(index++)] = 3;  // RC
+            limits[static_cast<size_t>(index++)] = 3;  // LC
+            limits[static_cast<size_t>(index++)] = 14; // DET
+            limits[static_cast<size_t>(index++)] = 7;  // RS
+            limits[static_cast<size_t>(index++)] = 7;  // KVS
+            limits[static_cast<size_t>(index++)] = 3;  // AMS
+            limits[static_cast<size_t>(index++)] = 99; // OL
+            limits[static_cast<size_t>(index++)] = 31; // FC
+            limits[static_cast<size_t>(index++)] = 1;  // M
+            limits[static_cast<size_t>(index++)] = 99; // FF
+        }
+
+        for (int i = 0; i < 8; ++i)
+        {
+            limits[static_cast<size_t>(index++)] = 99; // PR1-PR4, PL1-PL4
+        }
+        limits[static_cast<size_t>(index++)] = 31; // ALG
+        limits[static_cast<size_t>(index++)] = 1;  // OKS
+        limits[static_cast<size_t>(index++)] = 7;  // FB
+        for (int i = 0; i < 4; ++i)
+        {
+            limits[static_cast<size_t>(index++)] = 99; // LFS, LFD, LPMD, LAMD
+        }
+        limits[static_cast<size_t>(index++)] = 7;  // LPMS
+        limits[static_cast<size_t>(index++)] = 5;  // LFW
+        limits[static_cast<size_t>(index++)] = 1;  // LKS
+        limits[static_cast<size_t>(index++)] = 48; // TRNSP
+
+        while (index < DX7Voice::N_PARAMS)
+        {
+            limits[static_cast<size_t>(index++)] = 127; // NAME1-10
+        }
+        return limits;
+    }
+
+    static int firstFieldOutOfRange(const Limits& limits, const uint8_t* parameters)
+    {
+        for (int i = 0; i < DX7Voice::N_PARAMS; ++i)
+        {
+            if (parameters[i] > limits[static_cast<size_t>(i)])
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+};
+
+static DX7VoiceValidatorTests dx7VoiceValidatorTests;
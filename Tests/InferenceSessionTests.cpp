@@ -0,0 +1,71 @@
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include "AllocationCounter.h"
+#include "InferenceSession.h"
+#include "TestModels.h"
+
+#if NDX7_HAS_INFERENCE_MODE
+ #include <c10/core/InferenceMode.h>
+#endif
+
+class InferenceSessionTests : public juce::UnitTest
+{
+public:
+    InferenceSessionTests() : juce::UnitTest("InferenceSession", "Inference") {}
+    
+    void runTest() override
+    {
+        auto module = TestModels::loadEmbeddedModule();
+        InferenceSession session(module);
+        
+        beginTest("Steady state allocates nothing beyond the forward pass itself");
+        {
+            // Includes a batch that is split over two forward passes
+            for (int numVoices : { 1, 3, 32, 100, InferenceSession::MAX_BUCKET, InferenceSession::MAX_BUCKET + 44 })
+            {
+                const auto latents = TestModels::makeLatents(numVoices, InferenceSession::LATENT_DIM, 1);
+                std::vector<uint8_t> parameters(static_cast<size_t>(numVoices) * DX7Voice::N_PARAMS);
+                const int forwardPasses = (numVoices + InferenceSession::MAX_BUCKET - 1) / InferenceSession::MAX_BUCKET;
+                const int bucketSize = InferenceSession::bucketSizeFor(std::min(numVoices, InferenceSession::MAX_BUCKET));
+                
+                // The first call of each shape creates its bucket
+                expect(session.decode(latents.data(), numVoices, parameters.data()));
+                
+                const int forwardAllocations = countForwardAllocations(module, bucketSize);
+                
+                for (int run = 0; run < 3; ++run)
+                {
+                    AllocationCounter counter;
+                    expect(session.decode(latents.data(), numVoices, parameters.data()));
+                    const int allocations = counter.getAllocations();
+                    
+                    expectEquals(session.getLastCallForwardPasses(), forwardPasses, "batch of " + juce::String(numVoices));
+                    expectEquals(allocations, forwardPasses * forwardAllocations, "batch of " + juce::String(numVoices));
+                }
+            }
+        }
+    }
+    
+private:
+    // What model.forward allocates by itself for one bucket, once the executor
+    // has settled on a graph for that shape
+    static int countForwardAllocations(torch::jit::script::Module& module, int bucketSize)
+    {
+#if NDX7_HAS_INFERENCE_MODE
+        c10::InferenceMode inferenceMode;
+#else
+        torch::NoGradGuard noGrad;
+#endif
+        std::vector<torch::jit::IValue> arguments{ torch::zeros({ bucketSize, InferenceSession::LATENT_DIM }) };
+        for (int run = 0; run < 3; ++run)
+        {
+            module.forward(arguments);
+        }
+        
+        AllocationCounter counter;
+        module.forward(arguments);
+        return counter.getAllocations();
+    }
+};
+
+static InferenceSessionTests inferenceSessionTests;
@@ -0,0 +1,113 @@
+#include <juce_core/juce_core.h>
+#include <cstring>
+#include <vector>
+#include "LatentSampler.h"
+
+// Random banks are only reproducible from (seed, bank index) if every CPU path
+// gives the same bits and a bank doesn't depend on how the range was split
+class LatentSamplerTests : public juce::UnitTest
+{
+public:
+    LatentSamplerTests() : juce::UnitTest("LatentSampler", "Inference") {}
+
+    using Kernel = LatentSampler::Kernel;
+    using Mode = LatentSampler::Mode;
+
+    void runTest() override
+    {
+        beginTest("Philox4x32-10 matches the Random123 known-answer vectors");
+        {
+            expectBlock(LatentSampler::philox({ 0u, 0u, 0u, 0u }, 0ull),
+                        { 0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u });
+            expectBlock(LatentSampler::philox({ 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu }, 0xffffffffffffffffull),
+                        { 0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu });
+            expectBlock(LatentSampler::philox({ 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u }, 0x299f31d0a4093822ull),
+                        { 0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u });
+        }
+
+        beginTest("SSE2 and AVX2 kernels match the scalar kernel bit for bit");
+        {
+            // Odd counts leave padded lanes; the last start crosses 2^32 voices
+            for (const auto& range : { Range { 1, 0 }, Range { 37, 5 }, Range { 300, 1000 }, Range { 64, (1ull << 32) - 16 } })
+            {
+                const auto reference = generateWith(Kernel::SCALAR, range);
+
+                for (auto kernel : { Kernel::SSE2, Kernel::AVX2 })
+                {
+                    if (!LatentSampler::isKernelSupported(kernel))
+                    {
+                        logMessage(juce::String(kernel == Kernel::SSE2 ? "SSE2" : "AVX2") + " not supported on this CPU");
+                        continue;
+                    }
+
+                    expect(sameBits(generateWith(kernel, range), reference),
+                           juce::String(kernel == Kernel::SSE2 ? "SSE2" : "AVX2") + " differs for "
+                               + juce::String(range.numVoices) + " voices from " + juce::String(static_cast<juce::int64>(range.firstVoice)));
+                }
+
+                // generate() picks one of them
+                expect(sameBits(LatentSampler::generate(SEED, range.firstVoice, range.numVoices, Mode::NORMAL), reference));
+            }
+        }
+
+        beginTest("A bank is the same however the range around it was generated");
+        {
+            constexpr int numBanks = 6;
+
+            for (auto mode : { Mode::NORMAL, Mode::SOBOL })
+            {
+                const auto all = LatentSampler::generateBanks(SEED, 0, numBanks, mode);
+                const size_t bankFloats = static_cast<size_t>(LatentSampler::VOICES_PER_BANK) * LatentSampler::LATENT_DIM;
+
+                for (int b = 0; b < numBanks; ++b)
+                {
+                    const auto bank = LatentSampler::generateBanks(SEED, static_cast<uint64_t>(b), 1, mode);
+                    const std::vector<float> slice(all.begin() + static_cast<std::ptrdiff_t>(b * bankFloats),
+                                                   all.begin() + static_cast<std::ptrdiff_t>((b + 1) * bankFloats));
+                    expect(sameBits(bank, slice), juce::String(LatentSampler::getModeName(mode)) + " bank " + juce::String(b));
+                }
+
+                // And voice ranges that don't start on a bank or kernel chunk
+                const auto offset = LatentSampler::generate(SEED, 45, 100, mode);
+                const std::vector<float> offsetSlice(all.begin() + 45 * LatentSampler::LATENT_DIM,
+                                                     all.begin() + 145 * LatentSampler::LATENT_DIM);
+                expect(sameBits(offset, offsetSlice), juce::String(LatentSampler::getModeName(mode)) + " voices 45-144");
+
+                // A different seed gives different latents
+                expect(!sameBits(LatentSampler::generateBanks(SEED + 1, 0, numBanks, mode), all));
+            }
+        }
+    }
+
+private:
+    static constexpr uint64_t SEED = 0x4c6174656e74ull;
+
+    struct Range
+    {
+        int numVoices;
+        uint64_t firstVoice;
+    };
+
+    static std::vector<float> generateWith(Kernel kernel, const Range& range)
+    {
+        std::vector<float> latents(static_cast<size_t>(range.numVoices) * LatentSampler::LATENT_DIM);
+        LatentSampler::generateNormal(kernel, SEED, range.firstVoice, range.numVoices, latents.data());
+        return latents;
+    }
+
+    static bool sameBits(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+    }
+
+    void expectBlock(const std::array<uint32_t, 4>& actual, const std::array<uint32_t, 4>& expected)
+    {
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            expect(actual[i] == expected[i], "word " + juce::String(static_cast<int>(i)) + " is 0x"
+                                                 + juce::String::toHexString(actual[i]));
+        }
+    }
+};
+
+static LatentSamplerTests latentSamplerTests;
@@ -0,0 +1,114 @@
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <array>
+#include "EmbeddedModelLoader.h"
+#include "InferenceSession.h"
+#include "NativeDecoder.h"
+#include "NeuralModelWrapper.h"
+#include "SkippedTests.h"
+#include "TestModels.h"
+
+// The plugin uses the embedded native decoder whenever it was exported from the
+// embedded model, so this is where its output is held to TorchScript's
+class NativeDecoderTests : public juce::UnitTest
+{
+public:
+    NativeDecoderTests() : juce::UnitTest("NativeDecoder", "Inference") {}
+
+    static constexpr int CONFORMANCE_LATENTS = 4096;
+    static constexpr int QUANTIZATION_LATENTS = 8192;
+
+    void runTest() override
+    {
+        const char* blob = EmbeddedModelLoader::getNativeDecoderData();
+        const size_t blobSize = EmbeddedModelLoader::getNativeDecoderSize();
+
+        beginTest("Embedded decoder was exported from the embedded model");
+        if (blob == nullptr)
+        {
+            SkippedTests::skip(*this, "this build embeds no native decoder (see models/README.md)");
+            return;
+        }
+
+        NativeDecoder decoder;
+        expect(decoder.loadFromMemory(blob, blobSize), "blob doesn't parse");
+        if (!decoder.isLoaded())
+        {
+            return;
+        }
+
+        const uint64_t modelHash = NeuralModelWrapper::hashModelBytes(EmbeddedModelLoader::getModelData(),
+                                                                      EmbeddedModelLoader::getModelSize());
+        expect(decoder.getSourceModelHash() == modelHash, "blob belongs to another model");
+        expectEquals(decoder.getLatentDim(), InferenceSession::LATENT_DIM);
+
+        auto module = TestModels::loadEmbeddedModule();
+        InferenceSession session(module);
+
+        beginTest("Argmax output matches TorchScript exactly");
+        {
+            const auto latents = makeCheckLatents(CONFORMANCE_LATENTS, 0x4e445837);
+            const auto reference = decodeWithTorch(session, latents, CONFORMANCE_LATENTS);
+
+            std::vector<uint8_t> native(reference.size());
+            decoder.decode(latents.data(), CONFORMANCE_LATENTS, native.data());
+
+            int mismatchedVoices = 0;
+            for (size_t offset = 0; offset < reference.size(); offset += DX7Voice::N_PARAMS)
+            {
+                if (!std::equal(reference.begin() + offset, reference.begin() + offset + DX7Voice::N_PARAMS, native.begin() + offset))
+                {
+                    ++mismatchedVoices;
+                }
+            }
+            expectEquals(mismatchedVoices, 0, "voices that differ from TorchScript");
+        }
+
+        beginTest("Int8 argmax agrees with fp32 TorchScript for every parameter");
+        {
+            NativeDecoder quantized;
+            expect(quantized.loadFromMemory(blob, blobSize));
+            quantized.quantizeToInt8();
+
+            const auto latents = makeCheckLatents(QUANTIZATION_LATENTS, 0x51384e44);
+            const auto reference = decodeWithTorch(session, latents, QUANTIZATION_LATENTS);
+
+            std::vector<uint8_t> output(reference.size());
+            quantized.decode(latents.data(), QUANTIZATION_LATENTS, output.data());
+
+            // The bar is the worst parameter, not the average
+            std::array<int, DX7Voice::N_PARAMS> agreeing{};
+            for (size_t i = 0; i < reference.size(); ++i)
+            {
+                agreeing[i % DX7Voice::N_PARAMS] += reference[i] == output[i] ? 1 : 0;
+            }
+
+            const auto worst = std::min_element(agreeing.begin(), agreeing.end());
+            const double worstAgreement = static_cast<double>(*worst) / QUANTIZATION_LATENTS;
+            expectGreaterOrEqual(worstAgreement, NeuralModelWrapper::DEFAULT_INT8_MIN_AGREEMENT,
+                                 "agreement of parameter " + juce::String(static_cast<int>(worst - agreeing.begin())));
+        }
+    }
+
+private:
+    // Random-bank latents and, at three times the spread, the ends of the slider range
+    static std::vector<float> makeCheckLatents(int numLatents, uint32_t seed)
+    {
+        auto latents = TestModels::makeLatents(numLatents, InferenceSession::LATENT_DIM, seed);
+        for (size_t i = latents.size() / 2; i < latents.size(); ++i)
+        {
+            latents[i] *= 3.0f;
+        }
+        return latents;
+    }
+
+    // Raw argmax bytes, compared like for like with NativeDecoder::decode
+    std::vector<uint8_t> decodeWithTorch(InferenceSession& session, const std::vector<float>& latents, int numLatents)
+    {
+        std::vector<uint8_t> parameters(static_cast<size_t>(numLatents) * DX7Voice::N_PARAMS);
+        expect(session.decode(latents.data(), numLatents, parameters.data()), "TorchScript decode failed");
+        return parameters;
+    }
+};
+
+static NativeDecoderTests nativeDecoderTests;
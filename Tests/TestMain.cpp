@@ -0,0 +1,49 @@
+#include <juce_core/juce_core.h>
+#include <iostream>
+#include "SkippedTests.h"
+
+// Runs every juce::UnitTest linked into the binary, or only the one named on the
+// command line. ctest treats a non-zero exit as a failure, and SKIP_EXIT_CODE
+// (with nothing failed) as skipped.
+int main(int argc, char* argv[])
+{
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    
+    if (argc > 1)
+    {
+        juce::Array<juce::UnitTest*> selected;
+        for (auto* test : juce::UnitTest::getAllTests())
+        {
+            if (test->getName() == argv[1])
+            {
+                selected.add(test);
+            }
+        }
+        
+        if (selected.isEmpty())
+        {
+            std::cerr << "No unit test named " << argv[1] << std::endl;
+            return 1;
+        }
+        
+        runner.runTests(selected);
+    }
+    else
+    {
+        runner.runAllTests();
+    }
+    
+    int failures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+    {
+        failures += runner.getResult(i)->failures;
+    }
+    
+    if (failures != 0)
+    {
+        return 1;
+    }
+    
+    return SkippedTests::getCount() > 0 ? SkippedTests::SKIP_EXIT_CODE : 0;
+}
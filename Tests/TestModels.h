@@ -0,0 +1,34 @@
+#pragma once
+
+#include <torch/script.h>
+#include <istream>
+#include <random>
+#include <vector>
+#include "EmbeddedModelLoader.h"
+
+namespace TestModels
+{
+    // The TorchScript model linked into the test binary, loaded the way
+    // NeuralModelWrapper loads it
+    inline torch::jit::script::Module loadEmbeddedModule()
+    {
+        MemoryStreamBuffer buffer(EmbeddedModelLoader::getModelData(), EmbeddedModelLoader::getModelSize());
+        std::istream stream(&buffer);
+        auto module = torch::jit::load(stream);
+        module.eval();
+        return module;
+    }
+    
+    // numLatents standard-normal latents of latentDim floats each, flattened
+    inline std::vector<float> makeLatents(int numLatents, int latentDim, uint32_t seed)
+    {
+        std::mt19937 generator(seed);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::vector<float> latents(static_cast<size_t>(numLatents) * latentDim);
+        for (auto& value : latents)
+        {
+            value = normal(generator);
+        }
+        return latents;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <random>
+#include "DX7VoiceBank.h"
+#include "DX7VoiceValidator.h"
+
+namespace TestVoices
+{
+    // numVoices voices with every parameter drawn uniformly from its legal range
+    inline DX7VoiceBank makeRandomBank(int numVoices, uint32_t seed)
+    {
+        std::mt19937 generator(seed);
+        const auto& maxValues = DX7VoiceValidator::getMaxValues();
+
+        DX7VoiceBank bank(numVoices);
+        for (int v = 0; v < numVoices; ++v)
+        {
+            uint8_t* parameters = bank.voiceData(v);
+            for (int i = 0; i < DX7Voice::N_PARAMS; ++i)
+            {
+                parameters[i] = static_cast<uint8_t>(generator() % (maxValues[static_cast<size_t>(i)] + 1u));
+            }
+        }
+        return bank;
+    }
+}
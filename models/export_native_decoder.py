@@ -0,0 +1,150 @@
+"""Export the DX7 VAE decoder to the flat weight blob read by Source/NativeDecoder.cpp.
+
+Run it next to the TorchScript export (see README.md), for example in the docker image:
+
+    python export_native_decoder.py --model dx7_vae_model.pt --decoder-path decoder --out dx7_vae_decoder.bin
+
+The decoder must be a chain of Linear, LayerNorm and ReLU / LeakyReLU / GELU /
+Tanh / Sigmoid modules ending in the logits projection. Anything else is
+rejected, and the plugin keeps using TorchScript. The blob stores the hash of
+dx7_vae_model.pt, so it is only ever paired with the model it came from.
+NativeDecoderTests checks argmax conformance again against the embedded model.
+
+Copy the blob to models/ to have the build embed it, or configure with
+-DNDX7_EXPORT_NATIVE_DECODER=ON to have the build run this script.
+"""
+
+import argparse
+import struct
+import sys
+
+import torch
+from agoge import InferenceWorker
+
+MAGIC = b"ND7NATV1"
+VERSION = 1
+N_PARAMS = 155
+LATENT_DIM = 8
+
+LINEAR, RELU, LEAKY_RELU, GELU, TANH, SIGMOID, LAYER_NORM = 1, 2, 3, 4, 5, 6, 7
+
+
+def fnv1a(path):
+    # Same hash as NeuralModelWrapper::hashModelBytes
+    h = 1469598103934665603
+    with open(path, "rb") as f:
+        for byte in f.read():
+            h ^= byte
+            h = (h * 1099511628211) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+def flatten(module):
+    children = list(module.children())
+    if isinstance(module, (torch.nn.Sequential, torch.nn.ModuleList)) or (children and type(module) is torch.nn.Module):
+        for child in children:
+            yield from flatten(child)
+    else:
+        yield module
+
+
+def encode_ops(modules):
+    ops = []
+    for m in modules:
+        if isinstance(m, torch.nn.Linear):
+            bias = m.bias if m.bias is not None else torch.zeros(m.out_features)
+            ops.append((LINEAR, m.in_features, m.out_features, 0.0, [m.weight, bias]))
+        elif isinstance(m, torch.nn.LayerNorm):
+            if len(m.normalized_shape) != 1 or not m.elementwise_affine:
+                raise ValueError("only affine LayerNorm over the feature dimension is supported")
+            n = m.normalized_shape[0]
+            ops.append((LAYER_NORM, n, n, m.eps, [m.weight, m.bias]))
+        elif isinstance(m, (torch.nn.ReLU, torch.nn.LeakyReLU, torch.nn.GELU, torch.nn.Tanh, torch.nn.Sigmoid)):
+            if isinstance(m, torch.nn.GELU) and getattr(m, "approximate", "none") != "none":
+                raise ValueError("only the exact (erf) GELU is supported")
+            kind = {torch.nn.ReLU: RELU, torch.nn.LeakyReLU: LEAKY_RELU, torch.nn.GELU: GELU,
+                    torch.nn.Tanh: TANH, torch.nn.Sigmoid: SIGMOID}[type(m)]
+            param = m.negative_slope if kind == LEAKY_RELU else 0.0
+            ops.append((kind, None, None, param, []))
+        elif isinstance(m, (torch.nn.Dropout, torch.nn.Identity)):
+            continue
+        else:
+            raise ValueError(f"unsupported decoder layer {type(m).__name__}")
+
+    # Element-wise ops take their width from the layer before
+    width = LATENT_DIM
+    resolved = []
+    for kind, in_dim, out_dim, param, tensors in ops:
+        in_dim = width if in_dim is None else in_dim
+        out_dim = in_dim if out_dim is None else out_dim
+        resolved.append((kind, in_dim, out_dim, param, tensors))
+        width = out_dim
+    return resolved
+
+
+def run_ops(ops, z):
+    x = z
+    for kind, _, _, param, tensors in ops:
+        if kind == LINEAR:
+            x = torch.nn.functional.linear(x, tensors[0], tensors[1])
+        elif kind == LAYER_NORM:
+            x = torch.nn.functional.layer_norm(x, (x.shape[-1],), tensors[0], tensors[1], param)
+        elif kind == RELU:
+            x = torch.relu(x)
+        elif kind == LEAKY_RELU:
+            x = torch.nn.functional.leaky_relu(x, param)
+        elif kind == GELU:
+            x = torch.nn.functional.gelu(x)
+        elif kind == TANH:
+            x = torch.tanh(x)
+        elif kind == SIGMOID:
+            x = torch.sigmoid(x)
+    return x
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model", default="dx7_vae_model.pt", help="TorchScript model the plugin embeds")
+    parser.add_argument("--decoder-path", default="decoder", help="attribute path of the decoder inside the agoge model")
+    parser.add_argument("--out", default="dx7_vae_decoder.bin")
+    parser.add_argument("--check-latents", type=int, default=4096)
+    args = parser.parse_args()
+
+    model = InferenceWorker('hasty-copper-dogfish', 'dx7-vae', with_data=False).model.eval()
+    decoder = model
+    for name in args.decoder_path.split("."):
+        decoder = getattr(decoder, name)
+
+    traced = torch.jit.load(args.model).eval()
+
+    with torch.no_grad():
+        num_classes = traced(torch.zeros(1, LATENT_DIM)).shape[-1]
+        try:
+            ops = encode_ops(list(flatten(decoder)))
+        except ValueError as e:
+            sys.exit(f"Decoder can't be exported natively: {e}")
+
+        if not ops or ops[-1][0] != LINEAR or ops[-1][2] != N_PARAMS * num_classes:
+            sys.exit("Decoder must end in a Linear producing 155 x num_classes logits")
+
+        # Refuse to write a blob that disagrees with the model the plugin ships
+        z = torch.randn(args.check_latents, LATENT_DIM) * 1.5
+        expected = traced(z).argmax(-1)
+        actual = run_ops(ops, z).view(-1, N_PARAMS, num_classes).argmax(-1)
+        mismatches = (expected != actual).any(-1).sum().item()
+        if mismatches:
+            sys.exit(f"Exported layers disagree with {args.model} on {mismatches} of {args.check_latents} voices")
+
+    with open(args.out, "wb") as f:
+        header = struct.pack("<8sIIIIIIQ", MAGIC, VERSION, len(ops), LATENT_DIM, N_PARAMS, num_classes, 0, fnv1a(args.model))
+        f.write(header.ljust(64, b"\0"))
+        for kind, in_dim, out_dim, param, tensors in ops:
+            f.write(struct.pack("<IIIf", kind, in_dim, out_dim, param))
+            for t in tensors:
+                f.write(t.detach().float().contiguous().numpy().astype("<f4").tobytes())
+
+    print(f"Wrote {len(ops)} layers to {args.out}")
+
+
+if __name__ == "__main__":
+    main()